@@ -3,30 +3,61 @@
 
 
 #include <pthread.h>
+#include <vector>
 #include "file_manager.h"
 
+/* Size of a huge page.
+ * Frames of the buffer pool are carved from one arena aligned and sized to it,
+ *   so the kernel can back the arena with huge pages.
+ */
+#define FRAME_ARENA_ALIGNMENT (2 << 20)
+
 // TYPES.
 
 /** 
  * buffer_t structure
  * Represent buffer block structure
  *   which is compose buffer management layer.
- * Contains physical frame and more meta-data.
+ * Contains a pointer to physical frame and more meta-data.
  * If table_id is negative value, the instance is invalid.
  * For replacement policy, this structure is managed by LRU clock.
+ * Fields read by the lookup and replacement scans come first,
+ *   and the structure is kept small, so that the scans stay in cache.
  * 
- * And for concurrency control, each page has their own latch.
+ * And for concurrency control, each page has their own latch,
+ *   kept in a separate array of the buffer manager.
+ *
+ * rec_lsn is a lower bound of LSN of changes not written to disk yet.
+ * It is set when a clean frame is pinned, since any change made
+ *   during the pin is logged after that, and cleared when the frame is written.
+ * 0 means the frame has no unwritten change.
+ *
+ * Frames are in the frame arena, separate from the buffer structures.
+ *   Tables may have different page sizes, so a frame grows out of the arena
+ *   to the page size of the table it is read for.
+ * frame_size is the allocated size of the frame.
  */
 typedef struct _Buffer{
-    page_t frame;
     int table_id;
-    pagenum_t page_number;
     char is_dirty;
     char is_pinned;
     char ref_bit;
-    pthread_mutex_t page_latch;
+    pagenum_t page_number;
+    page_t *frame;
+    uint32_t frame_size;
+    uint64_t rec_lsn;
 } buffer_t;
 
+/**
+ * An entry of the dirty page table recorded in a checkpoint.
+ */
+class dirty_page_t {
+public:
+    int table_id;
+    pagenum_t page_number;
+    uint64_t rec_lsn;
+};
+
 
 // GLOBALS.
 
@@ -57,11 +88,19 @@ extern int g_lru_clock_hand;
 
 int buf_init_db(int buf_num);
 int buf_open_table(char *pathname);
+int buf_open_table_mapped(char *pathname);
+void buf_advise(int table_id, bool sequential);
 int buf_close_table(int table_id);
+int buf_drop_table(int table_id);
+int buf_set_compression(int table_id, bool compress);
+int buf_set_direct_io(int table_id, bool direct);
+int buf_set_page_size(int table_id, uint32_t page_size);
 buffer_t *buf_get_page(int table_id, pagenum_t page_num);
 void buf_put_page(buffer_t *buf, char dirty);
 pagenum_t buf_alloc_page(int table_id);
 void buf_free_page(int table_id, pagenum_t pagenum);
+void buf_dirty_pages(std::vector<dirty_page_t> &dirty_pages);
+int buf_flush_pages(int max_pages);
 int buf_shutdown_db(void);
 
 #endif
@@ -2,12 +2,17 @@
 #define __DISK_BASED_BPT_H__
 
 #include <algorithm>
+#include <unordered_map>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "buffer_manager.hpp"
+#include "filter_manager.hpp"
+#include "join_manager.hpp"
 #include "lock_manager.hpp"
+#include "scan_manager.hpp"
+#include "schema_manager.hpp"
 
 #define OPERATION_SUCCESS 0
 #define OPERATION_ABORTED -1
@@ -27,14 +32,57 @@ extern const int ORDER_OF_INTERNAL;
 
 // FUNCTIONS.
 
-int init_db(int num_buf);
+int init_db(int num_buf, char *log_path = NULL);
 int open_table(char *pathname);
+int open_table_mapped(char *pathname);
 int db_insert(int table_id, int64_t key, char *value);
 int db_find(int table_id, int64_t key, char *ret_val, int trx_id);
 int db_update(int table_id, int64_t key, char *values, int trx_id);
 int db_delete(int table_id, int64_t key);
+int db_insert_value(int table_id, int64_t key, const char *value, uint32_t length);
+int db_find_value(int table_id, int64_t key, char *value, uint32_t capacity, uint32_t *length);
 int close_table(int table_id);
 int shutdown_db(void);
-int join_table(int table_id_1, int table_id_2, char * pathname);
+int join_table(int table_id_1, int table_id_2, char * pathname
+        , join_format_t format = join_format_t::TEXT);
+int join_table_with_method(int table_id_1, int table_id_2, char *pathname
+        , join_method_t method, join_format_t format = join_format_t::TEXT);
+int join_table_hash(int table_id_1, int table_id_2, char *pathname
+        , join_key_t key_of_1, join_key_t key_of_2, join_format_t format = join_format_t::TEXT);
+join_method_t join_choose_method(int table_id_1, int table_id_2);
+int join_table_parallel(int table_id_1, int table_id_2, char *pathname
+        , int num_threads = 0, join_format_t format = join_format_t::TEXT);
+join_iterator_t *join_iterator_open(int table_id_1, int table_id_2);
+int join_iterator_next(join_iterator_t *iterator, join_tuple_t *tuples, int max_tuples);
+int join_iterator_next_copy(join_iterator_t *iterator, join_row_t *rows, int max_rows);
+void join_iterator_close(join_iterator_t *iterator);
+int join_table_mode(int table_id_1, int table_id_2, char *pathname, join_mode_t mode
+        , int64_t *num_rows = NULL, join_format_t format = join_format_t::TEXT);
+int join_tables(int *table_ids, int num_tables, char *pathname
+        , join_format_t format = join_format_t::TEXT);
+int scan_open(scan_t *scan, int table_id, int64_t lo, int64_t hi, scan_decode_t decode = NULL);
+int scan_next(scan_t *scan, scan_batch_t *batch);
+int scan_aggregate(scan_t *scan, const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t column, scan_aggregate_t *aggregate);
+int scan_table_aggregate(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t column, scan_aggregate_t *aggregate);
+int scan_group(scan_t *scan, const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t group_column, scan_column_t aggregate_column
+        , group_emit_t emit, void *arg);
+int scan_table_group(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t group_column, scan_column_t aggregate_column
+        , group_emit_t emit, void *arg);
+int scan_table_sort(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , const sort_order_t *order, sort_emit_t emit, void *arg);
+int db_set_schema(int table_id, column_def *columns, int num_columns);
+int db_get_schema(int table_id, column_def *columns);
+int scan_open_column(scan_t *scan, int table_id, int64_t lo, int64_t hi, int column);
+int db_set_leaf_format(int table_id, int format);
+int db_set_compression(int table_id, bool compress);
+int db_set_page_size(int table_id, uint32_t page_size);
+int db_set_direct_io(int table_id, bool direct);
 
 #endif
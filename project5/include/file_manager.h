@@ -13,6 +13,88 @@
 
 #define MAX_TABLE_ID 10
 
+/* Page sizes of tables are powers of two in this range.
+ * Page layouts are declared for the largest page,
+ *   but a page only has the part of its layout within its size.
+ */
+#define MIN_PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536
+
+/* Alignment of buffer frames.
+ * Direct I/O needs buffers, offsets and sizes aligned to the logical block size
+ *   of the device, which this covers.
+ */
+#define PAGE_ALIGNMENT 4096
+
+/* Maximum number of columns in a table schema,
+ * and maximum length of a column name including NUL.
+ */
+#define MAX_COLUMNS 16
+#define COLUMN_NAME_LENGTH 20
+
+/* Column types of a table schema.
+ * INT is int64_t and FLOAT is double, 8 bytes each.
+ * CHAR is char(width), NUL-padded and not NUL-terminated if full.
+ */
+#define COLUMN_TYPE_INT 1
+#define COLUMN_TYPE_FLOAT 2
+#define COLUMN_TYPE_CHAR 3
+
+/* Leaf formats of a table.
+ * The format is also the is_leaf field of its leaf pages.
+ * FIXED leaves hold records of 120-byte values.
+ * SLOTTED leaves hold variable-length values behind a slot directory.
+ */
+#define LEAF_FIXED 1
+#define LEAF_SLOTTED 2
+
+/* Size of the header of a slotted leaf page.
+ * The key array and slots start here and payloads grow down from the end of the page.
+ */
+#define SLOTTED_HEADER_SIZE 128
+
+/* Values longer than this are moved to overflow pages,
+ * so that a slotted leaf holds at least a few records.
+ */
+#define SLOTTED_MAX_INLINE_SIZE 1024
+
+/* Size of the header of an overflow page.
+ * The rest of the page holds bytes of a value.
+ */
+#define OVERFLOW_HEADER_SIZE 32
+
+/* Compressed table files start with this magic instead of a header page.
+ * It reads "ZPAGEMAP".
+ */
+#define PAGE_MAP_MAGIC 0x50414d454741505aULL
+
+/* Compressed pages are stored in slots of whole units of this size.
+ */
+#define PAGE_SLOT_UNIT 512
+
+/* Page map entries per map block, which is a page-sized slot.
+ */
+#define PAGE_MAP_ENTRIES_PER_BLOCK 512
+
+/* Maximum number of map blocks, which fills the superblock.
+ * A compressed table has at most 1016 * 512 pages.
+ */
+#define PAGE_MAP_MAX_BLOCKS 1016
+
+/* Size of the superblock and of a map block.
+ */
+#define PAGE_MAP_BLOCK_SIZE 4096
+
+/* Slots left by pages that moved are reused only after the file is synced,
+ * so that the map on disk never points to a slot written over.
+ * A write syncs the file once this many slots wait.
+ */
+#define PAGE_SLOT_RELEASE_BATCH 256
+
+/* Page map entry size of a page stored uncompressed.
+ */
+#define PAGE_MAP_RAW 0xFFFF
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -49,16 +131,90 @@ typedef struct {
     pagenum_t pagenum;
 } key_pagenum_pair;
 
+/* Column of a table schema.
+ * Columns are packed into the 120-byte value in order,
+ * so a column is read at a fixed offset of the value.
+ */
+typedef struct {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t width;
+    char name[COLUMN_NAME_LENGTH];
+} column_def;
+
+/* Slot of a slotted leaf page.
+ * Its key is in the key array of the page.
+ * Payload of the record is \p size bytes at \p offset from the page start.
+ * If \p length of the value is larger than \p size,
+ *   the value is in a chain of overflow pages
+ *   and the payload is the page number of the first one.
+ */
+typedef struct {
+    uint16_t offset;
+    uint16_t size;
+    uint32_t length;
+} leaf_slot;
+
+/* Page map entry of a compressed table file.
+ * The page is \p size bytes at unit \p offset , in a slot of \p capacity units.
+ * Size 0 means the page was never written and reads as zeros.
+ * Size PAGE_MAP_RAW means it is stored uncompressed.
+ */
+typedef struct {
+    uint32_t offset;
+    uint16_t size;
+    uint16_t capacity;
+} page_map_entry;
+
+/* First page-sized slot of a compressed table file.
+ * Map blocks hold page map entries of pages in order.
+ */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t num_of_map_blocks;
+    pagenum_t num_of_pages;
+    uint32_t page_size;
+    uint32_t _reserved;
+    uint32_t map_blocks[PAGE_MAP_MAX_BLOCKS];
+} page_map_superblock;
+
+/* Group - value pair.
+ * For spill page of a grouping operator.
+ */
+typedef struct {
+    int64_t group;
+    int64_t value;
+} group_value_pair;
+
 /* In-memory page structure.
  * Generic structure that can represent all kinds of pages
- * such as Header, Free, Internal or Leaf page.
+ * such as Header, Free, Internal, Leaf, Slotted leaf or Overflow page,
+ * or Spill page of a temporary table.
  * Because of generalness, this structure needs typecasting in many cases.
+ * Arrays are as long as in the largest page. Orders of a table follow its page size.
+ *   Temporary tables have pages of ON_DISK_PAGE_SIZE, which Spill page is laid out for.
+ * Header, Internal and Leaf pages have page LSN at the same offset (24),
+ * which is LSN of the last log record applied to the page.
+ * Header page may hold a schema. num_of_columns 0 means values are untyped.
+ *   leaf_format 0 means LEAF_FIXED. page_size 0 means ON_DISK_PAGE_SIZE.
+ * Slotted leaf page shares the header of Leaf page.
+ *   Keys are frame-of-reference encoded: key i is key_base plus a delta
+ *   of key_width (1, 2, 4 or 8) bytes in the key array at the start of the body.
+ *   Slots follow the key array at the next 8-byte boundary.
+ *   Payloads take [data_offset, page_size), with holes left by deletions.
+ *   data_size is the number of bytes of live payloads.
  */
 typedef union {
     struct {
         pagenum_t free_pagenum;
         pagenum_t root_pagenum;
         pagenum_t num_of_pages;
+        uint64_t page_lsn;
+        uint32_t num_of_columns;
+        uint32_t leaf_format;
+        column_def columns[MAX_COLUMNS];
+        uint32_t page_size;
     } header_page;
 
     struct {
@@ -69,19 +225,54 @@ typedef union {
         pagenum_t parent_pagenum;
         int is_leaf;
         int num_of_keys;
-        char _reserved[104];
+        char _reserved[8];
+        uint64_t page_lsn;
+        char _reserved2[88];
         pagenum_t first_pagenum;
-        key_pagenum_pair entries[248];
+        key_pagenum_pair entries[(MAX_PAGE_SIZE - 128) / 16];
     } internal_page;
 
     struct {
         pagenum_t parent_pagenum;
         int is_leaf;
         int num_of_keys;
-        char _reserved[104];
+        char _reserved[8];
+        uint64_t page_lsn;
+        char _reserved2[88];
         pagenum_t right_sibling_pagenum;
-        record records[31];
+        record records[(MAX_PAGE_SIZE - 128) / 128];
     } leaf_page;
+
+    struct {
+        pagenum_t parent_pagenum;
+        int is_leaf;
+        int num_of_keys;
+        char _reserved[8];
+        uint64_t page_lsn;
+        uint32_t data_offset;
+        uint32_t data_size;
+        int64_t key_base;
+        uint32_t key_width;
+        uint32_t page_size;
+        char _reserved2[64];
+        pagenum_t right_sibling_pagenum;
+        char body[MAX_PAGE_SIZE - 128];
+    } slotted_page;
+
+    struct {
+        pagenum_t next_pagenum;
+        uint32_t size;
+        char _reserved[12];
+        uint64_t page_lsn;
+        char data[MAX_PAGE_SIZE - OVERFLOW_HEADER_SIZE];
+    } overflow_page;
+
+    struct {
+        uint64_t num_of_rows;
+        char _reserved[16];
+        uint64_t page_lsn;
+        group_value_pair rows[254];
+    } spill_page;
 } page_t;
 
 
@@ -89,7 +280,7 @@ typedef union {
 // CONSTANTS.
 
 /* Constant value
- * that represents size of on disk page.
+ * that represents size of on disk page, unless a table sets its own.
  */
 extern const uint64_t ON_DISK_PAGE_SIZE;
 
@@ -114,6 +305,12 @@ extern int fd[MAX_TABLE_ID + 1];
  */
 extern char *stored_pathname[MAX_TABLE_ID + 1];
 
+/** 
+ * Page sizes of opened tables.
+ * Use table id (1 ~ MAX_TABLE_ID) for index.
+ */
+extern uint32_t table_page_size[MAX_TABLE_ID + 1];
+
 
 // FUNCTIONS.
 
@@ -122,7 +319,17 @@ int file_open_file(char *pathname);
 off_t file_extend_file(int table_id, page_t *header_page);
 void file_read_page(int table_id, pagenum_t pagenum, page_t* dest);
 void file_write_page(int table_id, pagenum_t pagenum, const page_t* src);
+int file_sync(int table_id);
 int file_close_file(int table_id);
+int file_set_compression(int table_id, const page_t *header_page, int compressed);
+int file_is_compressed(int table_id);
+int file_set_page_size(int table_id, const page_t *header_page);
+int file_open_mapped(char *pathname);
+const page_t *file_mapped_page(int table_id, pagenum_t pagenum);
+int file_is_mapped(int table_id);
+void file_advise(int table_id, int advice);
+int file_set_direct_io(int table_id, int direct);
+int file_is_direct_io(int table_id);
 
 #ifdef __cplusplus
 }
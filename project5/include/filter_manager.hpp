@@ -0,0 +1,58 @@
+#ifndef __FILTER_MANAGER_H__
+#define __FILTER_MANAGER_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "file_manager.h"
+
+/* Counters a filter has for each key it is sized for,
+ * and counters each key sets. About 2% of absent keys pass with these.
+ */
+#define FILTER_COUNTERS_PER_KEY 8
+#define FILTER_NUM_HASHES 5
+
+/* Smallest number of counters of a filter.
+ */
+#define FILTER_MIN_COUNTERS 4096
+
+/* A saved filter file starts with this, "BLOOMCNT".
+ */
+#define FILTER_MAGIC 0x544e434d4f4f4c42ULL
+
+/* A filter is saved next to its table, in the path name of the table with this suffix.
+ */
+#define FILTER_FILE_SUFFIX ".filter"
+
+// TYPES.
+
+/**
+ * Counting Bloom filter of keys of a table.
+ * A key increments FILTER_NUM_HASHES counters and a deleted key decrements them,
+ *   so if any counter of a key is 0, the key is not in the table.
+ * A counter stuck at UINT8_MAX is not changed anymore.
+ * num_of_counters is a power of two.
+ * The latch is taken shared to test keys and exclusive to change counters.
+ */
+class filter_t {
+public:
+    pthread_rwlock_t latch;
+    uint64_t num_of_counters;
+    uint64_t num_of_keys;
+    uint8_t *counters;
+};
+
+
+// FUNCTIONS.
+
+filter_t *filter_create(uint64_t num_of_keys);
+void filter_destroy(filter_t *filter);
+void filter_add(filter_t *filter, int64_t key);
+void filter_remove(filter_t *filter, int64_t key);
+bool filter_may_contain(filter_t *filter, int64_t key);
+bool filter_is_full(filter_t *filter);
+void filter_swap(filter_t *filter, filter_t *other);
+int filter_save(filter_t *filter, const char *pathname, pagenum_t root, pagenum_t num_of_pages);
+filter_t *filter_load(const char *pathname, pagenum_t root, pagenum_t num_of_pages);
+
+#endif
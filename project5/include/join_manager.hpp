@@ -0,0 +1,171 @@
+#ifndef __JOIN_MANAGER_H__
+#define __JOIN_MANAGER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "file_manager.h"
+
+/* Size of user-space buffer of join output.
+ * Output is written to the file one full buffer at a time.
+ */
+#define JOIN_OUTPUT_BUFFER_SIZE (4 << 20)
+
+/* Size of a row in JOIN_FORMAT_BINARY.
+ */
+#define JOIN_BINARY_ROW_SIZE 256
+
+/* Maximum size of a row in JOIN_FORMAT_TEXT.
+ * Two keys of at most 20 characters, two values of at most 120 characters,
+ *   three commas and a newline.
+ */
+#define JOIN_TEXT_ROW_MAX_SIZE (2 * (20 + 120) + 4)
+
+/* A parallel join collects at least this many candidate split keys per thread
+ *   from upper levels of the trees, to balance partitions.
+ */
+#define JOIN_SPLIT_KEYS_PER_THREAD 8
+
+/* Cost of probing a tree for a key in index nested-loop join, in page reads.
+ */
+#define JOIN_PROBE_COST 1
+
+/* Memory for the build side of a hash join.
+ * A larger build side is split into partitions of about this size.
+ */
+#define JOIN_HASH_MEMORY_SIZE (64 << 20)
+#define JOIN_HASH_MAX_PARTITIONS 256
+
+/* Number of records buffered per partition while partitioning.
+ */
+#define JOIN_HASH_SPILL_RECORDS 256
+
+// TYPES.
+
+/**
+ * Format of join result file.
+ * TEXT writes a line "a.key,a.value,b.key,b.value" per row.
+ * BINARY writes fixed 256-byte rows of (a.key, a.value, b.key, b.value)
+ *   in host byte order, so that the file can be mapped and indexed directly.
+ */
+enum class join_format_t {
+    TEXT,
+    BINARY
+};
+
+/**
+ * Join algorithm.
+ * AUTO lets the cost model choose between MERGE and INDEX_NESTED_LOOP.
+ */
+enum class join_method_t {
+    AUTO,
+    MERGE,
+    INDEX_NESTED_LOOP,
+    HASH
+};
+
+/**
+ * What a key-only join reports about records of the first table.
+ * SEMI writes keys that have a match in the second table,
+ *   ANTI writes keys that have none, and COUNT only counts matches.
+ * Values are never read or written.
+ */
+enum class join_mode_t {
+    SEMI,
+    ANTI,
+    COUNT
+};
+
+/**
+ * Join key of a record, for joins on something other than the tree key.
+ */
+typedef int64_t (*join_key_t)(const record *rec);
+
+/**
+ * Output stage of a join.
+ * Rows are formatted into a large buffer which is written
+ *   with a single write call whenever it fills up.
+ */
+class join_output_t {
+public:
+    int fd;
+    join_format_t format;
+    char *buffer;
+    size_t used;
+    bool failed;
+};
+
+/**
+ * Position in the leaf chain of a table.
+ * The current leaf is copied into \p page , so no page latch is held
+ *   between steps and cursors never block each other.
+ * page_number 0 means the cursor has passed the last record.
+ * If keep_pages is set, loading the next leaf moves the previous copy
+ *   to kept_pages instead of overwriting it, so that pointers into it
+ *   stay valid until leaf_cursor_release.
+ */
+class leaf_cursor_t {
+public:
+    int table_id;
+    pagenum_t page_number;
+    page_t *page;
+    int index;
+    bool keep_pages;
+    std::vector<page_t*> kept_pages;
+
+    leaf_cursor_t();
+    leaf_cursor_t(const leaf_cursor_t&) = delete;
+    leaf_cursor_t& operator=(const leaf_cursor_t&) = delete;
+    ~leaf_cursor_t();
+};
+
+/**
+ * A joined row returned by join_iterator_next.
+ * Values point into leaf copies held by the iterator,
+ *   and stay valid until the next call on the iterator.
+ */
+class join_tuple_t {
+public:
+    int64_t key;
+    const char *value_1;
+    const char *value_2;
+};
+
+/**
+ * A joined row copied out by join_iterator_next_copy.
+ */
+class join_row_t {
+public:
+    int64_t key;
+    char value_1[120];
+    char value_2[120];
+};
+
+/**
+ * Pull-based merge join of two tables.
+ * Each call returns the next batch of matching rows in key order.
+ * Like join_table, it reads leaves without record locks.
+ */
+class join_iterator_t {
+public:
+    pagenum_t root_1;
+    pagenum_t root_2;
+    leaf_cursor_t cursor_1;
+    leaf_cursor_t cursor_2;
+    bool done;
+};
+
+
+// FUNCTIONS.
+
+int join_output_open(join_output_t *output, const char *pathname, join_format_t format);
+void join_output_row(join_output_t *output, const record *rec_1, const record *rec_2);
+void join_output_key(join_output_t *output, int64_t key);
+void join_output_row_n(join_output_t *output, const record * const *recs, int num_records);
+int join_output_flush(join_output_t *output);
+int join_output_close(join_output_t *output);
+int join_output_concat(const char *pathname, const std::vector<std::string> &part_paths);
+void leaf_cursor_release(leaf_cursor_t *cursor);
+
+#endif
@@ -2,15 +2,34 @@
 #define __LOCK_MANAGER_H__
 
 #include <list>
+#include <map>
 #include <new>
 #include <pthread.h>
 #include <stack>
+#include <utility>
 #include <vector>
 
 #include "disk_based_bpt.hpp"
+#include "log_manager.hpp"
+#include "version_manager.hpp"
 
 #define LOCK_HASH_TABLE_SIZE 128
 
+/* record_index of page and table locks.
+ */
+#define LOCK_ON_PAGE -1
+#define LOCK_ON_TABLE -2
+
+/* Escalate record locks to a page lock when a transaction holds
+ * more than this number of record locks on one page.
+ */
+#define LOCK_PAGE_ESCALATION_THRESHOLD 8
+
+/* Escalate to a table lock when a transaction holds
+ * more than this number of record locks on one table.
+ */
+#define LOCK_TABLE_ESCALATION_THRESHOLD 1024
+
 #define LOCK_SUCCESS 0
 #define LOCK_CONFLICT 1
 #define LOCK_DEADLOCK -1
@@ -22,8 +41,13 @@ enum class trx_status_t {
     WAITING
 };
 
+/* Order of modes is used as index of compatibility matrix.
+ */
 enum class lock_mode_t {
+    INTENTION_SHARED,
+    INTENTION_EXCLUSIVE,
     SHARED,
+    SHARED_INTENTION_EXCLUSIVE,
     EXCLUSIVE
 };
 
@@ -32,6 +56,7 @@ public:
     int table_id;
     pagenum_t page_number;
     int record_index;
+    uint64_t prev_lsn;
     char old_record[120];
 };
 
@@ -59,11 +84,17 @@ class trx_t {
 public:
     int tid;
     trx_status_t status;
+    bool read_only;
+    int64_t read_ts;
+    uint64_t last_lsn;
     std::list<lock_t*> trx_locks;
+    std::map<std::pair<int, pagenum_t>, int> page_lock_counts;
+    std::map<int, int> table_lock_counts;
     lock_t *waiting_for;
     pthread_mutex_t trx_mutex;
     pthread_cond_t trx_cond;
     std::stack<undo_log_t> undo_logs;
+    std::vector<version_t*> versions;
 
     trx_t();
     ~trx_t();
@@ -74,6 +105,7 @@ public:
     static pthread_mutex_t latch;
     static std::vector<trx_t*> table;
     static int next_tid;
+    static int commits_since_collect;
 };
 
 struct lock_hash_table_element_t {
@@ -92,9 +124,14 @@ public:
 // FUNCTIONS.
 
 int begin_trx();
+int begin_read_only_trx();
 int end_trx(int tid);
+trx_t *trx_get(int tid);
+int64_t trx_oldest_snapshot(void);
+void abort_trx(trx_t *trx);
 int deadlock_detection(trx_t *target_trx, trx_t *waited_trx);
 int acquire_lock(int table_id, pagenum_t page_number, int record_index, lock_mode_t mode, trx_t *trx);
+void lock_wait(trx_t *trx);
 void undo_trx(trx_t *trx);
 void release_locks(trx_t *trx);
 
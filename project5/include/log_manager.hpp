@@ -0,0 +1,126 @@
+#ifndef __LOG_MANAGER_H__
+#define __LOG_MANAGER_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "buffer_manager.hpp"
+
+/* Log file starts with a header of this size.
+ * LSN is the offset of a log record in the log file,
+ *   so the first record has LSN LOG_HEADER_SIZE and LSN 0 means no record.
+ */
+#define LOG_HEADER_SIZE 64
+
+/* Offset of LSN of the last complete checkpoint in the log header.
+ */
+#define LOG_CHECKPOINT_LSN_OFFSET 8
+
+/* Size of each of two log buffers.
+ * One is appended to while the other is written out.
+ */
+#define LOG_BUFFER_SIZE (1 << 20)
+
+/* Maximum length of before/after images in a log record.
+ */
+#define LOG_MAX_IMAGE_SIZE 120
+
+/* Maximum length of table path name in a TABLE record.
+ */
+#define LOG_MAX_PATH_LENGTH 512
+
+/* Size of common part of all log records.
+ */
+#define LOG_RECORD_HEADER_SIZE 28
+
+/* Size of read-ahead buffer used by log_read.
+ */
+#define LOG_READ_BUFFER_SIZE (1 << 20)
+
+// TYPES.
+
+class trx_t;
+
+enum class log_type_t : int {
+    BEGIN = 0,
+    UPDATE = 1,
+    COMMIT = 2,
+    ROLLBACK = 3,
+    COMPENSATE = 4,
+    TABLE = 5,
+    CHECKPOINT = 6
+};
+
+/**
+ * In-memory form of a log record.
+ * On disk, only fields used by the type are stored in this order,
+ *   and images take just \p length bytes each.
+ * UPDATE and COMPENSATE records use fields from table_id.
+ *   next_undo_lsn is used only by COMPENSATE records.
+ * TABLE records bind table_id to pathname, which has \p length bytes.
+ *   Table ids may differ after restart, so recovery maps them by path name.
+ * CHECKPOINT records carry \p length bytes of payload.
+ *   After log_parse, payload points into the source buffer.
+ */
+class log_record_t {
+public:
+    uint32_t log_size;
+    uint64_t lsn;
+    uint64_t prev_lsn;
+    int trx_id;
+    log_type_t type;
+    int table_id;
+    pagenum_t page_number;
+    uint32_t offset;
+    uint32_t length;
+    char old_image[LOG_MAX_IMAGE_SIZE];
+    char new_image[LOG_MAX_IMAGE_SIZE];
+    uint64_t next_undo_lsn;
+    char pathname[LOG_MAX_PATH_LENGTH];
+    const char *payload;
+};
+
+class log_manager_t {
+public:
+    static pthread_mutex_t latch;
+    static pthread_cond_t flush_cond;
+    static pthread_cond_t flushed_cond;
+    static pthread_t flusher;
+    static bool running;
+    static int fd;
+    static char *buffers[2];
+    static int active;
+    static size_t buffer_used;
+    static uint64_t buffer_start_lsn;
+    static uint64_t next_lsn;
+    static uint64_t flushed_lsn;
+    static uint64_t flush_requested_lsn;
+    static uint64_t checkpoint_lsn;
+    static uint64_t table_lsns[MAX_TABLE_ID + 1];
+};
+
+
+// FUNCTIONS.
+
+int log_init(char *log_path);
+int log_shutdown(void);
+bool log_enabled(void);
+uint64_t log_end_lsn(void);
+uint64_t log_write(log_record_t *rec);
+void log_flush(uint64_t lsn);
+uint64_t log_write_update(trx_t *trx, int table_id, pagenum_t page_number
+        , uint32_t offset, uint32_t length, const char *old_image, const char *new_image);
+uint64_t log_write_compensate(trx_t *trx, int table_id, pagenum_t page_number
+        , uint32_t offset, uint32_t length, const char *old_image, const char *new_image
+        , uint64_t next_undo_lsn);
+uint64_t log_write_table(int table_id, const char *pathname);
+void log_commit(trx_t *trx);
+void log_rollback(trx_t *trx);
+int log_read(uint64_t lsn, log_record_t *rec);
+void log_truncate(uint64_t lsn);
+int log_write_master(uint64_t checkpoint_lsn);
+uint32_t log_record_size(log_type_t type, uint32_t length);
+void log_serialize(const log_record_t *rec, char *dest);
+int log_parse(const char *src, size_t len, log_record_t *rec);
+
+#endif
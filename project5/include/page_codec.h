@@ -0,0 +1,41 @@
+#ifndef __PAGE_CODEC_H__
+#define __PAGE_CODEC_H__
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+/* Number of bits of the match finder hash table.
+ */
+#define PAGE_CODEC_HASH_BITS 12
+
+/* Shortest match. Shorter runs are copied as literals.
+ */
+#define PAGE_CODEC_MIN_MATCH 4
+
+/* Farthest match, which fits in a 2-byte offset.
+ */
+#define PAGE_CODEC_MAX_OFFSET 65535
+
+/* No match starts in this many bytes before the end of the input,
+ * and no match reaches the last PAGE_CODEC_LAST_LITERALS bytes.
+ */
+#define PAGE_CODEC_MATCH_LIMIT 12
+#define PAGE_CODEC_LAST_LITERALS 5
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// FUNCTIONS.
+
+int page_compress(const char *src, int src_size, char *dest, int capacity);
+int page_decompress(const char *src, int src_size, char *dest, int dest_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PAGE_CODEC_H__
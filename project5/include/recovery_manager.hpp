@@ -0,0 +1,105 @@
+#ifndef __RECOVERY_MANAGER_H__
+#define __RECOVERY_MANAGER_H__
+
+#include <map>
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "log_manager.hpp"
+
+/* Upper bound of the number of redo threads.
+ */
+#define RECOVERY_MAX_WORKERS 64
+
+/* Below this number of records to redo, redo runs in a single thread.
+ */
+#define RECOVERY_PARALLEL_THRESHOLD 1024
+
+/* The checkpoint thread wakes up once per this period
+ *   and writes out at most CHECKPOINT_FLUSH_PAGES dirty pages.
+ */
+#define CHECKPOINT_TICK_MS 100
+#define CHECKPOINT_FLUSH_PAGES 32
+
+/* A checkpoint is taken once per this number of ticks
+ *   if anything has been logged since the last one.
+ */
+#define CHECKPOINT_INTERVAL_TICKS 10
+
+// TYPES.
+
+/**
+ * A page modification to be redone.
+ * table_id is the table id of the current run, not the one in the log.
+ */
+class redo_item_t {
+public:
+    uint64_t lsn;
+    int table_id;
+    pagenum_t page_number;
+    uint32_t offset;
+    uint32_t length;
+    char image[LOG_MAX_IMAGE_SIZE];
+};
+
+/**
+ * Redo items of one partition.
+ * Every modification of a page goes to the same partition in LSN order,
+ *   so partitions can be redone in parallel without ordering between them.
+ */
+class redo_partition_t {
+public:
+    std::vector<redo_item_t> items;
+    pthread_t thread;
+};
+
+
+/**
+ * A table open at a checkpoint.
+ * lsn is LSN of the TABLE record which bound table_id to pathname.
+ */
+class checkpoint_table_t {
+public:
+    int table_id;
+    uint64_t lsn;
+    std::string pathname;
+};
+
+/**
+ * Content of a CHECKPOINT record.
+ * Everything logged from begin_lsn on is scanned by recovery,
+ *   as well as changes of dirty pages from their rec_lsn.
+ * trxs holds (tid, last_lsn) of transactions which have written something.
+ */
+class checkpoint_t {
+public:
+    uint64_t begin_lsn;
+    int next_tid;
+    std::vector<checkpoint_table_t> tables;
+    std::vector<std::pair<int, uint64_t>> trxs;
+    std::vector<dirty_page_t> dirty_pages;
+};
+
+/**
+ * Background thread which writes out dirty pages
+ *   and takes fuzzy checkpoints periodically.
+ */
+class checkpoint_manager_t {
+public:
+    static pthread_mutex_t latch;
+    static pthread_cond_t cond;
+    static pthread_t thread;
+    static bool running;
+};
+
+
+// FUNCTIONS.
+
+int recover(void);
+int checkpoint(void);
+int checkpoint_start(void);
+void checkpoint_stop(void);
+
+#endif
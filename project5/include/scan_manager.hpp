@@ -0,0 +1,258 @@
+#ifndef __SCAN_MANAGER_H__
+#define __SCAN_MANAGER_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "buffer_manager.hpp"
+
+/* Number of rows in a column batch of a scan.
+ * Small enough that a batch stays in L1/L2 cache while it is filtered and aggregated.
+ */
+#define SCAN_BATCH_SIZE 1024
+
+/* Memory for the hash table of a grouping operator.
+ * Groups beyond it are spilled to a temporary table.
+ */
+#define GROUP_MEMORY_SIZE (16 << 20)
+
+/* Initial number of slots of a group hash table.
+ * The table doubles up to GROUP_MEMORY_SIZE while at most half full.
+ */
+#define GROUP_INITIAL_CAPACITY 1024
+
+/* Spilled rows are hashed into this many partitions, each aggregated in turn.
+ * A partition that still overflows is partitioned again with other hash bits,
+ *   up to GROUP_MAX_SPILL_DEPTH levels, after which the hash table just grows.
+ */
+#define GROUP_SPILL_PARTITIONS 16
+#define GROUP_MAX_SPILL_DEPTH 4
+
+/* Number of group - value pairs in a spill page.
+ */
+#define GROUP_ROWS_PER_PAGE 254
+
+/* An external sort pins one of this many frames of the buffer pool
+ *   as its run area, and at least SORT_MIN_AREA_PAGES.
+ * The run area bounds both the length of a run and the fan-in of a merge.
+ * Concurrent sorts together pin at most one of SORT_MAX_POOL_FRACTION frames.
+ *   A sort gets a smaller area if the rest is taken,
+ *   and fails if not even SORT_MIN_AREA_PAGES are left.
+ */
+#define SORT_POOL_FRACTION 4
+#define SORT_MAX_POOL_FRACTION 2
+#define SORT_MIN_AREA_PAGES 2
+
+/* Number of rows in a page of the run area or of a run.
+ * Pages have the leaf page layout.
+ */
+#define SORT_ROWS_PER_PAGE 31
+
+// TYPES.
+
+/**
+ * Decoder of the value column, e.g., a number stored as text in the value.
+ */
+typedef int64_t (*scan_decode_t)(const char *value);
+
+enum class scan_column_t {
+    KEY,
+    VALUE
+};
+
+enum class scan_op_t {
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE
+};
+
+/**
+ * Predicate "column op operand" of a WHERE clause.
+ * Predicates given together are ANDed.
+ */
+class scan_predicate_t {
+public:
+    scan_column_t column;
+    scan_op_t op;
+    int64_t operand;
+};
+
+/**
+ * Rows of a table in columnar form.
+ * selection[i] is 1 if row i passed all predicates so far, otherwise 0.
+ */
+class scan_batch_t {
+public:
+    int size;
+    int64_t keys[SCAN_BATCH_SIZE];
+    int64_t values[SCAN_BATCH_SIZE];
+    uint8_t selection[SCAN_BATCH_SIZE];
+};
+
+/**
+ * Running COUNT, SUM, MIN and MAX of a column over selected rows.
+ * AVG is sum / count.
+ */
+class scan_aggregate_t {
+public:
+    int64_t count;
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+};
+
+/**
+ * Position of a scan over the leaf chain of a table.
+ * The value column is decoded by decode if set,
+ *   otherwise read as int64_t at value_offset if it is not negative.
+ * page_number 0 means the scan is over.
+ */
+class scan_t {
+public:
+    int table_id;
+    scan_decode_t decode;
+    int value_offset;
+    pagenum_t page_number;
+    int index;
+    int64_t hi;
+};
+
+/**
+ * Slot of a group hash table. count 0 in the aggregate means an empty slot.
+ * The group is kept next to its aggregate, so a probe touches one cache line.
+ */
+class group_entry_t {
+public:
+    int64_t group;
+    scan_aggregate_t aggregate;
+};
+
+/**
+ * Temporary table of an operator, e.g., spill pages shared by all levels
+ *   of a grouping operator.
+ * Pages are appended and go through the buffer pool like table pages,
+ *   but are never logged. The file is opened by the first temp_table_alloc,
+ *   unlinked right away, and dropped by temp_table_drop.
+ * The path name is unique to the query, since tables are opened by path name.
+ * table_id 0 means the file is not opened yet.
+ */
+class temp_table_t {
+public:
+    std::string pathname;
+    int table_id;
+    pagenum_t next_page;
+};
+
+/**
+ * Hash aggregation of a stream of (group, value) rows.
+ * Rows of groups already in the table are aggregated in memory.
+ *   Once the table is full, rows of new groups are buffered per partition
+ *   and written to spill pages, so every group is either in memory or spilled.
+ */
+class group_aggregator_t {
+public:
+    group_entry_t *entries;
+    size_t capacity;
+    size_t size;
+    size_t max_capacity;
+    int depth;
+    temp_table_t *spill;
+    std::vector<pagenum_t> partition_pages[GROUP_SPILL_PARTITIONS];
+    std::vector<group_value_pair> partition_rows[GROUP_SPILL_PARTITIONS];
+};
+
+/**
+ * Receives a group and its aggregate. HAVING filters here.
+ */
+typedef void (*group_emit_t)(int64_t group, const scan_aggregate_t *aggregate, void *arg);
+
+/**
+ * Sort order of an ORDER BY.
+ * VALUE with a decoder compares decoded integers,
+ *   and VALUE without one compares values as strings.
+ * Rows that compare equal keep the order they were added in.
+ */
+class sort_order_t {
+public:
+    scan_column_t column;
+    scan_decode_t decode;
+    bool descending;
+};
+
+/**
+ * Sorted run on consecutive pages of a temporary table.
+ */
+class sort_run_t {
+public:
+    pagenum_t first_page;
+    pagenum_t num_pages;
+};
+
+/**
+ * Input of a merge: a run with its current page pinned.
+ * page NULL means the run is exhausted.
+ */
+class sort_source_t {
+public:
+    buffer_t *page;
+    pagenum_t next_page;
+    pagenum_t end_page;
+    int index;
+    int64_t sort_key;
+};
+
+/**
+ * Row of the run area: sort key and where the row is.
+ */
+class sort_entry_t {
+public:
+    int64_t sort_key;
+    const record *rec;
+};
+
+/**
+ * External merge sort.
+ * Rows are copied into the run area, a set of pinned frames of a temporary table.
+ *   A full area is sorted and written out as a run.
+ *   Runs are merged with a loser tree, as many at a time as the area has pages.
+ */
+class sort_t {
+public:
+    sort_order_t order;
+    temp_table_t *temp;
+    std::vector<buffer_t*> area;
+    std::vector<sort_entry_t> entries;
+    std::vector<sort_run_t> runs;
+    int reserved_pages;
+    bool failed;
+};
+
+/**
+ * Receives rows of a sort in order.
+ */
+typedef void (*sort_emit_t)(const record *rec, void *arg);
+
+
+// FUNCTIONS.
+
+int64_t scan_decode_int(const char *value);
+void scan_filter(scan_batch_t *batch, const scan_predicate_t *predicates, int num_predicates);
+void scan_aggregate_init(scan_aggregate_t *aggregate);
+void scan_aggregate_batch(scan_aggregate_t *aggregate, const scan_batch_t *batch, scan_column_t column);
+double scan_aggregate_avg(const scan_aggregate_t *aggregate);
+void temp_table_init(temp_table_t *temp, const char *pathname, const char *suffix);
+pagenum_t temp_table_alloc(temp_table_t *temp);
+int temp_table_drop(temp_table_t *temp);
+int group_aggregator_init(group_aggregator_t *aggregator, temp_table_t *spill, int depth);
+void group_aggregator_add(group_aggregator_t *aggregator, const int64_t *groups, const int64_t *values
+        , const uint8_t *selection, int num_rows);
+int group_aggregator_finish(group_aggregator_t *aggregator, group_emit_t emit, void *arg);
+int sort_init(sort_t *sort, const sort_order_t *order, temp_table_t *temp);
+void sort_add(sort_t *sort, const record *rec);
+int sort_finish(sort_t *sort, sort_emit_t emit, void *arg);
+
+#endif
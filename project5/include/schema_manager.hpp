@@ -0,0 +1,23 @@
+#ifndef __SCHEMA_MANAGER_H__
+#define __SCHEMA_MANAGER_H__
+
+#include <stdint.h>
+
+#include "file_manager.h"
+
+/* Size of a value, which all columns of a schema share.
+ */
+#define SCHEMA_VALUE_SIZE 120
+
+// FUNCTIONS.
+
+int schema_layout(column_def *columns, int num_columns);
+int schema_find_column(const column_def *columns, int num_columns, const char *name);
+int64_t value_get_int(const char *value, const column_def *column);
+double value_get_float(const char *value, const column_def *column);
+void value_get_char(const char *value, const column_def *column, char *dest);
+void value_set_int(char *value, const column_def *column, int64_t data);
+void value_set_float(char *value, const column_def *column, double data);
+void value_set_char(char *value, const column_def *column, const char *data);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __VERSION_MANAGER_H__
+#define __VERSION_MANAGER_H__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define VERSION_HASH_TABLE_SIZE 1024
+
+/* Sweep the whole version store once per this number of commits.
+ */
+#define VERSION_COLLECT_INTERVAL 64
+
+/* commit_ts of a version whose writer has not committed yet.
+ */
+#define VERSION_UNCOMMITTED INT64_MAX
+
+// TYPES.
+
+class trx_t;
+class version_chain_t;
+
+/**
+ * A before-image of a record.
+ * value is what the record held before the writer replaced it,
+ *   and commit_ts is the commit timestamp of that writer.
+ * Versions of a record are linked from the newest to the oldest.
+ */
+class version_t {
+public:
+    int64_t commit_ts;
+    char value[120];
+    version_chain_t *chain;
+    version_t *older;
+};
+
+/**
+ * Head of the version list of one record.
+ * The current value of the record always lives in the leaf page,
+ *   so a chain only holds the values that were overwritten.
+ */
+class version_chain_t {
+public:
+    int table_id;
+    int64_t key;
+    version_t *newest;
+    version_chain_t *hash_next;
+};
+
+class version_store_t {
+public:
+    static pthread_mutex_t latch;
+    static version_chain_t *table[VERSION_HASH_TABLE_SIZE];
+    static int64_t last_commit_ts;
+    static int hashing(int table_id, int64_t key);
+};
+
+
+// FUNCTIONS.
+
+int64_t version_snapshot_ts(void);
+void version_push(trx_t *trx, int table_id, int64_t key, const char *old_value);
+void version_commit(trx_t *trx);
+void version_discard(trx_t *trx);
+void version_collect(void);
+void version_read(int table_id, int64_t key, int64_t read_ts, char *value);
+
+#endif
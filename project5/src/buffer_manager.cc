@@ -2,7 +2,11 @@
  * buffer_manager.c
  */
 
+#include <sys/mman.h>
+#include <stdint.h>
+
 #include "buffer_manager.hpp"
+#include "log_manager.hpp"
 
 
 // GLOBALS.
@@ -18,6 +22,19 @@ buffer_t *g_buffer_pool = NULL;
  */
 pthread_mutex_t g_buffer_pool_latch = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ * Signaled when a buffer is unpinned while somebody waits for it.
+ * unpin_waiters counts the waiters, so that nobody is signaled in vain.
+ */
+static pthread_cond_t unpin_cond = PTHREAD_COND_INITIALIZER;
+static int unpin_waiters = 0;
+
+/**
+ * Serializes opening and closing of tables, which take and free table ids.
+ * Queries open and drop temporary tables concurrently.
+ */
+static pthread_mutex_t table_latch = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * Store size of buffer pool.
  */
@@ -29,9 +46,113 @@ int g_buffer_size = 0;
  */
 int g_lru_clock_hand = 0;
 
+/**
+ * Where the background flusher continues from.
+ */
+static int flush_hand = 0;
+
+/**
+ * Page descriptors of mapped tables, indexed by page number.
+ * Their frames point into the mapping, so they are never latched, written or evicted.
+ * NULL means the table is not mapped.
+ */
+static buffer_t *mapped_pages[MAX_TABLE_ID + 1];
+static pagenum_t mapped_num_pages[MAX_TABLE_ID + 1];
+
+/**
+ * Latches of buffers, indexed like the buffer pool.
+ */
+static pthread_mutex_t *page_latches = NULL;
+
+/**
+ * Frame arena. A frame of ON_DISK_PAGE_SIZE for each buffer in the pool,
+ *   allocated at once and backed by huge pages if possible.
+ */
+static char *frame_arena = NULL;
+static size_t frame_arena_size = 0;
+
 
 // FUNCTIONS.
 
+/**
+ * Allocate a frame of \p page_size bytes aligned to PAGE_ALIGNMENT,
+ *   so that it can be read and written with direct I/O.
+ */
+static page_t *_alloc_frame(uint32_t page_size) {
+    void *frame;
+
+    if (posix_memalign(&frame, PAGE_ALIGNMENT, page_size) != 0) {
+        perror("Buffer frame allocation");
+        exit(1);
+    }
+    return (page_t*)frame;
+}
+
+/**
+ * Check whether a frame is in the frame arena, rather than grown out of it.
+ */
+static bool _in_arena(const page_t *frame) {
+    return (const char*)frame >= frame_arena && (const char*)frame < frame_arena + frame_arena_size;
+}
+
+/**
+ * Make the frame of a buffer large enough for a page of \p page_size bytes.
+ * The content of the frame is kept.
+ */
+static void _fit_frame(buffer_t *buf, uint32_t page_size) {
+    page_t *frame;
+
+    if (buf->frame_size >= page_size) {
+        return;
+    }
+    frame = _alloc_frame(page_size);
+    memcpy(frame, buf->frame, buf->frame_size);
+    if (!_in_arena(buf->frame)) {
+        free(buf->frame);
+    }
+    buf->frame = frame;
+    buf->frame_size = page_size;
+}
+
+/**
+ * Map the frame arena for \p buf_num frames of ON_DISK_PAGE_SIZE.
+ * Explicit huge pages are used if the system has them reserved.
+ *   Otherwise, the arena is aligned to FRAME_ARENA_ALIGNMENT
+ *   and advised to be backed by transparent huge pages.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _map_frame_arena(int buf_num) {
+    size_t size = ((size_t)buf_num * ON_DISK_PAGE_SIZE + FRAME_ARENA_ALIGNMENT - 1)
+        / FRAME_ARENA_ALIGNMENT * FRAME_ARENA_ALIGNMENT;
+    char *addr, *aligned;
+
+    addr = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE
+        , MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+        frame_arena = addr;
+        frame_arena_size = size;
+        return 0;
+    }
+
+    // Map more to cut an aligned arena out of it.
+    addr = (char*)mmap(NULL, size + FRAME_ARENA_ALIGNMENT, PROT_READ | PROT_WRITE
+        , MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+        return 1;
+    }
+    aligned = (char*)(((uintptr_t)addr + FRAME_ARENA_ALIGNMENT - 1)
+        / FRAME_ARENA_ALIGNMENT * FRAME_ARENA_ALIGNMENT);
+    if (aligned > addr) {
+        munmap(addr, aligned - addr);
+    }
+    munmap(aligned + size, addr + FRAME_ARENA_ALIGNMENT - aligned);
+    madvise(aligned, size, MADV_HUGEPAGE);
+
+    frame_arena = aligned;
+    frame_arena_size = size;
+    return 0;
+}
+
 
 /**
  * A buffer initializing function.
@@ -52,17 +173,28 @@ int buf_init_db(int buf_num) {
 
     try {
         g_buffer_pool = new buffer_t[buf_num];
+        page_latches = new pthread_mutex_t[buf_num];
     } catch (...) {
         // Fail to allocate.
+        delete[] g_buffer_pool;
+        g_buffer_pool = NULL;
+        return 1;
+    }
+    if (_map_frame_arena(buf_num) != 0) {
+        delete[] g_buffer_pool;
+        delete[] page_latches;
+        g_buffer_pool = NULL;
         return 1;
     }
-    
 
     g_buffer_size = buf_num;
 
     for (i = 0; i < buf_num; ++i) {
+        g_buffer_pool[i].frame = (page_t*)(frame_arena + (size_t)i * ON_DISK_PAGE_SIZE);
+        g_buffer_pool[i].frame_size = ON_DISK_PAGE_SIZE;
         g_buffer_pool[i].table_id = -1; // means that object is invalid.
-        pthread_mutex_init(&g_buffer_pool[i].page_latch, NULL);
+        g_buffer_pool[i].rec_lsn = 0;
+        pthread_mutex_init(&page_latches[i], NULL);
     }
     
     return 0;
@@ -80,7 +212,81 @@ int buf_init_db(int buf_num) {
  *      Otherwise, return negative value.
  */
 int buf_open_table(char *pathname) {
-    return file_open_file(pathname);
+    int table_id;
+
+    pthread_mutex_lock(&table_latch);
+    table_id = file_open_file(pathname);
+    pthread_mutex_unlock(&table_latch);
+
+    return table_id;
+}
+
+/**
+ * Close the file of a table and free its table id.
+ */
+static int _close_file(int table_id) {
+    int result;
+
+    pthread_mutex_lock(&table_latch);
+    result = file_close_file(table_id);
+    pthread_mutex_unlock(&table_latch);
+
+    return result;
+}
+
+/**
+ * Open an existing table read-only, with its file mapped into memory.
+ * Pages of the table bypass the buffer pool. buf_get_page returns a descriptor
+ *   whose frame is the page in the mapping, and buf_put_page does nothing.
+ * \param pathname Path name of the table file, which must not be open already.
+ * \return If success, return unique table id of the table. Otherwise, return negative value.
+ */
+int buf_open_table_mapped(char *pathname) {
+    int table_id;
+    const page_t *header;
+    pagenum_t num_of_pages, i;
+
+    pthread_mutex_lock(&table_latch);
+    table_id = file_open_mapped(pathname);
+    pthread_mutex_unlock(&table_latch);
+    if (table_id < 0) {
+        return table_id;
+    }
+
+    header = file_mapped_page(table_id, 0);
+    num_of_pages = header->header_page.num_of_pages;
+    mapped_pages[table_id] = new buffer_t[num_of_pages]();
+    mapped_num_pages[table_id] = num_of_pages;
+    for (i = 0; i < num_of_pages; ++i) {
+        mapped_pages[table_id][i].frame = (page_t*)file_mapped_page(table_id, i);
+        mapped_pages[table_id][i].frame_size = table_page_size[table_id];
+        mapped_pages[table_id][i].table_id = table_id;
+        mapped_pages[table_id][i].page_number = i;
+    }
+
+    return table_id;
+}
+
+/**
+ * Turn direct I/O of a table on or off. Frames are aligned for it,
+ *   so pages of the table are cached only in the buffer pool.
+ * \param direct If true, turn direct I/O on. Otherwise, turn it off.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int buf_set_direct_io(int table_id, bool direct) {
+    return file_set_direct_io(table_id, direct);
+}
+
+/**
+ * Tell how pages of a mapped table are going to be read.
+ * Nothing is done for a table in the buffer pool.
+ * \param sequential If true, pages are read in order by a scan,
+ *   so the kernel reads ahead. Otherwise, they are read by point lookups.
+ */
+void buf_advise(int table_id, bool sequential) {
+    if (mapped_pages[table_id]) {
+        file_advise(table_id, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
 }
 
 /** 
@@ -90,19 +296,106 @@ int buf_open_table(char *pathname) {
  * \return If success, return 0. Otherwise, return non-zero value.
  */
 int buf_close_table(int table_id) {
-    int i;
+    int i, result;
+
+    if (mapped_pages[table_id]) {
+        delete[] mapped_pages[table_id];
+        mapped_pages[table_id] = NULL;
+        mapped_num_pages[table_id] = 0;
+        return _close_file(table_id);
+    }
+    // The pool latch keeps the background flusher off the frames of the table.
+    pthread_mutex_lock(&g_buffer_pool_latch);
     for (i = 0; i < g_buffer_size; ++i) {
+        // Wait until the buffer is unpinned, e.g., by the background flusher.
+        while (g_buffer_pool[i].table_id == table_id && g_buffer_pool[i].is_pinned) {
+            ++unpin_waiters;
+            pthread_cond_wait(&unpin_cond, &g_buffer_pool_latch);
+            --unpin_waiters;
+        }
         if (g_buffer_pool[i].table_id == table_id) {
-            // Wait until the buffer is unpin
-            while (g_buffer_pool[i].is_pinned) continue;
             if (g_buffer_pool[i].is_dirty) {
-                file_write_page(table_id, g_buffer_pool[i].page_number, &g_buffer_pool[i].frame);
+                log_flush(g_buffer_pool[i].frame->leaf_page.page_lsn);
+                file_write_page(table_id, g_buffer_pool[i].page_number, g_buffer_pool[i].frame);
             }
             // Empty the buffer structure.
             g_buffer_pool[i].table_id = -1;
+            g_buffer_pool[i].is_dirty = 0;
+            g_buffer_pool[i].rec_lsn = 0;
         }
     }
-    return file_close_file(table_id);
+    pthread_mutex_unlock(&g_buffer_pool_latch);
+    result = file_sync(table_id);
+    return _close_file(table_id) || result;
+}
+
+/**
+ * Discard all pages of a temporary table from buffer without writing them,
+ *   and discard the table id. Changes to the table are lost.
+ * \param table_id Indicating target table to be dropped.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int buf_drop_table(int table_id) {
+    int i;
+
+    pthread_mutex_lock(&g_buffer_pool_latch);
+    for (i = 0; i < g_buffer_size; ++i) {
+        // Wait until the background flusher unpins it.
+        while (g_buffer_pool[i].table_id == table_id && g_buffer_pool[i].is_pinned) {
+            ++unpin_waiters;
+            pthread_cond_wait(&unpin_cond, &g_buffer_pool_latch);
+            --unpin_waiters;
+        }
+        if (g_buffer_pool[i].table_id == table_id) {
+            g_buffer_pool[i].table_id = -1;
+            g_buffer_pool[i].is_dirty = 0;
+            g_buffer_pool[i].rec_lsn = 0;
+        }
+    }
+    pthread_mutex_unlock(&g_buffer_pool_latch);
+
+    return _close_file(table_id);
+}
+
+/**
+ * Convert the file of a table that has only the header page
+ *   to a compressed file, or back to a plain file.
+ * The header page is latched during the conversion,
+ *   and written from the buffer to the new file.
+ * \param compress If true, compress the file. Otherwise, make it plain.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int buf_set_compression(int table_id, bool compress) {
+    buffer_t *header = buf_get_page(table_id, 0);
+    int result = file_set_compression(table_id, header->frame, compress);
+    buf_put_page(header, 0);
+    return result;
+}
+
+/**
+ * Change the page size of a table that has only the header page.
+ * The header page is latched during the change,
+ *   and written from the buffer to the rewritten file.
+ * \param page_size New page size, a power of two
+ *   from MIN_PAGE_SIZE to MAX_PAGE_SIZE.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int buf_set_page_size(int table_id, uint32_t page_size) {
+    buffer_t *header = buf_get_page(table_id, 0);
+    uint32_t old_page_size = header->frame->header_page.page_size;
+    int result;
+
+    _fit_frame(header, page_size);
+    if (page_size > table_page_size[table_id]) {
+        memset((char*)header->frame + table_page_size[table_id], 0, page_size - table_page_size[table_id]);
+    }
+    header->frame->header_page.page_size = page_size;
+    result = file_set_page_size(table_id, header->frame);
+    if (result != 0) {
+        header->frame->header_page.page_size = old_page_size;
+    }
+    buf_put_page(header, 0);
+    return result;
 }
 
 /**
@@ -111,7 +404,8 @@ int buf_close_table(int table_id) {
  *      and read from disk to that page.
  * \param table_id Indicate the table where the page is.
  * \param page_num Page number of the page to be returned.
- * \return Returns a pointer to the buffer structure designated by arguments.
+ * \return Returns a pointer to the buffer structure designated by arguments,
+ *         or NULL if the page lies beyond a mapped table.
  */
 buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
     int i;
@@ -120,6 +414,11 @@ buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
     bool acquired = false;
     bool retry = false;
 
+    if (mapped_pages[table_id]) {
+        // file_open_mapped checked num_of_pages, so a page beyond it is corrupt.
+        return page_num < mapped_num_pages[table_id] ? &mapped_pages[table_id][page_num] : NULL;
+    }
+
     while (!acquired) {
     // acquire global buffer pool latch
         pthread_mutex_lock(&g_buffer_pool_latch);
@@ -130,13 +429,16 @@ buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
                     && g_buffer_pool[i].page_number == page_num) {
 
                 // Fail to acquire page latch
-                if (pthread_mutex_trylock(&g_buffer_pool[i].page_latch) != 0) {
+                if (pthread_mutex_trylock(&page_latches[i]) != 0) {
                     retry = true; // set the retry flag
                     break;
                 }
 
                 g_buffer_pool[i].is_pinned = 1;
                 g_buffer_pool[i].ref_bit = 1;
+                if (g_buffer_pool[i].rec_lsn == 0) {
+                    g_buffer_pool[i].rec_lsn = log_end_lsn();
+                }
 
                 pthread_mutex_unlock(&g_buffer_pool_latch);
                 return g_buffer_pool + i;
@@ -163,15 +465,17 @@ buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
         if (i < g_buffer_size) {
             // Read page into the empty space of buffer pool.
             // And return it.
-            file_read_page(table_id, page_num, &g_buffer_pool[i].frame);
+            _fit_frame(&g_buffer_pool[i], table_page_size[table_id]);
+            file_read_page(table_id, page_num, g_buffer_pool[i].frame);
 
-            pthread_mutex_lock(&g_buffer_pool[i].page_latch);
+            pthread_mutex_lock(&page_latches[i]);
 
             g_buffer_pool[i].table_id = table_id;
             g_buffer_pool[i].page_number = page_num;
             g_buffer_pool[i].is_dirty = 0;
             g_buffer_pool[i].is_pinned = 1;
             g_buffer_pool[i].ref_bit = 1;
+            g_buffer_pool[i].rec_lsn = log_end_lsn();
 
             pthread_mutex_unlock(&g_buffer_pool_latch);
 
@@ -186,16 +490,20 @@ buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
 
             // Happy case : found victim. evict this page.
             if (!curr_buf->is_pinned && !curr_buf->ref_bit) {
-                pthread_mutex_lock(&curr_buf->page_latch);
+                pthread_mutex_lock(&page_latches[curr_buf - g_buffer_pool]);
                 curr_buf->is_pinned = 1;
                 if (curr_buf->is_dirty) {
-                    file_write_page(curr_buf->table_id, curr_buf->page_number, &curr_buf->frame);
+                    // Write-ahead rule. Log records of this page go first.
+                    log_flush(curr_buf->frame->leaf_page.page_lsn);
+                    file_write_page(curr_buf->table_id, curr_buf->page_number, curr_buf->frame);
                 }
-                file_read_page(table_id, page_num, &curr_buf->frame);
+                _fit_frame(curr_buf, table_page_size[table_id]);
+                file_read_page(table_id, page_num, curr_buf->frame);
                 curr_buf->table_id = table_id;
                 curr_buf->page_number = page_num;
                 curr_buf->is_dirty = 0;
                 curr_buf->ref_bit = 1;
+                curr_buf->rec_lsn = log_end_lsn();
 
                 done = 1;
                 acquired = true;
@@ -224,13 +532,23 @@ buffer_t *buf_get_page(int table_id, pagenum_t page_num) {
  * \return Returns nothing.
  */
 void buf_put_page(buffer_t *buf, char dirty) {
+
+    if (mapped_pages[buf->table_id]) {
+        return;
+    }
     
     pthread_mutex_lock(&g_buffer_pool_latch);
     // (buf->is_dirty | dirty) means this is clean
     // only when previous clean and clean in this turn too.
     buf->is_dirty |= dirty;
     buf->is_pinned = 0;
-    pthread_mutex_unlock(&buf->page_latch);
+    if (!buf->is_dirty) {
+        buf->rec_lsn = 0;
+    }
+    if (unpin_waiters) {
+        pthread_cond_broadcast(&unpin_cond);
+    }
+    pthread_mutex_unlock(&page_latches[buf - g_buffer_pool]);
     pthread_mutex_unlock(&g_buffer_pool_latch);
 }
 
@@ -248,16 +566,16 @@ pagenum_t buf_alloc_page(int table_id) {
 
     header_page = buf_get_page(table_id, 0);
 
-    result = header_page->frame.header_page.free_pagenum;
+    result = header_page->frame->header_page.free_pagenum;
     
     // Special case : There is no free page in file. So, extend file.
     if (result == 0) {
-        result = file_extend_file(table_id, &header_page->frame) / ON_DISK_PAGE_SIZE;
+        result = file_extend_file(table_id, header_page->frame) / table_page_size[table_id];
     }
     // Normal case : allocate a page from free page list.
     else {
         free_page = buf_get_page(table_id, result);
-        header_page->frame.header_page.free_pagenum = free_page->frame.free_page.next_free_pagenum;
+        header_page->frame->header_page.free_pagenum = free_page->frame->free_page.next_free_pagenum;
         buf_put_page(free_page, 0);
     }
 
@@ -278,31 +596,130 @@ void buf_free_page(int table_id, pagenum_t pagenum) {
     header = buf_get_page(table_id, 0);
     freeing_page = buf_get_page(table_id, pagenum);
 
-    freeing_page->frame.free_page.next_free_pagenum = header->frame.header_page.free_pagenum;
-    header->frame.header_page.free_pagenum = pagenum;
+    freeing_page->frame->free_page.next_free_pagenum = header->frame->header_page.free_pagenum;
+    header->frame->header_page.free_pagenum = pagenum;
 
     buf_put_page(header, 1);
     buf_put_page(freeing_page, 1);
 }
 
+/**
+ * Collect the dirty page table.
+ * Pinned frames are included even if clean,
+ *   because they may be in the middle of a change.
+ * \param dirty_pages Frames with unwritten changes are appended to this.
+ */
+void buf_dirty_pages(std::vector<dirty_page_t> &dirty_pages) {
+    int i;
+    dirty_page_t dirty_page;
+
+    pthread_mutex_lock(&g_buffer_pool_latch);
+    for (i = 0; i < g_buffer_size; ++i) {
+        if (g_buffer_pool[i].table_id > 0 && g_buffer_pool[i].rec_lsn != 0) {
+            dirty_page.table_id = g_buffer_pool[i].table_id;
+            dirty_page.page_number = g_buffer_pool[i].page_number;
+            dirty_page.rec_lsn = g_buffer_pool[i].rec_lsn;
+            dirty_pages.push_back(dirty_page);
+        }
+    }
+    pthread_mutex_unlock(&g_buffer_pool_latch);
+}
+
+/**
+ * Write out some dirty pages in the background.
+ * Pages in use are skipped instead of waited for,
+ *   and the buffer pool latch is not held during the write.
+ * \param max_pages Maximum number of pages to write.
+ * \return Number of pages written.
+ */
+int buf_flush_pages(int max_pages) {
+    int i, written = 0, table_id;
+    pagenum_t page_number;
+    buffer_t *curr_buf;
+
+    pthread_mutex_lock(&g_buffer_pool_latch);
+
+    for (i = 0; i < g_buffer_size && written < max_pages; ++i) {
+        curr_buf = &g_buffer_pool[flush_hand];
+        flush_hand = (flush_hand + 1) % g_buffer_size;
+
+        if (curr_buf->table_id <= 0 || !curr_buf->is_dirty || curr_buf->is_pinned
+                || pthread_mutex_trylock(&page_latches[curr_buf - g_buffer_pool]) != 0) {
+            continue;
+        }
+        curr_buf->is_pinned = 1;
+        table_id = curr_buf->table_id;
+        page_number = curr_buf->page_number;
+        pthread_mutex_unlock(&g_buffer_pool_latch);
+
+        // Write-ahead rule. Log records of this page go first.
+        log_flush(curr_buf->frame->leaf_page.page_lsn);
+        file_write_page(table_id, page_number, curr_buf->frame);
+        ++written;
+
+        pthread_mutex_lock(&g_buffer_pool_latch);
+        curr_buf->is_dirty = 0;
+        curr_buf->is_pinned = 0;
+        curr_buf->rec_lsn = 0;
+        if (unpin_waiters) {
+            pthread_cond_broadcast(&unpin_cond);
+        }
+        pthread_mutex_unlock(&page_latches[curr_buf - g_buffer_pool]);
+    }
+
+    pthread_mutex_unlock(&g_buffer_pool_latch);
+
+    return written;
+}
+
 /**
  * Flush all data from buffer and destroy allocated buffer.
  * \return If success, return 0. Otherwise, return non-zero value.
  */
 int buf_shutdown_db(void) {
-    int i;
+    int i, result = 0;
     
     for (i = 0; i < g_buffer_size; ++i) {
         if (g_buffer_pool[i].table_id > 0) {
             while (g_buffer_pool[i].is_pinned) continue;
             if (g_buffer_pool[i].is_dirty) {
-                file_write_page(g_buffer_pool[i].table_id, g_buffer_pool[i].page_number, &g_buffer_pool[i].frame);
+                log_flush(g_buffer_pool[i].frame->leaf_page.page_lsn);
+                file_write_page(g_buffer_pool[i].table_id, g_buffer_pool[i].page_number, g_buffer_pool[i].frame);
             }
         }
     }
 
+    for (i = 1; i <= MAX_TABLE_ID; ++i) {
+        if (stored_pathname[i] && file_sync(i) != 0) {
+            result = -1;
+        }
+    }
+
+    for (i = 1; i <= MAX_TABLE_ID; ++i) {
+        if (mapped_pages[i]) {
+            delete[] mapped_pages[i];
+            mapped_pages[i] = NULL;
+            mapped_num_pages[i] = 0;
+            if (_close_file(i) != 0) {
+                result = -1;
+            }
+        }
+    }
+
+    for (i = 0; i < g_buffer_size; ++i) {
+        if (!_in_arena(g_buffer_pool[i].frame)) {
+            free(g_buffer_pool[i].frame);
+        }
+    }
+    munmap(frame_arena, frame_arena_size);
+    frame_arena = NULL;
+    frame_arena_size = 0;
+
     g_buffer_size = 0;
     delete[] g_buffer_pool;
+    delete[] page_latches;
+    g_buffer_pool = NULL;
+    page_latches = NULL;
 
-    return 0;
+    return result;
 }
@@ -35,17 +35,22 @@
 
 
 #include "disk_based_bpt.hpp"
+#include "recovery_manager.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 // CONSTANTS.
 
 /**
- * Order of leaf page.
+ * Order of leaf page of ON_DISK_PAGE_SIZE bytes.
  */
 const int ORDER_OF_LEAF = 32;
 
 /**
- * Order of internal page.
+ * Order of internal page of ON_DISK_PAGE_SIZE bytes.
  */
 const int ORDER_OF_INTERNAL = 249;
 
@@ -54,6 +59,8 @@ const int ORDER_OF_INTERNAL = 249;
 
 // Declaration.
 
+static int _leaf_order(int table_id);
+static int _internal_order(int table_id);
 static pagenum_t _find_leaf(int table_id, pagenum_t root, int64_t key);
 static int _cut(int length);
 static int _get_left_index(int table_id, pagenum_t parent, pagenum_t left);
@@ -69,18 +76,39 @@ static pagenum_t _insert_into_leaf_after_split(int table_id, pagenum_t root, pag
 static void _adjust_root(int table_id, pagenum_t root);
 static int _get_neighbor_index(int table_id, pagenum_t parent, pagenum_t node);
 static int _remove_entry_from_internal_node(int table_id, pagenum_t node, int64_t key, pagenum_t pointer);
-static int _remove_record_from_leaf(int table_id, pagenum_t leaf, int64_t key, char *value);
+static int _remove_record_from_leaf(int table_id, pagenum_t leaf, int64_t key);
 static void _delayed_merge_nodes(int table_id, pagenum_t root, pagenum_t node, pagenum_t parent
         , pagenum_t neighbor, int neighbor_index, int64_t k_prime);
-static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t key, char *value);
+static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t key);
 static void _redistribute_nodes(int table_id, pagenum_t node, pagenum_t parent
         , pagenum_t neighbor, int neighbor_index, int64_t k_prime, int k_prime_index);
 static void _delete_internal_entry(int table_id, pagenum_t root, pagenum_t node, int64_t key, pagenum_t pointer);
+static int _slotted_search(const page_t *page, int64_t key);
+static void _slotted_remove(int table_id, page_t *page, int index);
+static void _read_header(int table_id, pagenum_t *root, pagenum_t *num_of_pages);
 
 
 // Internal functions
 // Reference to bpt.c
 
+// orders.
+
+/**
+ * Order of fixed leaves of a table, from its page size.
+ * A page of ON_DISK_PAGE_SIZE bytes gives ORDER_OF_LEAF.
+ */
+static int _leaf_order(int table_id) {
+    return (table_page_size[table_id] - 128) / sizeof(record) + 1;
+}
+
+/**
+ * Order of internal pages of a table, from its page size.
+ * A page of ON_DISK_PAGE_SIZE bytes gives ORDER_OF_INTERNAL.
+ */
+static int _internal_order(int table_id) {
+    return (table_page_size[table_id] - 128) / sizeof(key_pagenum_pair) + 1;
+}
+
 // find.
 
 /**
@@ -103,13 +131,13 @@ static pagenum_t _find_leaf(int table_id, pagenum_t root, int64_t key) {
     c = buf_get_page(table_id, root);
 
 
-    while (!c->frame.internal_page.is_leaf) {
+    while (!c->frame->internal_page.is_leaf) {
         i = 0;
-        while (i < c->frame.internal_page.num_of_keys) {
-            if (key >= c->frame.internal_page.entries[i].key) i++;
+        while (i < c->frame->internal_page.num_of_keys) {
+            if (key >= c->frame->internal_page.entries[i].key) i++;
             else break;
         }
-        root = *(&c->frame.internal_page.first_pagenum + 2 * i);
+        root = *(&c->frame->internal_page.first_pagenum + 2 * i);
         buf_put_page(c, 0);
         c = buf_get_page(table_id, root);
     }
@@ -141,8 +169,8 @@ static int _get_left_index(int table_id, pagenum_t parent, pagenum_t left) {
     int left_index = 0;
     buffer_t *parent_page;
     parent_page = buf_get_page(table_id, parent);
-    while (left_index <= parent_page->frame.internal_page.num_of_keys && 
-            *(&(parent_page->frame.internal_page.first_pagenum) + 2 * left_index) != left)
+    while (left_index <= parent_page->frame->internal_page.num_of_keys && 
+            *(&(parent_page->frame->internal_page.first_pagenum) + 2 * left_index) != left)
         left_index++;
     buf_put_page(parent_page, 0);
     return left_index;
@@ -158,13 +186,12 @@ static pagenum_t _start_new_tree(int table_id, int64_t key, char * value) {
 
     root_page = buf_get_page(table_id, root);
 
-    root_page->frame.leaf_page.is_leaf = 1;
-    root_page->frame.leaf_page.num_of_keys = 1;
-    root_page->frame.leaf_page.parent_pagenum = 0;
-    root_page->frame.leaf_page.records[0].key = key;
-    strncpy(root_page->frame.leaf_page.records[0].value, value, 119);
-    root_page->frame.leaf_page.records[0].value[119] = '\0';
-    root_page->frame.leaf_page.right_sibling_pagenum = 0;
+    root_page->frame->leaf_page.is_leaf = 1;
+    root_page->frame->leaf_page.num_of_keys = 1;
+    root_page->frame->leaf_page.parent_pagenum = 0;
+    root_page->frame->leaf_page.records[0].key = key;
+    memcpy(root_page->frame->leaf_page.records[0].value, value, 120);
+    root_page->frame->leaf_page.right_sibling_pagenum = 0;
     
     buf_put_page(root_page, 1);
 
@@ -182,21 +209,21 @@ static pagenum_t _insert_into_new_root(int table_id, pagenum_t left, int64_t key
     pagenum_t root = buf_alloc_page(table_id);
     buffer_t *root_page = buf_get_page(table_id, root);
 
-    root_page->frame.internal_page.entries[0].key = key;
-    root_page->frame.internal_page.first_pagenum = left;
-    root_page->frame.internal_page.entries[0].pagenum = right;
-    root_page->frame.internal_page.num_of_keys = 1;
-    root_page->frame.internal_page.parent_pagenum = 0;
-    root_page->frame.internal_page.is_leaf = 0;
+    root_page->frame->internal_page.entries[0].key = key;
+    root_page->frame->internal_page.first_pagenum = left;
+    root_page->frame->internal_page.entries[0].pagenum = right;
+    root_page->frame->internal_page.num_of_keys = 1;
+    root_page->frame->internal_page.parent_pagenum = 0;
+    root_page->frame->internal_page.is_leaf = 0;
     
     buf_put_page(root_page, 1);
 
     root_page = buf_get_page(table_id, left);
-    root_page->frame.internal_page.parent_pagenum = root;
+    root_page->frame->internal_page.parent_pagenum = root;
     buf_put_page(root_page, 1);
 
     root_page = buf_get_page(table_id, right);
-    root_page->frame.internal_page.parent_pagenum = root;
+    root_page->frame->internal_page.parent_pagenum = root;
     buf_put_page(root_page, 1);
 
     return root;
@@ -214,14 +241,14 @@ static void _insert_into_node(int table_id, pagenum_t node, int left_index, int6
 
     node_page = buf_get_page(table_id, node);
 
-    for (i = node_page->frame.internal_page.num_of_keys; i > left_index; i--) {
+    for (i = node_page->frame->internal_page.num_of_keys; i > left_index; i--) {
 
-        *(&node_page->frame.internal_page.first_pagenum + 2 * (i + 1)) = *(&node_page->frame.internal_page.first_pagenum + 2 * i);
-        node_page->frame.internal_page.entries[i].key = node_page->frame.internal_page.entries[i - 1].key;
+        *(&node_page->frame->internal_page.first_pagenum + 2 * (i + 1)) = *(&node_page->frame->internal_page.first_pagenum + 2 * i);
+        node_page->frame->internal_page.entries[i].key = node_page->frame->internal_page.entries[i - 1].key;
     }
-    node_page->frame.internal_page.entries[left_index].pagenum = right;
-    node_page->frame.internal_page.entries[left_index].key = key;
-    ++node_page->frame.internal_page.num_of_keys;
+    node_page->frame->internal_page.entries[left_index].pagenum = right;
+    node_page->frame->internal_page.entries[left_index].key = key;
+    ++node_page->frame->internal_page.num_of_keys;
     buf_put_page(node_page, 1);
 }
 
@@ -250,12 +277,12 @@ static pagenum_t _insert_into_node_after_split(int table_id, pagenum_t root, pag
      * the other half to the new.
      */
 
-    temp_pagenums = new pagenum_t[ORDER_OF_INTERNAL + 1];
+    temp_pagenums = new pagenum_t[_internal_order(table_id) + 1];
     if (temp_pagenums == NULL) {
         perror("Temporary pagenums array for splitting nodes.");
         exit(1);
     }
-    temp_keys = new int64_t[ORDER_OF_INTERNAL];
+    temp_keys = new int64_t[_internal_order(table_id)];
     if (temp_keys == NULL) {
         perror("Temporary keys array for splitting nodes.");
         exit(1);
@@ -263,14 +290,14 @@ static pagenum_t _insert_into_node_after_split(int table_id, pagenum_t root, pag
 
     old_node_page = buf_get_page(table_id, old_node);
 
-    for (i = 0, j = 0; i < old_node_page->frame.internal_page.num_of_keys + 1; ++i, ++j) {
+    for (i = 0, j = 0; i < old_node_page->frame->internal_page.num_of_keys + 1; ++i, ++j) {
         if (j == left_index + 1) ++j;
-        temp_pagenums[j] = *(&old_node_page->frame.internal_page.first_pagenum + 2 * i);
+        temp_pagenums[j] = *(&old_node_page->frame->internal_page.first_pagenum + 2 * i);
     }
     
-    for (i = 0, j = 0; i < old_node_page->frame.internal_page.num_of_keys; ++i, ++j) {
+    for (i = 0, j = 0; i < old_node_page->frame->internal_page.num_of_keys; ++i, ++j) {
         if (j == left_index) ++j;
-        temp_keys[j] = old_node_page->frame.internal_page.entries[i].key;
+        temp_keys[j] = old_node_page->frame->internal_page.entries[i].key;
     }
 
     temp_pagenums[left_index + 1] = right;
@@ -282,30 +309,30 @@ static pagenum_t _insert_into_node_after_split(int table_id, pagenum_t root, pag
      */  
     new_node_page = buf_get_page(table_id, new_node);
 
-    split = _cut(ORDER_OF_INTERNAL);
-    new_node_page->frame.internal_page.is_leaf = 0;
+    split = _cut(_internal_order(table_id));
+    new_node_page->frame->internal_page.is_leaf = 0;
     for (i = 0; i < split - 1; ++i) {
-        *(&old_node_page->frame.internal_page.first_pagenum + 2 * i) = temp_pagenums[i];
-        old_node_page->frame.internal_page.entries[i].key = temp_keys[i];
+        *(&old_node_page->frame->internal_page.first_pagenum + 2 * i) = temp_pagenums[i];
+        old_node_page->frame->internal_page.entries[i].key = temp_keys[i];
     }
-    old_node_page->frame.internal_page.num_of_keys = i;
-    old_node_page->frame.internal_page.entries[i - 1].pagenum = temp_pagenums[i];
+    old_node_page->frame->internal_page.num_of_keys = i;
+    old_node_page->frame->internal_page.entries[i - 1].pagenum = temp_pagenums[i];
     k_prime = temp_keys[split - 1];
-    for (++i, j = 0; i < ORDER_OF_INTERNAL; ++i, ++j) {
-        *(&new_node_page->frame.internal_page.first_pagenum + 2 * j) = temp_pagenums[i];
-        new_node_page->frame.internal_page.entries[j].key = temp_keys[i];
+    for (++i, j = 0; i < _internal_order(table_id); ++i, ++j) {
+        *(&new_node_page->frame->internal_page.first_pagenum + 2 * j) = temp_pagenums[i];
+        new_node_page->frame->internal_page.entries[j].key = temp_keys[i];
     }
-    new_node_page->frame.internal_page.num_of_keys = j;
-    new_node_page->frame.internal_page.entries[j - 1].pagenum = temp_pagenums[i];
+    new_node_page->frame->internal_page.num_of_keys = j;
+    new_node_page->frame->internal_page.entries[j - 1].pagenum = temp_pagenums[i];
     delete[] temp_pagenums;
     delete[] temp_keys;
 
-    new_node_page->frame.internal_page.parent_pagenum = old_node_page->frame.internal_page.parent_pagenum;
+    new_node_page->frame->internal_page.parent_pagenum = old_node_page->frame->internal_page.parent_pagenum;
 
-    for (i = 0; i <= new_node_page->frame.internal_page.num_of_keys; ++i) {
-        child = *(&new_node_page->frame.internal_page.first_pagenum + 2 * i);
+    for (i = 0; i <= new_node_page->frame->internal_page.num_of_keys; ++i) {
+        child = *(&new_node_page->frame->internal_page.first_pagenum + 2 * i);
         child_page = buf_get_page(table_id, child);
-        child_page->frame.internal_page.parent_pagenum = new_node;
+        child_page->frame->internal_page.parent_pagenum = new_node;
         buf_put_page(child_page, 1);
     }
 
@@ -332,7 +359,7 @@ static pagenum_t _insert_into_parent(int table_id, pagenum_t root, pagenum_t lef
 
     page = buf_get_page(table_id, left);
 
-    parent = page->frame.internal_page.parent_pagenum;
+    parent = page->frame->internal_page.parent_pagenum;
 
     /* Case: parent is new root. */
     if (parent == 0) {
@@ -349,7 +376,7 @@ static pagenum_t _insert_into_parent(int table_id, pagenum_t root, pagenum_t lef
     page = buf_get_page(table_id, parent);
 
     /* Simple case: the new key fits into the node. */
-    if (page->frame.internal_page.num_of_keys < ORDER_OF_INTERNAL - 1) {
+    if (page->frame->internal_page.num_of_keys < _internal_order(table_id) - 1) {
         buf_put_page(page, 0);
         _insert_into_node(table_id, parent, left_index, key, right);
         return root;
@@ -372,18 +399,17 @@ static void _insert_into_leaf(int table_id, pagenum_t leaf, int64_t key, char *v
 
     leaf_page = buf_get_page(table_id, leaf);
     insertion_point = 0;
-    while (insertion_point < leaf_page->frame.leaf_page.num_of_keys && leaf_page->frame.leaf_page.records[insertion_point].key < key) {
+    while (insertion_point < leaf_page->frame->leaf_page.num_of_keys && leaf_page->frame->leaf_page.records[insertion_point].key < key) {
         ++insertion_point;
     }
 
-    for(i = leaf_page->frame.leaf_page.num_of_keys; i > insertion_point; --i) {
-        leaf_page->frame.leaf_page.records[i].key = leaf_page->frame.leaf_page.records[i - 1].key;
-        strncpy(leaf_page->frame.leaf_page.records[i].value, leaf_page->frame.leaf_page.records[i - 1].value, 120);
+    for(i = leaf_page->frame->leaf_page.num_of_keys; i > insertion_point; --i) {
+        leaf_page->frame->leaf_page.records[i].key = leaf_page->frame->leaf_page.records[i - 1].key;
+        memcpy(leaf_page->frame->leaf_page.records[i].value, leaf_page->frame->leaf_page.records[i - 1].value, 120);
     }
-    leaf_page->frame.leaf_page.records[insertion_point].key = key;
-    strncpy(leaf_page->frame.leaf_page.records[insertion_point].value, value, 119);
-    leaf_page->frame.leaf_page.records[insertion_point].value[119] = '\0';
-    ++leaf_page->frame.leaf_page.num_of_keys;
+    leaf_page->frame->leaf_page.records[insertion_point].key = key;
+    memcpy(leaf_page->frame->leaf_page.records[insertion_point].value, value, 120);
+    ++leaf_page->frame->leaf_page.num_of_keys;
     buf_put_page(leaf_page, 1);
 }
 
@@ -402,15 +428,15 @@ static pagenum_t _insert_into_leaf_after_split(int table_id, pagenum_t root, pag
     char (*temp_values)[120];
 
     new_leaf_page = buf_get_page(table_id, new_leaf);
-    new_leaf_page->frame.leaf_page.is_leaf = 1;
+    new_leaf_page->frame->leaf_page.is_leaf = 1;
 
-    temp_keys = new int64_t[ORDER_OF_LEAF];
+    temp_keys = new int64_t[_leaf_order(table_id)];
     if (temp_keys == NULL) {
         perror("Temporary keys array.");
         exit(1);
     }
 
-    temp_values = new char[ORDER_OF_LEAF][120];
+    temp_values = new char[_leaf_order(table_id)][120];
     if (temp_values == NULL) {
         perror("Temporary keys array.");
         exit(1);
@@ -419,44 +445,43 @@ static pagenum_t _insert_into_leaf_after_split(int table_id, pagenum_t root, pag
     leaf_page = buf_get_page(table_id, leaf);
 
     insertion_index = 0;
-    while (insertion_index < ORDER_OF_LEAF - 1 && leaf_page->frame.leaf_page.records[insertion_index].key < key) {
+    while (insertion_index < _leaf_order(table_id) - 1 && leaf_page->frame->leaf_page.records[insertion_index].key < key) {
         ++insertion_index;
     }
 
-    for (i = 0, j = 0; i < ORDER_OF_LEAF - 1; ++i, ++j) {
+    for (i = 0, j = 0; i < _leaf_order(table_id) - 1; ++i, ++j) {
         if (j == insertion_index) ++j;
-        temp_keys[j] = leaf_page->frame.leaf_page.records[i].key;
-        strncpy(temp_values[j], leaf_page->frame.leaf_page.records[i].value, 120);
+        temp_keys[j] = leaf_page->frame->leaf_page.records[i].key;
+        memcpy(temp_values[j], leaf_page->frame->leaf_page.records[i].value, 120);
     }
 
     temp_keys[insertion_index] = key;
-    strncpy(temp_values[insertion_index], value, 120);
-    temp_values[insertion_index][119] = '\0';
+    memcpy(temp_values[insertion_index], value, 120);
 
-    leaf_page->frame.leaf_page.num_of_keys = 0;
+    leaf_page->frame->leaf_page.num_of_keys = 0;
 
-    split = _cut(ORDER_OF_LEAF - 1);
+    split = _cut(_leaf_order(table_id) - 1);
 
     for (i = 0; i < split; ++i) {
-        strncpy(leaf_page->frame.leaf_page.records[i].value, temp_values[i], 120);
-        leaf_page->frame.leaf_page.records[i].key = temp_keys[i];
+        memcpy(leaf_page->frame->leaf_page.records[i].value, temp_values[i], 120);
+        leaf_page->frame->leaf_page.records[i].key = temp_keys[i];
     }
-    leaf_page->frame.leaf_page.num_of_keys = i;
+    leaf_page->frame->leaf_page.num_of_keys = i;
 
-    for (i = split, j = 0; i < ORDER_OF_LEAF; ++i, ++j) {
-        strncpy(new_leaf_page->frame.leaf_page.records[j].value, temp_values[i], 120);
-        new_leaf_page->frame.leaf_page.records[j].key = temp_keys[i];
+    for (i = split, j = 0; i < _leaf_order(table_id); ++i, ++j) {
+        memcpy(new_leaf_page->frame->leaf_page.records[j].value, temp_values[i], 120);
+        new_leaf_page->frame->leaf_page.records[j].key = temp_keys[i];
     }
-    new_leaf_page->frame.leaf_page.num_of_keys = j;
+    new_leaf_page->frame->leaf_page.num_of_keys = j;
 
     delete[] temp_keys;
     delete[] temp_values;
 
-    new_leaf_page->frame.leaf_page.right_sibling_pagenum = leaf_page->frame.leaf_page.right_sibling_pagenum;
-    leaf_page->frame.leaf_page.right_sibling_pagenum = new_leaf;
+    new_leaf_page->frame->leaf_page.right_sibling_pagenum = leaf_page->frame->leaf_page.right_sibling_pagenum;
+    leaf_page->frame->leaf_page.right_sibling_pagenum = new_leaf;
 
-    new_leaf_page->frame.leaf_page.parent_pagenum = leaf_page->frame.leaf_page.parent_pagenum;
-    new_key = new_leaf_page->frame.leaf_page.records[0].key;
+    new_leaf_page->frame->leaf_page.parent_pagenum = leaf_page->frame->leaf_page.parent_pagenum;
+    new_key = new_leaf_page->frame->leaf_page.records[0].key;
 
     buf_put_page(leaf_page, 1);
     buf_put_page(new_leaf_page, 1);
@@ -478,7 +503,7 @@ static void _adjust_root(int table_id, pagenum_t root) {
     root_page = buf_get_page(table_id, root);
 
     /* Case: nonempty root. */
-    if (root_page->frame.internal_page.num_of_keys > 0) {
+    if (root_page->frame->internal_page.num_of_keys > 0) {
         buf_put_page(root_page, 0);
         return;
     }
@@ -487,12 +512,12 @@ static void _adjust_root(int table_id, pagenum_t root) {
 
     // If it has a child, promote
     // the first (only) child as the new root.
-    if (!root_page->frame.internal_page.is_leaf) {
-        new_root = root_page->frame.internal_page.first_pagenum;
+    if (!root_page->frame->internal_page.is_leaf) {
+        new_root = root_page->frame->internal_page.first_pagenum;
 
         buf_put_page(root_page, 0);
         root_page = buf_get_page(table_id, new_root);
-        root_page->frame.internal_page.parent_pagenum = 0;
+        root_page->frame->internal_page.parent_pagenum = 0;
         buf_put_page(root_page, 1);
     }
 
@@ -505,7 +530,7 @@ static void _adjust_root(int table_id, pagenum_t root) {
     }
 
     root_page = buf_get_page(table_id, 0);
-    root_page->frame.header_page.root_pagenum = new_root;
+    root_page->frame->header_page.root_pagenum = new_root;
     buf_put_page(root_page, 1);
 
     buf_free_page(table_id, root);
@@ -529,8 +554,8 @@ static int _get_neighbor_index(int table_id, pagenum_t parent, pagenum_t node) {
      * If given node is the leftmost child,
      * this means return -1.
      */
-    for (i = 0; i <= temp_page->frame.internal_page.num_of_keys; ++i) {
-        if (*(&temp_page->frame.internal_page.first_pagenum + 2 * i) == node) {
+    for (i = 0; i <= temp_page->frame->internal_page.num_of_keys; ++i) {
+        if (*(&temp_page->frame->internal_page.first_pagenum + 2 * i) == node) {
             buf_put_page(temp_page, 0);
             return i - 1;
         }
@@ -554,26 +579,26 @@ static int _remove_entry_from_internal_node(int table_id, pagenum_t node, int64_
 
     // Remove the key and shift other keys accordingly.
     i = 0;
-    while (internal_page->frame.internal_page.entries[i].key != key) {
+    while (internal_page->frame->internal_page.entries[i].key != key) {
         ++i;
     }
-    for (++i; i < internal_page->frame.internal_page.num_of_keys; ++i) {
-        internal_page->frame.internal_page.entries[i - 1].key = internal_page->frame.internal_page.entries[i].key;
+    for (++i; i < internal_page->frame->internal_page.num_of_keys; ++i) {
+        internal_page->frame->internal_page.entries[i - 1].key = internal_page->frame->internal_page.entries[i].key;
     }
 
     // Remove the child pagenum and shift other values accordingly.
     i = 0;
-    while (*(&internal_page->frame.internal_page.first_pagenum + 2 * i) != pointer) {
+    while (*(&internal_page->frame->internal_page.first_pagenum + 2 * i) != pointer) {
         ++i;
     }
-    for (++i; i < internal_page->frame.internal_page.num_of_keys + 1; ++i) {
-        *(&internal_page->frame.internal_page.first_pagenum + 2 * (i - 1)) = *(&internal_page->frame.internal_page.first_pagenum + 2 * i);
+    for (++i; i < internal_page->frame->internal_page.num_of_keys + 1; ++i) {
+        *(&internal_page->frame->internal_page.first_pagenum + 2 * (i - 1)) = *(&internal_page->frame->internal_page.first_pagenum + 2 * i);
     }
 
     // Decrease number of keys
-    --internal_page->frame.internal_page.num_of_keys;
+    --internal_page->frame->internal_page.num_of_keys;
 
-    result = internal_page->frame.internal_page.num_of_keys;
+    result = internal_page->frame->internal_page.num_of_keys;
 
     buf_put_page(internal_page, 1);
 
@@ -585,7 +610,7 @@ static int _remove_entry_from_internal_node(int table_id, pagenum_t node, int64_
  * Leaf page version of remove_entry_from_node in bpt.c
  * Return number of keys of given leaf page.
  */
-static int _remove_record_from_leaf(int table_id, pagenum_t leaf, int64_t key, char *value) {
+static int _remove_record_from_leaf(int table_id, pagenum_t leaf, int64_t key) {
     
     int i;
     buffer_t *leaf_page;
@@ -593,28 +618,27 @@ static int _remove_record_from_leaf(int table_id, pagenum_t leaf, int64_t key, c
 
     leaf_page = buf_get_page(table_id, leaf);
 
-    // Remove the key and shift other keys accordingly.
-    i = 0;
-    while (leaf_page->frame.leaf_page.records[i].key != key) {
-        ++i;
-    }
-    for (++i; i < leaf_page->frame.leaf_page.num_of_keys; ++i) {
-        leaf_page->frame.leaf_page.records[i - 1].key = leaf_page->frame.leaf_page.records[i].key;
+    if (leaf_page->frame->leaf_page.is_leaf == LEAF_SLOTTED) {
+        _slotted_remove(table_id, leaf_page->frame, _slotted_search(leaf_page->frame, key));
+        result = leaf_page->frame->slotted_page.num_of_keys;
+        buf_put_page(leaf_page, 1);
+        return result;
     }
 
-    // Remove the value and shift other values accordingly.
+    // Remove the record and shift other records accordingly.
+    // Typed values are raw bytes, so the record is found by its key alone.
     i = 0;
-    while (strcmp(leaf_page->frame.leaf_page.records[i].value, value) != 0) {
+    while (leaf_page->frame->leaf_page.records[i].key != key) {
         ++i;
     }
-    for (++i; i < leaf_page->frame.leaf_page.num_of_keys; ++i) {
-        strncpy(leaf_page->frame.leaf_page.records[i - 1].value, leaf_page->frame.leaf_page.records[i].value, 120);
+    for (++i; i < leaf_page->frame->leaf_page.num_of_keys; ++i) {
+        leaf_page->frame->leaf_page.records[i - 1] = leaf_page->frame->leaf_page.records[i];
     }
 
     // Decrease number of keys
-    --leaf_page->frame.leaf_page.num_of_keys;
+    --leaf_page->frame->leaf_page.num_of_keys;
 
-    result = leaf_page->frame.leaf_page.num_of_keys;
+    result = leaf_page->frame->leaf_page.num_of_keys;
 
     buf_put_page(leaf_page, 1);
 
@@ -638,8 +662,8 @@ static void _delayed_merge_nodes(int table_id, pagenum_t root, pagenum_t node, p
      * or first_child_pagenum(in internal) from given node.
      */
     node_page = buf_get_page(table_id, node);
-    is_leaf = node_page->frame.internal_page.is_leaf;
-    last_pagenum = node_page->frame.leaf_page.right_sibling_pagenum;
+    is_leaf = node_page->frame->internal_page.is_leaf;
+    last_pagenum = node_page->frame->leaf_page.right_sibling_pagenum;
 
     // Read neighbor page to temp_page    
     neighbor_page = buf_get_page(table_id, neighbor);
@@ -651,9 +675,9 @@ static void _delayed_merge_nodes(int table_id, pagenum_t root, pagenum_t node, p
      */
     if (is_leaf) {
         if (neighbor_index != -1) {
-            neighbor_page->frame.leaf_page.right_sibling_pagenum = last_pagenum;
+            neighbor_page->frame->leaf_page.right_sibling_pagenum = last_pagenum;
         } else {
-            memcpy(&node_page->frame, &neighbor_page->frame, ON_DISK_PAGE_SIZE);
+            memcpy(node_page->frame, neighbor_page->frame, table_page_size[table_id]);
             node = neighbor;
             dirty = 1;
         }
@@ -665,28 +689,28 @@ static void _delayed_merge_nodes(int table_id, pagenum_t root, pagenum_t node, p
          * append k_prime and given node's only child to neighbor.
          */
         if (neighbor_index != -1) {
-            neighbor_page->frame.internal_page.entries[neighbor_page->frame.internal_page.num_of_keys].key = k_prime;
-            neighbor_page->frame.internal_page.entries[neighbor_page->frame.internal_page.num_of_keys].pagenum = last_pagenum;
-            ++neighbor_page->frame.internal_page.num_of_keys;
+            neighbor_page->frame->internal_page.entries[neighbor_page->frame->internal_page.num_of_keys].key = k_prime;
+            neighbor_page->frame->internal_page.entries[neighbor_page->frame->internal_page.num_of_keys].pagenum = last_pagenum;
+            ++neighbor_page->frame->internal_page.num_of_keys;
         } 
         // If given node is leftmost child.
         else {
             /* Insert k_prime and given node's only child to
              * left of neighbor node.
              */
-            for (i = neighbor_page->frame.internal_page.num_of_keys; i > 0; --i) {
-                neighbor_page->frame.internal_page.entries[i].key = neighbor_page->frame.internal_page.entries[i - 1].key;
-                neighbor_page->frame.internal_page.entries[i].pagenum = neighbor_page->frame.internal_page.entries[i - 1].pagenum;
+            for (i = neighbor_page->frame->internal_page.num_of_keys; i > 0; --i) {
+                neighbor_page->frame->internal_page.entries[i].key = neighbor_page->frame->internal_page.entries[i - 1].key;
+                neighbor_page->frame->internal_page.entries[i].pagenum = neighbor_page->frame->internal_page.entries[i - 1].pagenum;
             }
-            neighbor_page->frame.internal_page.entries[0].pagenum = neighbor_page->frame.internal_page.first_pagenum;
+            neighbor_page->frame->internal_page.entries[0].pagenum = neighbor_page->frame->internal_page.first_pagenum;
 
-            neighbor_page->frame.internal_page.entries[0].key = k_prime;
-            neighbor_page->frame.internal_page.first_pagenum = last_pagenum;
-            ++neighbor_page->frame.internal_page.num_of_keys;
+            neighbor_page->frame->internal_page.entries[0].key = k_prime;
+            neighbor_page->frame->internal_page.first_pagenum = last_pagenum;
+            ++neighbor_page->frame->internal_page.num_of_keys;
         }
 
         temp_page = buf_get_page(table_id, last_pagenum);
-        temp_page->frame.internal_page.parent_pagenum = neighbor;
+        temp_page->frame->internal_page.parent_pagenum = neighbor;
         buf_put_page(temp_page, 1);
     }
 
@@ -703,7 +727,7 @@ static void _delayed_merge_nodes(int table_id, pagenum_t root, pagenum_t node, p
  * makes all appropriate changes to preserve
  * the B+ tree properties.
  */
-static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t key, char *value) {
+static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t key) {
     
     int leaf_num_keys, neighbor_index, k_prime_index;
     pagenum_t neighbor, parent;
@@ -711,7 +735,7 @@ static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t
     int64_t k_prime;
 
     // Remove record from leaf.
-    leaf_num_keys = _remove_record_from_leaf(table_id, leaf, key, value);
+    leaf_num_keys = _remove_record_from_leaf(table_id, leaf, key);
 
     /* Case: deletion was performed in the root. */
     if (leaf == root) {
@@ -737,15 +761,15 @@ static void _delete_record(int table_id, pagenum_t root, pagenum_t leaf, int64_t
      */
 
     temp_page = buf_get_page(table_id, leaf);
-    parent = temp_page->frame.leaf_page.parent_pagenum;
+    parent = temp_page->frame->leaf_page.parent_pagenum;
     buf_put_page(temp_page, 0);
 
     neighbor_index = _get_neighbor_index(table_id, parent, leaf);
     k_prime_index = neighbor_index == -1 ? 0 : neighbor_index;
 
     temp_page = buf_get_page(table_id, parent);
-    neighbor = *(&temp_page->frame.internal_page.first_pagenum + (neighbor_index == -1 ? 2 * 1 : 2 * neighbor_index));
-    k_prime = temp_page->frame.internal_page.entries[k_prime_index].key;
+    neighbor = *(&temp_page->frame->internal_page.first_pagenum + (neighbor_index == -1 ? 2 * 1 : 2 * neighbor_index));
+    k_prime = temp_page->frame->internal_page.entries[k_prime_index].key;
     buf_put_page(temp_page, 0);
 
 
@@ -774,22 +798,22 @@ static void _redistribute_nodes(int table_id, pagenum_t node, pagenum_t parent
     if (neighbor_index != -1) {
         neighbor_page = buf_get_page(table_id, neighbor);
 
-        temp_key = neighbor_page->frame.internal_page.entries[ORDER_OF_INTERNAL - 2].key;
-        temp_pagenum = neighbor_page->frame.internal_page.entries[ORDER_OF_INTERNAL - 2].pagenum;
-        --neighbor_page->frame.internal_page.num_of_keys;
+        temp_key = neighbor_page->frame->internal_page.entries[_internal_order(table_id) - 2].key;
+        temp_pagenum = neighbor_page->frame->internal_page.entries[_internal_order(table_id) - 2].pagenum;
+        --neighbor_page->frame->internal_page.num_of_keys;
 
 
         parent_page = buf_get_page(table_id, parent);
-        parent_page->frame.internal_page.entries[k_prime_index].key = temp_key;
+        parent_page->frame->internal_page.entries[k_prime_index].key = temp_key;
 
         node_page = buf_get_page(table_id, node);
-        node_page->frame.internal_page.entries[0].key = k_prime;
-        node_page->frame.internal_page.entries[0].pagenum = node_page->frame.internal_page.first_pagenum;
-        node_page->frame.internal_page.first_pagenum = temp_pagenum;
-        ++node_page->frame.internal_page.num_of_keys;
+        node_page->frame->internal_page.entries[0].key = k_prime;
+        node_page->frame->internal_page.entries[0].pagenum = node_page->frame->internal_page.first_pagenum;
+        node_page->frame->internal_page.first_pagenum = temp_pagenum;
+        ++node_page->frame->internal_page.num_of_keys;
 
         temp_page = buf_get_page(table_id, temp_pagenum);
-        temp_page->frame.internal_page.parent_pagenum = node;
+        temp_page->frame->internal_page.parent_pagenum = node;
     }
 
     /* Case: node is the leftmost child.
@@ -800,25 +824,25 @@ static void _redistribute_nodes(int table_id, pagenum_t node, pagenum_t parent
     else {
         neighbor_page = buf_get_page(table_id, neighbor);
 
-        temp_key = neighbor_page->frame.internal_page.entries[0].key;
-        temp_pagenum = neighbor_page->frame.internal_page.first_pagenum;
-        neighbor_page->frame.internal_page.first_pagenum = neighbor_page->frame.internal_page.entries[0].pagenum;
+        temp_key = neighbor_page->frame->internal_page.entries[0].key;
+        temp_pagenum = neighbor_page->frame->internal_page.first_pagenum;
+        neighbor_page->frame->internal_page.first_pagenum = neighbor_page->frame->internal_page.entries[0].pagenum;
 
-        for (i = 0; i < neighbor_page->frame.internal_page.num_of_keys - 1; ++i) {
-            neighbor_page->frame.internal_page.entries[i].key = neighbor_page->frame.internal_page.entries[i + 1].key;
-            neighbor_page->frame.internal_page.entries[i].pagenum = neighbor_page->frame.internal_page.entries[i + 1].pagenum;
+        for (i = 0; i < neighbor_page->frame->internal_page.num_of_keys - 1; ++i) {
+            neighbor_page->frame->internal_page.entries[i].key = neighbor_page->frame->internal_page.entries[i + 1].key;
+            neighbor_page->frame->internal_page.entries[i].pagenum = neighbor_page->frame->internal_page.entries[i + 1].pagenum;
         }
-        --neighbor_page->frame.internal_page.num_of_keys;
+        --neighbor_page->frame->internal_page.num_of_keys;
 
         parent_page = buf_get_page(table_id, parent);
-        parent_page->frame.internal_page.entries[k_prime_index].key = temp_key;
+        parent_page->frame->internal_page.entries[k_prime_index].key = temp_key;
 
         node_page = buf_get_page(table_id, node);
-        node_page->frame.internal_page.entries[0].key = k_prime;
-        node_page->frame.internal_page.entries[0].pagenum = temp_pagenum;
-        ++node_page->frame.internal_page.num_of_keys;
+        node_page->frame->internal_page.entries[0].key = k_prime;
+        node_page->frame->internal_page.entries[0].pagenum = temp_pagenum;
+        ++node_page->frame->internal_page.num_of_keys;
 
-        temp_page->frame.internal_page.parent_pagenum = node;
+        temp_page->frame->internal_page.parent_pagenum = node;
     }
 
     buf_put_page(neighbor_page, 1);
@@ -868,24 +892,24 @@ static void _delete_internal_entry(int table_id, pagenum_t root, pagenum_t node,
      */
 
     temp_page = buf_get_page(table_id, node);
-    parent = temp_page->frame.internal_page.parent_pagenum;
+    parent = temp_page->frame->internal_page.parent_pagenum;
     buf_put_page(temp_page, 0);
     
     neighbor_index = _get_neighbor_index(table_id, parent, node);
     k_prime_index = neighbor_index == -1 ? 0 : neighbor_index;
 
     temp_page = buf_get_page(table_id, parent);
-    neighbor = *(&temp_page->frame.internal_page.first_pagenum + (neighbor_index == -1 ? 2 * 1 : 2 * neighbor_index));
-    k_prime = temp_page->frame.internal_page.entries[k_prime_index].key;
+    neighbor = *(&temp_page->frame->internal_page.first_pagenum + (neighbor_index == -1 ? 2 * 1 : 2 * neighbor_index));
+    k_prime = temp_page->frame->internal_page.entries[k_prime_index].key;
     buf_put_page(temp_page, 0);
 
 
     temp_page = buf_get_page(table_id, neighbor);
-    neighbor_num_keys = temp_page->frame.internal_page.num_of_keys;
+    neighbor_num_keys = temp_page->frame->internal_page.num_of_keys;
     buf_put_page(temp_page, 0);
 
     /* Delayed merge. */
-    if (neighbor_num_keys < ORDER_OF_INTERNAL - 1)
+    if (neighbor_num_keys < _internal_order(table_id) - 1)
         _delayed_merge_nodes(table_id, root, node, parent, neighbor, neighbor_index, k_prime);
     /* Redistribution. */
     else
@@ -893,326 +917,2687 @@ static void _delete_internal_entry(int table_id, pagenum_t root, pagenum_t node,
 }
 
 
-
-// External functions.
+// Slotted leaves.
 
 /**
- * A initializing function.
- * Allocate the buffer pool (array) 
- *   with the given number of entries by buf_num
- *   by calling buffer initializing function in buffer management layer.
- * Initialize other fields such as state info, LRU info, etc.
- * \param buf_num Number of entries in the buffer pool.
- *      Allocate with this number of buffers.
- * \return If success, return 0. Otherwise, return non-zero value.
+ * Key array of a slotted leaf. Key i is key_base plus a delta of key_width bytes.
  */
-int init_db(int num_buf) {
-    return buf_init_db(num_buf);
+static inline char *_slotted_keys(const page_t *page) {
+    return (char*)page + SLOTTED_HEADER_SIZE;
 }
 
 /**
- * Open or Create a file(table) corresponding to pathname.
- * If open this table for the first time,
- *   set empty space of global array fd to file descriptor of opened file.
- * Then store pathname in same index of global array stored_pathname.
- * The index of empty space is allocate to this table for table id.
- * Otherwise, just return unique table id.
- * \param pathname path name for a file to be opened or created.
- * \return If success, return unique table id of corresponding file to \p pathname .
- *      Otherwise, return negative value.
+ * Slots of a slotted leaf with given number of keys and key width.
+ * They follow the key array at the next 8-byte boundary.
  */
-int open_table(char *pathname) {
-    return buf_open_table(pathname);
+static inline leaf_slot *_slotted_slots(const page_t *page, int num_of_keys, int key_width) {
+    return (leaf_slot*)((char*)page + SLOTTED_HEADER_SIZE + ((num_of_keys * key_width + 7) & ~7));
 }
 
+static inline leaf_slot *_slotted_slots(const page_t *page) {
+    return _slotted_slots(page, page->slotted_page.num_of_keys, page->slotted_page.key_width);
+}
 
 /**
- * Insert input ‘key/value’ (record) to data file at the right place.
- * If success, return 0. Otherwise, return non-zero value.
+ * Bytes of the key array and the slots of a slotted leaf.
  */
-int db_insert(int table_id, int64_t key, char * value) {
-    buffer_t *tmp_page;
-    pagenum_t root, leaf, new_root;
-    int leaf_num_keys;
+static inline uint32_t _slotted_directory_size(int num_of_keys, int key_width) {
+    return ((num_of_keys * key_width + 7) & ~7) + num_of_keys * sizeof(leaf_slot);
+}
 
-    tmp_page = buf_get_page(table_id, 0);
-    root = tmp_page->frame.header_page.root_pagenum;
-    buf_put_page(tmp_page, 0);
+/**
+ * Narrowest key width that holds given delta.
+ */
+static inline int _key_width(uint64_t delta) {
+    return delta <= UINT8_MAX ? 1 : delta <= UINT16_MAX ? 2 : delta <= UINT32_MAX ? 4 : 8;
+}
 
-    // No duplicates.
-    if (db_find(table_id, key, NULL, 0) == 0)
-        return 1;
-    
-    /* Case: the tree doesn't exist yet.
-     * Start new tree with given record.
-     */
-    if (root == 0) {
-        new_root = _start_new_tree(table_id, key, value);
-        tmp_page = buf_get_page(table_id, 0);
-        tmp_page->frame.header_page.root_pagenum = new_root;
-        buf_put_page(tmp_page, 1);
-        return 0;
+/**
+ * Key at given index of a slotted leaf.
+ */
+static inline int64_t _slotted_key(const page_t *page, int index) {
+    const char *keys = _slotted_keys(page);
+    uint64_t delta;
+
+    switch (page->slotted_page.key_width) {
+    case 1: delta = ((const uint8_t*)keys)[index]; break;
+    case 2: delta = ((const uint16_t*)keys)[index]; break;
+    case 4: delta = ((const uint32_t*)keys)[index]; break;
+    default: delta = ((const uint64_t*)keys)[index]; break;
     }
-    // Tree already exists.
+    return (int64_t)((uint64_t)page->slotted_page.key_base + delta);
+}
 
-    leaf = _find_leaf(table_id, root, key);
+/**
+ * Store a key delta at given index of a key array.
+ */
+static inline void _set_key_delta(char *keys, int key_width, int index, uint64_t delta) {
+    switch (key_width) {
+    case 1: ((uint8_t*)keys)[index] = delta; break;
+    case 2: ((uint16_t*)keys)[index] = delta; break;
+    case 4: ((uint32_t*)keys)[index] = delta; break;
+    default: ((uint64_t*)keys)[index] = delta; break;
+    }
+}
 
-    // Read leaf page to tmp_page
-    tmp_page = buf_get_page(table_id, leaf);
+/**
+ * Count deltas less than \p target in a sorted key array,
+ *   which is the index of the first key not less than the target.
+ * Deltas narrower than 8 bytes are compared 16, 8 or 4 at a time with SSE2,
+ *   after flipping sign bits for unsigned comparison.
+ *   The count stops at the first vector with a delta not less than the target.
+ */
+static int _count_less(const char *keys, int key_width, int num_of_keys, uint64_t target) {
+    int i = 0;
 
-    /* Case: leaf has some space to store a new record.
-     */
-    leaf_num_keys = tmp_page->frame.leaf_page.num_of_keys;
-    buf_put_page(tmp_page, 0);
-    if (leaf_num_keys < ORDER_OF_LEAF - 1) {
-        _insert_into_leaf(table_id, leaf, key, value);
-        return 0;
+    if (key_width < 8 && target > (UINT64_MAX >> (64 - 8 * key_width))) {
+        return num_of_keys;
     }
 
-    /* Case: leaf must be split.
-     */
-
-    new_root = _insert_into_leaf_after_split(table_id, root, leaf, key, value);
-    if (root != new_root) {
-        tmp_page = buf_get_page(table_id, 0);
-        tmp_page->frame.header_page.root_pagenum = new_root;
-        buf_put_page(tmp_page, 1);
+#ifdef __SSE2__
+    __m128i bias, pivot, less;
+    int mask, full, lanes = 16 / key_width, count = 0;
+
+    if (key_width < 8) {
+        switch (key_width) {
+        case 1:
+            bias = _mm_set1_epi8((char)0x80);
+            pivot = _mm_set1_epi8((char)(target ^ 0x80));
+            break;
+        case 2:
+            bias = _mm_set1_epi16((short)0x8000);
+            pivot = _mm_set1_epi16((short)(target ^ 0x8000));
+            break;
+        default:
+            bias = _mm_set1_epi32((int)0x80000000);
+            pivot = _mm_set1_epi32((int)(target ^ 0x80000000));
+            break;
+        }
+        full = 0xFFFF;
+        for (; i + lanes <= num_of_keys; i += lanes) {
+            less = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i * key_width)), bias);
+            switch (key_width) {
+            case 1: less = _mm_cmplt_epi8(less, pivot); break;
+            case 2: less = _mm_cmplt_epi16(less, pivot); break;
+            default: less = _mm_cmplt_epi32(less, pivot); break;
+            }
+            mask = _mm_movemask_epi8(less);
+            count = __builtin_popcount(mask) / key_width;
+            if (mask != full) {
+                return i + count;
+            }
+        }
     }
-    return 0;
+#endif
+
+    for (; i < num_of_keys; ++i) {
+        uint64_t delta;
+        switch (key_width) {
+        case 1: delta = ((const uint8_t*)keys)[i]; break;
+        case 2: delta = ((const uint16_t*)keys)[i]; break;
+        case 4: delta = ((const uint32_t*)keys)[i]; break;
+        default: delta = ((const uint64_t*)keys)[i]; break;
+        }
+        if (delta >= target) break;
+    }
+    return i;
 }
 
+/**
+ * Search a key in a slotted leaf.
+ * \return Index of the first key not less than \p key .
+ */
+static int _slotted_search(const page_t *page, int64_t key) {
+    if (page->slotted_page.num_of_keys == 0 || key <= page->slotted_page.key_base) {
+        return 0;
+    }
+    return _count_less(_slotted_keys(page), page->slotted_page.key_width
+        , page->slotted_page.num_of_keys, (uint64_t)key - (uint64_t)page->slotted_page.key_base);
+}
 
 /**
- * Find the record containing input ‘key’.
- * If found matching ‘key’, store matched ‘value’ string in ret_val and return 0.
- * Otherwise, return non-zero value.
- * Memory allocation for record structure(ret_val) should occur in caller function.
- * If ret_val is NULL, just find whether there is the key or not.
- * 
- * \param trx_id transaction id indicating owner transaction of this operation.
- *                 If 0, this operation is not performed by transaction.
- * 
- * \return OPERATION_SUCCESS if operation is successfully done 
- *           and the transaction can continue the next operation.
- *         OPERATION_ABORTED if operation is failed (e.g., deadlock detected) 
- *           and the transaction should be aborted. In this case, all aborting task
- *           must be performed in this function.
- *         OPERATION_NOTFOUND if there is no key corresponding to given key in table.
- *           Fail but the trx can continue the next operation.
+ * Size of a slotted leaf. Leaves written before page sizes were configurable have 0.
  */
-int db_find(int table_id, int64_t key, char * ret_val, int trx_id) {
-    int i;
-    pagenum_t leaf, root;
-    buffer_t *tmp_page;
+static inline uint32_t _slotted_page_size(const page_t *page) {
+    return page->slotted_page.page_size ? page->slotted_page.page_size : ON_DISK_PAGE_SIZE;
+}
 
-    auto low = std::lower_bound(trx_system_t::table.begin(), trx_system_t::table.end(), trx_id,
-    [](const trx_t *lhs, const int &tid) {
-        return lhs->tid < tid;
-    });
+/**
+ * Make given page an empty slotted leaf of \p page_size bytes.
+ * Page LSN is kept.
+ */
+static void _slotted_init(page_t *page, uint32_t page_size, pagenum_t parent, pagenum_t right_sibling) {
+    page->slotted_page.parent_pagenum = parent;
+    page->slotted_page.is_leaf = LEAF_SLOTTED;
+    page->slotted_page.num_of_keys = 0;
+    page->slotted_page.page_size = page_size;
+    page->slotted_page.data_offset = page_size;
+    page->slotted_page.data_size = 0;
+    page->slotted_page.key_base = 0;
+    page->slotted_page.key_width = 1;
+    page->slotted_page.right_sibling_pagenum = right_sibling;
+}
 
-    trx_t *trx = *low;
-    while (true) {
-        tmp_page = buf_get_page(table_id, 0);
-        root = tmp_page->frame.header_page.root_pagenum;
-        buf_put_page(tmp_page, 0);
+/**
+ * Move payloads of a slotted leaf to the end of the page,
+ * so that all free bytes are between the slots and the payloads.
+ */
+static void _slotted_compact(page_t *page) {
+    char data[MAX_PAGE_SIZE];
+    leaf_slot *slots = _slotted_slots(page);
+    uint32_t page_size = _slotted_page_size(page), offset = page_size;
+    int i;
 
-        leaf = _find_leaf(table_id, root, key);
-        if (leaf == 0) return OPERATION_NOTFOUND;
+    for (i = 0; i < page->slotted_page.num_of_keys; ++i) {
+        offset -= slots[i].size;
+        memcpy(data + offset, (char*)page + slots[i].offset, slots[i].size);
+        slots[i].offset = offset;
+    }
+    memcpy((char*)page + offset, data + offset, page_size - offset);
+    page->slotted_page.data_offset = offset;
+}
 
-        tmp_page = buf_get_page(table_id, leaf);
-        for (i = 0; i < tmp_page->frame.leaf_page.num_of_keys; ++i) {
-            if (tmp_page->frame.leaf_page.records[i].key == key) break;
-        }
-        if (i == tmp_page->frame.leaf_page.num_of_keys) {
-            buf_put_page(tmp_page, 0);
-            return OPERATION_NOTFOUND;
-        } else {
-            int lock_result = acquire_lock(table_id, leaf, i, lock_mode_t::SHARED, trx);
+/**
+ * Rebuild a slotted leaf from sorted records.
+ * Key base and width are chosen for the records, and payloads are packed.
+ * \return Return 0 if success, or non-zero value if the records don't fit.
+ *   In that case, the page is not changed.
+ */
+static int _slotted_build(page_t *page, const int64_t *keys, const leaf_slot *slots
+        , const char * const *payloads, int num_of_keys) {
+    char data[MAX_PAGE_SIZE];
+    leaf_slot *new_slots;
+    uint32_t page_size = _slotted_page_size(page), offset = page_size, data_size = 0;
+    uint64_t base;
+    int width, i;
+
+    base = num_of_keys > 0 ? keys[0] : 0;
+    width = num_of_keys > 0 ? _key_width((uint64_t)keys[num_of_keys - 1] - base) : 1;
+    for (i = 0; i < num_of_keys; ++i) {
+        data_size += slots[i].size;
+    }
+    if (SLOTTED_HEADER_SIZE + _slotted_directory_size(num_of_keys, width) + data_size
+            > page_size) {
+        return 1;
+    }
 
-            if (lock_result == LOCK_SUCCESS) {
-                if (ret_val != NULL)
-                    strncpy(ret_val, tmp_page->frame.leaf_page.records[i].value, 120);
-                buf_put_page(tmp_page, 0);
-                return OPERATION_SUCCESS;
-            } else if (lock_result == LOCK_CONFLICT) {
-                buf_put_page(tmp_page, 0);
+    // Payloads may point into the page itself.
+    for (i = 0; i < num_of_keys; ++i) {
+        offset -= slots[i].size;
+        memcpy(data + offset, payloads[i], slots[i].size);
+    }
 
-                pthread_mutex_lock(&trx->trx_mutex);
-                pthread_cond_wait(&trx->trx_cond, &trx->trx_mutex);
+    page->slotted_page.num_of_keys = num_of_keys;
+    page->slotted_page.key_base = base;
+    page->slotted_page.key_width = width;
+    page->slotted_page.data_offset = offset;
+    page->slotted_page.data_size = data_size;
 
-                continue;
-            } else {
+    new_slots = _slotted_slots(page);
+    for (i = 0; i < num_of_keys; ++i) {
+        _set_key_delta(_slotted_keys(page), width, i, (uint64_t)keys[i] - base);
+        new_slots[i] = slots[i];
+    }
+    offset = page_size;
+    for (i = 0; i < num_of_keys; ++i) {
+        offset -= slots[i].size;
+        new_slots[i].offset = offset;
+    }
+    memcpy((char*)page + offset, data + offset, page_size - offset);
 
-            }
+    return 0;
+}
 
+/**
+ * Collect records of a slotted leaf with a new record at its position.
+ * Payloads point into \p page .
+ */
+static void _slotted_collect(const page_t *page, int64_t key, const char *payload
+        , uint32_t size, uint32_t length, std::vector<int64_t> &keys
+        , std::vector<leaf_slot> &slots, std::vector<const char*> &payloads) {
+    const leaf_slot *old_slots = _slotted_slots(page);
+    int num_of_keys = page->slotted_page.num_of_keys;
+    int insertion_index = _slotted_search(page, key);
+    leaf_slot slot;
+    int i;
 
+    for (i = 0; i <= num_of_keys; ++i) {
+        if (i == insertion_index) {
+            slot.offset = 0;
+            slot.size = size;
+            slot.length = length;
+            keys.push_back(key);
+            slots.push_back(slot);
+            payloads.push_back(payload);
+        }
+        if (i < num_of_keys) {
+            keys.push_back(_slotted_key(page, i));
+            slots.push_back(old_slots[i]);
+            payloads.push_back((const char*)page + old_slots[i].offset);
         }
     }
 }
 
-
 /**
- * Find the matching key and modify the values, where each value (column) never 
- * exceeds the existing one.
- * \return OPERATION_SUCCESS if operation is successfully done 
- *           and the transaction can continue the next operation.
- *         OPERATION_ABORTED if operation is failed (e.g., deadlock detected) 
- *           and the transaction should be aborted. In this case, all aborting task
- *           must be performed in this function.
- *         OPERATION_NOTFOUND if there is no key corresponding to given key in table.
- *           Fail but the trx can continue the next operation.
+ * Put a record into a slotted leaf.
+ * If free bytes are enough but fragmented, compact the page first.
+ * If the key doesn't fit in the key width, rebuild the page with a wider one.
+ * \param payload Bytes stored in the page, which is the value
+ *   or the first overflow page number of it.
+ * \param length Length of the value.
+ * \return Return 0 if success, or non-zero value if the leaf is full.
  */
-int db_update(int table_id, int64_t key, char *values, int trx_id) {
+static int _slotted_put(page_t *page, int64_t key
+        , const char *payload, uint32_t size, uint32_t length) {
+    std::vector<int64_t> keys;
+    std::vector<leaf_slot> all_slots;
+    std::vector<const char*> payloads;
+    page_t *old_page;
+    leaf_slot *slots, *new_slots;
+    char *keys_array;
+    int num_of_keys = page->slotted_page.num_of_keys;
+    int width = page->slotted_page.key_width;
+    int index, result;
+
+    if (num_of_keys == 0 || key < page->slotted_page.key_base
+            || _key_width((uint64_t)key - page->slotted_page.key_base) > width) {
+        old_page = new page_t;
+        memcpy(old_page, page, _slotted_page_size(page));
+        _slotted_collect(old_page, key, payload, size, length, keys, all_slots, payloads);
+        result = _slotted_build(page, keys.data(), all_slots.data(), payloads.data(), keys.size());
+        delete old_page;
+        return result;
+    }
 
-}
+    if (SLOTTED_HEADER_SIZE + _slotted_directory_size(num_of_keys + 1, width)
+            + page->slotted_page.data_size + size > _slotted_page_size(page)) {
+        return 1;
+    }
+    if (page->slotted_page.data_offset
+            < SLOTTED_HEADER_SIZE + _slotted_directory_size(num_of_keys + 1, width) + size) {
+        _slotted_compact(page);
+    }
 
+    page->slotted_page.data_offset -= size;
+    page->slotted_page.data_size += size;
+    memcpy((char*)page + page->slotted_page.data_offset, payload, size);
+
+    // Move slots to their place after the longer key array, opening a slot at index.
+    index = _slotted_search(page, key);
+    slots = _slotted_slots(page, num_of_keys, width);
+    new_slots = _slotted_slots(page, num_of_keys + 1, width);
+    memmove(new_slots + index + 1, slots + index, (num_of_keys - index) * sizeof(leaf_slot));
+    memmove(new_slots, slots, index * sizeof(leaf_slot));
+    new_slots[index].offset = page->slotted_page.data_offset;
+    new_slots[index].size = size;
+    new_slots[index].length = length;
+
+    keys_array = _slotted_keys(page);
+    memmove(keys_array + (index + 1) * width, keys_array + index * width, (num_of_keys - index) * width);
+    _set_key_delta(keys_array, width, index, (uint64_t)key - page->slotted_page.key_base);
+    ++page->slotted_page.num_of_keys;
+
+    return 0;
+}
 
 /**
- * Find the matching record and delete it if found.
- * \return If success, return 0. Otherwise, return non-zero value.
+ * Write a value to a new chain of overflow pages.
+ * Pages are written from the last one, so each knows its next page.
+ * \return Page number of the first overflow page.
  */
-int db_delete(int table_id, int64_t key) {
-    buffer_t *temp_page;
-    pagenum_t root, new_root;
-    char value[120];
+static pagenum_t _overflow_write(int table_id, const char *value, uint32_t length) {
+    pagenum_t page_number, next_pagenum = 0;
+    buffer_t *page;
+    uint32_t data_size = table_page_size[table_id] - OVERFLOW_HEADER_SIZE, size;
+    int i;
 
-    temp_page = buf_get_page(table_id, 0);
-    root = temp_page->frame.header_page.root_pagenum;
-    buf_put_page(temp_page, 0);
+    for (i = (length - 1) / data_size; i >= 0; --i) {
+        size = std::min<uint32_t>(data_size, length - i * data_size);
 
-    /* If there isn't given key in tree,
-     * deletion fails and return non-zero value
-     */
-    if (db_find(table_id, key, value, 0) != 0) {
-        return 1;
-    }
+        page_number = buf_alloc_page(table_id);
+        page = buf_get_page(table_id, page_number);
+        page->frame->overflow_page.next_pagenum = next_pagenum;
+        page->frame->overflow_page.size = size;
+        memcpy(page->frame->overflow_page.data, value + i * data_size, size);
+        buf_put_page(page, 1);
 
-    _delete_record(table_id, root, _find_leaf(table_id, root, key), key, value);
+        next_pagenum = page_number;
+    }
 
-    return 0;
+    return next_pagenum;
 }
 
+/**
+ * Read the first \p capacity bytes of a value in overflow pages.
+ * Pages after them are not read.
+ */
+static void _overflow_read(int table_id, pagenum_t page_number, char *dest, uint32_t capacity) {
+    buffer_t *page;
+    uint32_t size, done = 0;
+
+    while (page_number && done < capacity) {
+        page = buf_get_page(table_id, page_number);
+        size = std::min(page->frame->overflow_page.size, capacity - done);
+        memcpy(dest + done, page->frame->overflow_page.data, size);
+        done += size;
+        page_number = page->frame->overflow_page.next_pagenum;
+        buf_put_page(page, 0);
+    }
+}
 
-/** 
- * Write all pages of this table from buffer to disk
- *      and discard the table id.
- * \param table_id Indicating target table to be closed.
- * \return If success, return 0. Otherwise, return non-zero value.
+/**
+ * Free a chain of overflow pages.
  */
-int close_table(int table_id) {
-    return buf_close_table(table_id);
+static void _overflow_free(int table_id, pagenum_t page_number) {
+    buffer_t *page;
+    pagenum_t next_pagenum;
+
+    while (page_number) {
+        page = buf_get_page(table_id, page_number);
+        next_pagenum = page->frame->overflow_page.next_pagenum;
+        buf_put_page(page, 0);
+
+        buf_free_page(table_id, page_number);
+        page_number = next_pagenum;
+    }
 }
 
 /**
- * Flush all data from buffer and destroy allocated buffer.
- * \return If success, return 0. Otherwise, return non-zero value.
+ * Copy the first \p capacity bytes of the value of a slot.
+ * \return Length of the whole value.
  */
-int shutdown_db(void) {
-    return buf_shutdown_db();
+static uint32_t _slotted_read(int table_id, const page_t *page, int index
+        , char *dest, uint32_t capacity) {
+    const leaf_slot *slot = &_slotted_slots(page)[index];
+    pagenum_t first_pagenum;
+
+    if (slot->length > slot->size) {
+        memcpy(&first_pagenum, (const char*)page + slot->offset, sizeof(pagenum_t));
+        _overflow_read(table_id, first_pagenum, dest, std::min(slot->length, capacity));
+    } else {
+        memcpy(dest, (const char*)page + slot->offset, std::min(slot->length, capacity));
+    }
+    return slot->length;
 }
 
 /**
- * Do natural join with given two tables
- * and write result table to the file using given pathname.
- * Two tables should have been opened earlier.
- * 
- * Result file format should contain a line of 
- *      “a.key,a.value,b.key,b.value”
- * where each items are separated by comma.
- * 
- * \param table_id_1 table id of the first join target table.
- * \param table_id_2 table id of the second join target table.
- * \param pathname path name for result file.
- * 
- * \return Return 0 if success, otherwise return non-zero value.
+ * Remove the record at given index of a slotted leaf,
+ * and free its overflow pages.
+ * Its payload becomes a hole unless it is the lowest one.
  */
-int join_table(int table_id_1, int table_id_2, char * pathname) {
-    buffer_t *curr_page_1, *curr_page_2;
-    pagenum_t root_pagenum_1, root_pagenum_2, temp_pagenum;
-    buffer_t *header_1, *header_2;
-    int curr_rec_1 = 0, curr_rec_2 = 0;
-    FILE *output;
+static void _slotted_remove(int table_id, page_t *page, int index) {
+    int num_of_keys = page->slotted_page.num_of_keys;
+    int width = page->slotted_page.key_width;
+    leaf_slot *slots = _slotted_slots(page);
+    leaf_slot *new_slots = _slotted_slots(page, num_of_keys - 1, width);
+    char *keys = _slotted_keys(page);
+    pagenum_t first_pagenum;
+
+    if (slots[index].length > slots[index].size) {
+        memcpy(&first_pagenum, (char*)page + slots[index].offset, sizeof(pagenum_t));
+        _overflow_free(table_id, first_pagenum);
+    }
 
-    if (!pathname) {
-        return -1;
+    page->slotted_page.data_size -= slots[index].size;
+    if (slots[index].offset == page->slotted_page.data_offset) {
+        page->slotted_page.data_offset += slots[index].size;
     }
 
-    output = fopen(pathname, "w");
+    // Shorten the key array first. Slots may move down over its end.
+    memmove(keys + index * width, keys + (index + 1) * width, (num_of_keys - index - 1) * width);
+    memmove(new_slots, slots, index * sizeof(leaf_slot));
+    memmove(new_slots + index, slots + index + 1, (num_of_keys - index - 1) * sizeof(leaf_slot));
+    --page->slotted_page.num_of_keys;
+}
+
+/**
+ * Insert a record into a full slotted leaf by splitting it.
+ * Records are divided so that both leaves hold about the same number of bytes,
+ *   so fan-out of leaves follows the value sizes.
+ *   Each leaf chooses its own key base and width.
+ * \return Root page number of the tree after insertion.
+ */
+static pagenum_t _slotted_insert_after_split(int table_id, pagenum_t root, pagenum_t leaf
+        , int64_t key, const char *payload, uint32_t size, uint32_t length) {
+    pagenum_t new_leaf = buf_alloc_page(table_id);
+    buffer_t *leaf_page, *new_leaf_page;
+    page_t *old_page = new page_t;
+    std::vector<int64_t> keys;
+    std::vector<leaf_slot> slots;
+    std::vector<const char*> payloads;
+    uint32_t total = 0, bytes = 0;
+    int num_of_records, split;
+    int64_t new_key;
 
-    header_1 = buf_get_page(table_id_1, 0);
-    root_pagenum_1 = header_1->frame.header_page.root_pagenum;
-    buf_put_page(header_1, 0);
+    leaf_page = buf_get_page(table_id, leaf);
+    new_leaf_page = buf_get_page(table_id, new_leaf);
+    memcpy(old_page, leaf_page->frame, table_page_size[table_id]);
 
-    header_2 = buf_get_page(table_id_2, 0);
-    root_pagenum_2 = header_2->frame.header_page.root_pagenum;
-    buf_put_page(header_2, 0);
+    _slotted_collect(old_page, key, payload, size, length, keys, slots, payloads);
+    num_of_records = keys.size();
 
-    if (!root_pagenum_1 || !root_pagenum_2) {
-        fclose(output);
-        return 0;
+    // Split at the first record reaching half of the bytes, leaving one at least.
+    for (split = 0; split < num_of_records; ++split) {
+        total += sizeof(int64_t) + sizeof(leaf_slot) + slots[split].size;
+    }
+    for (split = 0; split < num_of_records - 1 && bytes * 2 < total; ++split) {
+        bytes += sizeof(int64_t) + sizeof(leaf_slot) + slots[split].size;
     }
+    split = std::max(split, 1);
 
-    curr_page_1 = buf_get_page(table_id_1, _find_leaf(table_id_1, root_pagenum_1, INT64_MIN));
-    curr_page_2 = buf_get_page(table_id_2, _find_leaf(table_id_2, root_pagenum_2, INT64_MIN));
+    _slotted_init(new_leaf_page->frame, table_page_size[table_id]
+        , old_page->slotted_page.parent_pagenum, old_page->slotted_page.right_sibling_pagenum);
+    _slotted_init(leaf_page->frame, table_page_size[table_id], old_page->slotted_page.parent_pagenum, new_leaf);
+    _slotted_build(leaf_page->frame, keys.data(), slots.data(), payloads.data(), split);
+    _slotted_build(new_leaf_page->frame, keys.data() + split, slots.data() + split
+        , payloads.data() + split, num_of_records - split);
+    new_key = keys[split];
+    delete old_page;
 
-    while (1) {
-        while (curr_page_1->frame.leaf_page.records[curr_rec_1].key
-                < curr_page_2->frame.leaf_page.records[curr_rec_2].key) {
-            
-            ++curr_rec_1;
-            if (curr_rec_1 >= curr_page_1->frame.leaf_page.num_of_keys) {
-                temp_pagenum = curr_page_1->frame.leaf_page.right_sibling_pagenum;
-                if (temp_pagenum == 0) {
-                    buf_put_page(curr_page_1, 0);
-                    buf_put_page(curr_page_2, 0);
-                    fclose(output);
-                    return 0;
-                }
-                buf_put_page(curr_page_1, 0);
-                curr_page_1 = buf_get_page(table_id_1, temp_pagenum);
-                curr_rec_1 = 0;
-            }
-        }
-        
-        while (curr_page_2->frame.leaf_page.records[curr_rec_2].key
-                < curr_page_1->frame.leaf_page.records[curr_rec_1].key) {
-            
-            ++curr_rec_2;
-            if (curr_rec_2 >= curr_page_2->frame.leaf_page.num_of_keys) {
-                temp_pagenum = curr_page_2->frame.leaf_page.right_sibling_pagenum;
-                if (temp_pagenum == 0) {
-                    buf_put_page(curr_page_1, 0);
-                    buf_put_page(curr_page_2, 0);
-                    fclose(output);
-                    return 0;
-                }
-                buf_put_page(curr_page_2, 0);
-                curr_page_2 = buf_get_page(table_id_2, temp_pagenum);
-                curr_rec_2 = 0;
-            }
-        }
+    buf_put_page(leaf_page, 1);
+    buf_put_page(new_leaf_page, 1);
 
-        if (curr_page_1->frame.leaf_page.records[curr_rec_1].key
-                == curr_page_2->frame.leaf_page.records[curr_rec_2].key) {
-            fprintf(output, "%ld,%s,%ld,%s\n"
-                , curr_page_1->frame.leaf_page.records[curr_rec_1].key
-                , curr_page_1->frame.leaf_page.records[curr_rec_1].value
-                , curr_page_2->frame.leaf_page.records[curr_rec_2].key
-                , curr_page_2->frame.leaf_page.records[curr_rec_2].value);
-
-            ++curr_rec_2;
-            if (curr_rec_2 >= curr_page_2->frame.leaf_page.num_of_keys) {
-                temp_pagenum = curr_page_2->frame.leaf_page.right_sibling_pagenum;
-                if (temp_pagenum == 0) {
-                    buf_put_page(curr_page_1, 0);
-                    buf_put_page(curr_page_2, 0);
-                    fclose(output);
-                    return 0;
-                }
-                buf_put_page(curr_page_2, 0);
-                curr_page_2 = buf_get_page(table_id_2, temp_pagenum);
-                curr_rec_2 = 0;
-            }
-        }
-    }
+    return _insert_into_parent(table_id, root, leaf, new_key, new_leaf);
+}
+
+/**
+ * Insert a record into a tree of slotted leaves.
+ * A value longer than SLOTTED_MAX_INLINE_SIZE goes to overflow pages.
+ * \return Root page number of the tree after insertion.
+ */
+static pagenum_t _slotted_insert(int table_id, pagenum_t root, int64_t key
+        , const char *value, uint32_t length) {
+    char overflow_payload[sizeof(pagenum_t)];
+    const char *payload = value;
+    uint32_t size = length;
+    pagenum_t leaf, first_pagenum;
+    buffer_t *leaf_page;
+
+    if (length > SLOTTED_MAX_INLINE_SIZE) {
+        first_pagenum = _overflow_write(table_id, value, length);
+        memcpy(overflow_payload, &first_pagenum, sizeof(pagenum_t));
+        payload = overflow_payload;
+        size = sizeof(pagenum_t);
+    }
+
+    // Case: the tree doesn't exist yet.
+    if (root == 0) {
+        root = buf_alloc_page(table_id);
+        leaf_page = buf_get_page(table_id, root);
+        _slotted_init(leaf_page->frame, table_page_size[table_id], 0, 0);
+        _slotted_put(leaf_page->frame, key, payload, size, length);
+        buf_put_page(leaf_page, 1);
+        return root;
+    }
+
+    leaf = _find_leaf(table_id, root, key);
+    leaf_page = buf_get_page(table_id, leaf);
+    if (_slotted_put(leaf_page->frame, key, payload, size, length) == 0) {
+        buf_put_page(leaf_page, 1);
+        return root;
+    }
+    buf_put_page(leaf_page, 0);
+
+    return _slotted_insert_after_split(table_id, root, leaf, key, payload, size, length);
+}
+
+/**
+ * Check that a table has fixed leaves, whose records joins read in place.
+ */
+static bool _fixed_leaves(int table_id) {
+    buffer_t *header = buf_get_page(table_id, 0);
+    bool fixed = header->frame->header_page.leaf_format != LEAF_SLOTTED;
+    buf_put_page(header, 0);
+    return fixed;
+}
+
+/**
+ * Key of a record of a leaf in either format.
+ */
+static inline int64_t _leaf_key(const page_t *page, int index) {
+    return page->leaf_page.is_leaf == LEAF_SLOTTED
+        ? _slotted_key(page, index) : page->leaf_page.records[index].key;
+}
+
+/**
+ * Value of a record of a leaf in either format, as a 120-byte value.
+ * A slotted value is cut or NUL-padded to 120 bytes in \p buffer .
+ * \return Pointer to the value.
+ */
+static const char *_leaf_value(int table_id, const page_t *page, int index, char *buffer) {
+    if (page->leaf_page.is_leaf != LEAF_SLOTTED) {
+        return page->leaf_page.records[index].value;
+    }
+    memset(buffer, 0, 120);
+    _slotted_read(table_id, page, index, buffer, 120);
+    return buffer;
+}
+
+
+// Key filters.
+
+/**
+ * Key filters of open tables. NULL means the table has no filter,
+ *   so every key is looked up in the tree.
+ */
+static filter_t *filters[MAX_TABLE_ID + 1];
+
+/**
+ * Whether the filter of a table is saved in its file.
+ * The file is deleted before the filter changes, so a stale one is never loaded.
+ */
+static bool filter_saved[MAX_TABLE_ID + 1];
+
+/**
+ * Build a filter of a table from the keys in its leaves.
+ */
+static filter_t *_filter_build(int table_id) {
+    std::vector<int64_t> keys;
+    filter_t *filter;
+    buffer_t *leaf_page;
+    pagenum_t root, num_of_pages, page_number;
+    int i;
+
+    _read_header(table_id, &root, &num_of_pages);
+    page_number = _find_leaf(table_id, root, INT64_MIN);
+    while (page_number) {
+        leaf_page = buf_get_page(table_id, page_number);
+        for (i = 0; i < leaf_page->frame->leaf_page.num_of_keys; ++i) {
+            keys.push_back(_leaf_key(leaf_page->frame, i));
+        }
+        page_number = leaf_page->frame->leaf_page.right_sibling_pagenum;
+        buf_put_page(leaf_page, 0);
+    }
+
+    filter = filter_create(keys.size());
+    for (int64_t key : keys) {
+        filter_add(filter, key);
+    }
+    return filter;
+}
+
+/**
+ * Give an opened table its filter, saved at the last clean close
+ *   or built from the table otherwise.
+ */
+static void _filter_open(int table_id) {
+    pagenum_t root, num_of_pages;
+
+    if (filters[table_id]) {
+        return;
+    }
+    _read_header(table_id, &root, &num_of_pages);
+    filters[table_id] = filter_load(stored_pathname[table_id], root, num_of_pages);
+    if (filters[table_id] == NULL) {
+        filters[table_id] = _filter_build(table_id);
+    }
+    filter_saved[table_id] = false;
+}
+
+/**
+ * Save the filter of a table, stamped with its root and number of pages.
+ * The stamp cannot tell a deleted key, so pages of the table must be
+ *   synced first. Then a saved filter is never missing a key on disk.
+ * The filter stays in memory, since the table may be used after shutdown_db.
+ * \param pathname Path name of the table.
+ * \param root Root page number read before the pages were flushed.
+ * \param num_of_pages Number of pages read with \p root .
+ */
+static void _filter_save(int table_id, const char *pathname, pagenum_t root, pagenum_t num_of_pages) {
+    if (!filters[table_id] || filter_saved[table_id]) {
+        return;
+    }
+    filter_saved[table_id] = filter_save(filters[table_id], pathname, root, num_of_pages) == 0;
+}
+
+/**
+ * Free the filter of a closed table.
+ */
+static void _filter_close(int table_id) {
+    if (!filters[table_id]) {
+        return;
+    }
+    filter_destroy(filters[table_id]);
+    filters[table_id] = NULL;
+    filter_saved[table_id] = false;
+}
+
+/**
+ * Delete the saved filter of a table, which is about to change.
+ */
+static void _filter_changing(int table_id) {
+    std::string path;
+
+    if (filter_saved[table_id]) {
+        path = std::string(stored_pathname[table_id]) + FILTER_FILE_SUFFIX;
+        unlink(path.c_str());
+        filter_saved[table_id] = false;
+    }
+}
+
+/**
+ * Test a key against the filter of a table.
+ * \return false if the key is surely not in the table.
+ */
+static inline bool _filter_may_contain(int table_id, int64_t key) {
+    return table_id < 1 || table_id > MAX_TABLE_ID || !filters[table_id]
+        || filter_may_contain(filters[table_id], key);
+}
+
+/**
+ * Add a key being inserted to the filter of a table.
+ * A full filter is rebuilt from the table first, sized for twice its keys.
+ */
+static void _filter_add(int table_id, int64_t key) {
+    filter_t *rebuilt;
+
+    if (!filters[table_id]) {
+        return;
+    }
+    _filter_changing(table_id);
+    if (filter_is_full(filters[table_id])) {
+        rebuilt = _filter_build(table_id);
+        filter_swap(filters[table_id], rebuilt);
+        filter_destroy(rebuilt);
+    }
+    filter_add(filters[table_id], key);
+}
+
+/**
+ * Remove a deleted key from the filter of a table.
+ */
+static void _filter_remove(int table_id, int64_t key) {
+    if (!filters[table_id]) {
+        return;
+    }
+    _filter_changing(table_id);
+    filter_remove(filters[table_id], key);
+}
+
+
+// External functions.
+
+/**
+ * A initializing function.
+ * Allocate the buffer pool (array) 
+ *   with the given number of entries by buf_num
+ *   by calling buffer initializing function in buffer management layer.
+ * Initialize other fields such as state info, LRU info, etc.
+ * If the log has records, recover tables in it from the last crash,
+ *   then start taking checkpoints in the background.
+ * \param buf_num Number of entries in the buffer pool.
+ *      Allocate with this number of buffers.
+ * \param log_path Path name of the write-ahead log file.
+ *      If NULL, logging is turned off.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int init_db(int num_buf, char *log_path) {
+    if (buf_init_db(num_buf) != 0) {
+        return 1;
+    }
+    if (log_path != NULL && (log_init(log_path) != 0 || recover() != 0
+            || checkpoint_start() != 0)) {
+        log_shutdown();
+        buf_shutdown_db();
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Open or Create a file(table) corresponding to pathname.
+ * If open this table for the first time,
+ *   set empty space of global array fd to file descriptor of opened file.
+ * Then store pathname in same index of global array stored_pathname.
+ * The index of empty space is allocate to this table for table id.
+ * Otherwise, just return unique table id.
+ * If logging is on, the binding of table id and pathname is logged.
+ * \param pathname path name for a file to be opened or created.
+ * \return If success, return unique table id of corresponding file to \p pathname .
+ *      Otherwise, return negative value.
+ */
+int open_table(char *pathname) {
+    int table_id = buf_open_table(pathname);
+    if (table_id > 0) {
+        log_write_table(table_id, pathname);
+        _filter_open(table_id);
+    }
+    return table_id;
+}
+
+/**
+ * Open an existing table read-only, for snapshots that are not changed.
+ * The file is mapped into memory, and pages are read in place from the mapping
+ *   without the buffer pool, so reads take no copy into a frame and no page latch.
+ * Finds, scans and joins work as usual. Inserts, deletes, updates
+ *   and table settings fail. The table is not logged, since it is never changed.
+ * The file must have been closed cleanly and must not be changed while mapped.
+ * \param pathname Path name of an existing table file, which must not be open already.
+ * \return If success, return unique table id of the table.
+ *      Otherwise, return negative value.
+ */
+int open_table_mapped(char *pathname) {
+    int table_id = buf_open_table_mapped(pathname);
+    if (table_id > 0) {
+        _filter_open(table_id);
+    }
+    return table_id;
+}
+
+
+/**
+ * Copy a value given by the user into a full 120-byte value.
+ * Values of a table with a schema are raw bytes, where columns may contain NUL.
+ *   Otherwise, values are strings, truncated to 119 characters and NUL-padded.
+ */
+static void _copy_value(char *dest, const char *src, bool typed) {
+    if (typed) {
+        memcpy(dest, src, 120);
+    } else {
+        strncpy(dest, src, 119);
+        dest[119] = '\0';
+    }
+}
+
+/**
+ * Insert input ‘key/value’ (record) to data file at the right place.
+ * If success, return 0. Otherwise, return non-zero value.
+ */
+int db_insert(int table_id, int64_t key, char * value) {
+    buffer_t *tmp_page;
+    pagenum_t root, leaf, new_root;
+    int leaf_num_keys;
+    char new_value[120];
+    bool typed, slotted;
+
+    // Mapped tables are read-only.
+    if (file_is_mapped(table_id)) {
+        return 1;
+    }
+
+    tmp_page = buf_get_page(table_id, 0);
+    root = tmp_page->frame->header_page.root_pagenum;
+    typed = tmp_page->frame->header_page.num_of_columns > 0;
+    slotted = tmp_page->frame->header_page.leaf_format == LEAF_SLOTTED;
+    buf_put_page(tmp_page, 0);
+
+    _copy_value(new_value, value, typed);
+    value = new_value;
+
+    // Slotted leaves store untyped values without padding.
+    if (slotted) {
+        return db_insert_value(table_id, key, value, typed ? 120 : strlen(value));
+    }
+
+    // No duplicates.
+    if (db_find(table_id, key, NULL, 0) == 0)
+        return 1;
+    _filter_add(table_id, key);
+    
+    /* Case: the tree doesn't exist yet.
+     * Start new tree with given record.
+     */
+    if (root == 0) {
+        new_root = _start_new_tree(table_id, key, value);
+        tmp_page = buf_get_page(table_id, 0);
+        tmp_page->frame->header_page.root_pagenum = new_root;
+        buf_put_page(tmp_page, 1);
+        return 0;
+    }
+    // Tree already exists.
+
+    leaf = _find_leaf(table_id, root, key);
+
+    // Read leaf page to tmp_page
+    tmp_page = buf_get_page(table_id, leaf);
+
+    /* Case: leaf has some space to store a new record.
+     */
+    leaf_num_keys = tmp_page->frame->leaf_page.num_of_keys;
+    buf_put_page(tmp_page, 0);
+    if (leaf_num_keys < _leaf_order(table_id) - 1) {
+        _insert_into_leaf(table_id, leaf, key, value);
+        return 0;
+    }
+
+    /* Case: leaf must be split.
+     */
+
+    new_root = _insert_into_leaf_after_split(table_id, root, leaf, key, value);
+    if (root != new_root) {
+        tmp_page = buf_get_page(table_id, 0);
+        tmp_page->frame->header_page.root_pagenum = new_root;
+        buf_put_page(tmp_page, 1);
+    }
+    return 0;
+}
+
+
+/**
+ * Find the record containing input ‘key’.
+ * If found matching ‘key’, store matched ‘value’ string in ret_val and return 0.
+ * Otherwise, return non-zero value.
+ * Memory allocation for record structure(ret_val) should occur in caller function.
+ * If ret_val is NULL, just find whether there is the key or not.
+ * 
+ * \param trx_id transaction id indicating owner transaction of this operation.
+ *                 If 0, this operation is not performed by transaction.
+ *                 If the transaction is read-only, the value in its snapshot
+ *                 is returned without acquiring lock.
+ * 
+ * \return OPERATION_SUCCESS if operation is successfully done 
+ *           and the transaction can continue the next operation.
+ *         OPERATION_ABORTED if operation is failed (e.g., deadlock detected) 
+ *           and the transaction should be aborted. In this case, all aborting task
+ *           must be performed in this function.
+ *         OPERATION_NOTFOUND if there is no key corresponding to given key in table.
+ *           Fail but the trx can continue the next operation.
+ */
+int db_find(int table_id, int64_t key, char * ret_val, int trx_id) {
+    int i, lock_result;
+    pagenum_t leaf, root;
+    buffer_t *tmp_page;
+    trx_t *trx = nullptr;
+
+    if (trx_id != 0) {
+        trx = trx_get(trx_id);
+        if (trx == nullptr) return OPERATION_ABORTED;
+    }
+    if (!_filter_may_contain(table_id, key)) return OPERATION_NOTFOUND;
+    buf_advise(table_id, false);
+
+    while (true) {
+        tmp_page = buf_get_page(table_id, 0);
+        root = tmp_page->frame->header_page.root_pagenum;
+        buf_put_page(tmp_page, 0);
+
+        leaf = _find_leaf(table_id, root, key);
+        if (leaf == 0) return OPERATION_NOTFOUND;
+
+        tmp_page = buf_get_page(table_id, leaf);
+
+        /* Case: slotted leaf. Its values are never updated in place,
+         * so they are read without lock. The value is cut or NUL-padded to 120 bytes.
+         */
+        if (tmp_page->frame->leaf_page.is_leaf == LEAF_SLOTTED) {
+            i = _slotted_search(tmp_page->frame, key);
+            if (i == tmp_page->frame->slotted_page.num_of_keys
+                    || _slotted_key(tmp_page->frame, i) != key) {
+                buf_put_page(tmp_page, 0);
+                return OPERATION_NOTFOUND;
+            }
+            if (ret_val != NULL) {
+                memset(ret_val, 0, 120);
+                _slotted_read(table_id, tmp_page->frame, i, ret_val, 120);
+            }
+            buf_put_page(tmp_page, 0);
+            return OPERATION_SUCCESS;
+        }
+
+        for (i = 0; i < tmp_page->frame->leaf_page.num_of_keys; ++i) {
+            if (tmp_page->frame->leaf_page.records[i].key == key) break;
+        }
+        if (i == tmp_page->frame->leaf_page.num_of_keys) {
+            buf_put_page(tmp_page, 0);
+            return OPERATION_NOTFOUND;
+        }
+
+        /* Case: not a transaction, or a read-only transaction.
+         * Read without lock. A read-only transaction reads the version
+         * of its snapshot. Page latch is held while reading version store,
+         * so writers can't slip in between.
+         */
+        if (trx == nullptr || trx->read_only) {
+            if (ret_val != NULL) {
+                memcpy(ret_val, tmp_page->frame->leaf_page.records[i].value, 120);
+                if (trx) version_read(table_id, key, trx->read_ts, ret_val);
+            }
+            buf_put_page(tmp_page, 0);
+            return OPERATION_SUCCESS;
+        }
+
+        lock_result = acquire_lock(table_id, leaf, i, lock_mode_t::SHARED, trx);
+
+        if (lock_result == LOCK_SUCCESS) {
+            if (ret_val != NULL)
+                memcpy(ret_val, tmp_page->frame->leaf_page.records[i].value, 120);
+            buf_put_page(tmp_page, 0);
+            return OPERATION_SUCCESS;
+        } else if (lock_result == LOCK_CONFLICT) {
+            buf_put_page(tmp_page, 0);
+            lock_wait(trx);
+            continue;
+        } else {
+            buf_put_page(tmp_page, 0);
+            abort_trx(trx);
+            return OPERATION_ABORTED;
+        }
+    }
+}
+
+
+/**
+ * Find the matching key and modify the values, where each value (column) never 
+ * exceeds the existing one.
+ * \return OPERATION_SUCCESS if operation is successfully done 
+ *           and the transaction can continue the next operation.
+ *         OPERATION_ABORTED if operation is failed (e.g., deadlock detected) 
+ *           and the transaction should be aborted. In this case, all aborting task
+ *           must be performed in this function.
+ *         OPERATION_NOTFOUND if there is no key corresponding to given key in table,
+ *           or the table has slotted leaves, whose values are not updated in place,
+ *           or the table is mapped read-only.
+ *           Fail but the trx can continue the next operation.
+ */
+int db_update(int table_id, int64_t key, char *values, int trx_id) {
+    int i, lock_result;
+    pagenum_t leaf, root;
+    buffer_t *tmp_page;
+    trx_t *trx;
+    undo_log_t undo_log;
+    char new_value[120];
+    char *value;
+    uint64_t lsn;
+    bool slotted;
+
+    trx = trx_get(trx_id);
+    if (trx == nullptr) return OPERATION_ABORTED;
+    if (trx->read_only) {
+        abort_trx(trx);
+        return OPERATION_ABORTED;
+    }
+
+    tmp_page = buf_get_page(table_id, 0);
+    _copy_value(new_value, values, tmp_page->frame->header_page.num_of_columns > 0);
+    slotted = tmp_page->frame->header_page.leaf_format == LEAF_SLOTTED;
+    buf_put_page(tmp_page, 0);
+
+    if (slotted || file_is_mapped(table_id)) return OPERATION_NOTFOUND;
+    if (!_filter_may_contain(table_id, key)) return OPERATION_NOTFOUND;
+
+    while (true) {
+        tmp_page = buf_get_page(table_id, 0);
+        root = tmp_page->frame->header_page.root_pagenum;
+        buf_put_page(tmp_page, 0);
+
+        leaf = _find_leaf(table_id, root, key);
+        if (leaf == 0) return OPERATION_NOTFOUND;
+
+        tmp_page = buf_get_page(table_id, leaf);
+        for (i = 0; i < tmp_page->frame->leaf_page.num_of_keys; ++i) {
+            if (tmp_page->frame->leaf_page.records[i].key == key) break;
+        }
+        if (i == tmp_page->frame->leaf_page.num_of_keys) {
+            buf_put_page(tmp_page, 0);
+            return OPERATION_NOTFOUND;
+        }
+
+        lock_result = acquire_lock(table_id, leaf, i, lock_mode_t::EXCLUSIVE, trx);
+
+        if (lock_result == LOCK_CONFLICT) {
+            buf_put_page(tmp_page, 0);
+            lock_wait(trx);
+            continue;
+        } else if (lock_result != LOCK_SUCCESS) {
+            buf_put_page(tmp_page, 0);
+            abort_trx(trx);
+            return OPERATION_ABORTED;
+        }
+
+        /* Modify in place while the page is still latched.
+         * Before-image goes to the undo log and the version store,
+         * and the change is logged before the page can be written.
+         */
+        value = tmp_page->frame->leaf_page.records[i].value;
+
+        undo_log.table_id = table_id;
+        undo_log.page_number = leaf;
+        undo_log.record_index = i;
+        undo_log.prev_lsn = trx->last_lsn;
+        memcpy(undo_log.old_record, value, 120);
+        trx->undo_logs.push(undo_log);
+
+        version_push(trx, table_id, key, value);
+
+        lsn = log_write_update(trx, table_id, leaf
+            , value - (char*)tmp_page->frame, 120, value, new_value);
+        memcpy(value, new_value, 120);
+        if (lsn) tmp_page->frame->leaf_page.page_lsn = lsn;
+
+        buf_put_page(tmp_page, 1);
+        return OPERATION_SUCCESS;
+    }
+}
+
+
+/**
+ * Find the matching record and delete it if found.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int db_delete(int table_id, int64_t key) {
+    buffer_t *temp_page;
+    pagenum_t root, new_root;
+
+    // Mapped tables are read-only.
+    if (file_is_mapped(table_id)) {
+        return 1;
+    }
+
+    temp_page = buf_get_page(table_id, 0);
+    root = temp_page->frame->header_page.root_pagenum;
+    buf_put_page(temp_page, 0);
+
+    /* If there isn't given key in tree,
+     * deletion fails and return non-zero value
+     */
+    if (db_find(table_id, key, NULL, 0) != 0) {
+        return 1;
+    }
+
+    _delete_record(table_id, root, _find_leaf(table_id, root, key), key);
+    _filter_remove(table_id, key);
+
+    return 0;
+}
+
+
+/**
+ * Insert a record whose value has given length.
+ * In a table of slotted leaves, the value is stored as it is,
+ *   in overflow pages if it is longer than SLOTTED_MAX_INLINE_SIZE.
+ *   Otherwise, the value must fit in 120 bytes and is inserted with db_insert.
+ * \return If success, return 0. If the key exists, return 1.
+ *   Otherwise, return negative value.
+ */
+int db_insert_value(int table_id, int64_t key, const char *value, uint32_t length) {
+    buffer_t *header;
+    pagenum_t root, new_root;
+    char fixed_value[120];
+    bool slotted;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || file_is_mapped(table_id) || !value) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    root = header->frame->header_page.root_pagenum;
+    slotted = header->frame->header_page.leaf_format == LEAF_SLOTTED;
+    buf_put_page(header, 0);
+
+    if (!slotted) {
+        if (length > 120) return -1;
+        memset(fixed_value, 0, 120);
+        memcpy(fixed_value, value, length);
+        return db_insert(table_id, key, fixed_value);
+    }
+
+    // No duplicates.
+    if (db_find(table_id, key, NULL, 0) == 0)
+        return 1;
+    _filter_add(table_id, key);
+
+    new_root = _slotted_insert(table_id, root, key, value, length);
+    if (new_root != root) {
+        header = buf_get_page(table_id, 0);
+        header->frame->header_page.root_pagenum = new_root;
+        buf_put_page(header, 1);
+    }
+    return 0;
+}
+
+/**
+ * Find the value of given key with its length.
+ * Values of fixed leaves are 120 bytes long, or as long as the string if untyped.
+ * \param value Buffer to store the first \p capacity bytes of the value.
+ * \param length Length of the whole value is stored here,
+ *   which may be larger than \p capacity .
+ * \return If found, return 0. Otherwise, return non-zero value.
+ */
+int db_find_value(int table_id, int64_t key, char *value, uint32_t capacity, uint32_t *length) {
+    buffer_t *page;
+    pagenum_t root, leaf;
+    const char *fixed_value;
+    bool typed;
+    int i, result = OPERATION_NOTFOUND;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id]) {
+        return -1;
+    }
+    if (!_filter_may_contain(table_id, key)) return OPERATION_NOTFOUND;
+    buf_advise(table_id, false);
+
+    page = buf_get_page(table_id, 0);
+    root = page->frame->header_page.root_pagenum;
+    typed = page->frame->header_page.num_of_columns > 0;
+    buf_put_page(page, 0);
+
+    leaf = _find_leaf(table_id, root, key);
+    if (leaf == 0) return OPERATION_NOTFOUND;
+
+    page = buf_get_page(table_id, leaf);
+    if (page->frame->leaf_page.is_leaf == LEAF_SLOTTED) {
+        i = _slotted_search(page->frame, key);
+        if (i < page->frame->slotted_page.num_of_keys && _slotted_key(page->frame, i) == key) {
+            *length = _slotted_read(table_id, page->frame, i, value, capacity);
+            result = OPERATION_SUCCESS;
+        }
+    } else {
+        for (i = 0; i < page->frame->leaf_page.num_of_keys; ++i) {
+            if (page->frame->leaf_page.records[i].key == key) break;
+        }
+        if (i < page->frame->leaf_page.num_of_keys) {
+            fixed_value = page->frame->leaf_page.records[i].value;
+            *length = typed ? 120 : strnlen(fixed_value, 120);
+            memcpy(value, fixed_value, std::min(*length, capacity));
+            result = OPERATION_SUCCESS;
+        }
+    }
+    buf_put_page(page, 0);
+
+    return result;
+}
+
+
+/** 
+ * Write all pages of this table from buffer to disk
+ *      and discard the table id.
+ * \param table_id Indicating target table to be closed.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int close_table(int table_id) {
+    std::string pathname;
+    pagenum_t root = 0, num_of_pages = 0;
+    int result;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID) {
+        return buf_close_table(table_id);
+    }
+    // Later checkpoints must not bind a reused id to this path.
+    log_manager_t::table_lsns[table_id] = 0;
+    if (filters[table_id]) {
+        pathname = stored_pathname[table_id];
+        _read_header(table_id, &root, &num_of_pages);
+    }
+
+    result = buf_close_table(table_id);
+    // The filter is saved once the table is synced.
+    if (result == 0) {
+        _filter_save(table_id, pathname.c_str(), root, num_of_pages);
+    }
+    _filter_close(table_id);
+
+    return result;
+}
+
+/**
+ * Flush all data from buffer and destroy allocated buffer.
+ * Then take the last checkpoint, which has no dirty page,
+ *   write out remaining log and close the log file.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int shutdown_db(void) {
+    std::string pathnames[MAX_TABLE_ID + 1];
+    pagenum_t roots[MAX_TABLE_ID + 1], pages[MAX_TABLE_ID + 1];
+    int result, i;
+
+    checkpoint_stop();
+    // Stamps of filters are read while header pages are still in the buffer pool.
+    // Mapped tables are closed by buf_shutdown_db, so paths are kept here.
+    for (i = 1; i <= MAX_TABLE_ID; ++i) {
+        if (filters[i]) {
+            pathnames[i] = stored_pathname[i];
+            _read_header(i, &roots[i], &pages[i]);
+        }
+    }
+    result = buf_shutdown_db();
+    // Filters are saved once all tables are synced.
+    for (i = 1; i <= MAX_TABLE_ID; ++i) {
+        if (filters[i] && result == 0) {
+            _filter_save(i, pathnames[i].c_str(), roots[i], pages[i]);
+        }
+        if (!stored_pathname[i]) {
+            _filter_close(i);
+        }
+    }
+    if (log_enabled()) {
+        result |= checkpoint();
+    }
+    return log_shutdown() || result;
+}
+
+/**
+ * Move a merge join position to the first record whose key is at least \p target .
+ * Within a leaf, binary search from the current record.
+ * When the leaf runs out, go to the right sibling.
+ *   If \p jump is true and \p target is beyond the sibling too,
+ *   re-descend from the root with _find_leaf, so that a run of leaves
+ *   with no candidate costs one sibling read and a descent.
+ * \param page Latched leaf of the position. Put when leaving it.
+ * \param index Record index of the position.
+ * \return Latched leaf of the new position, or NULL if the table runs out.
+ */
+static buffer_t *_merge_seek(int table_id, pagenum_t root, buffer_t *page, int *index
+        , int64_t target, bool jump) {
+    pagenum_t next_pagenum;
+    int lo, hi, mid, num_of_keys;
+
+    while (1) {
+        lo = *index;
+        hi = page->frame->leaf_page.num_of_keys;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (page->frame->leaf_page.records[mid].key < target) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < page->frame->leaf_page.num_of_keys) {
+            *index = lo;
+            return page;
+        }
+
+        next_pagenum = page->frame->leaf_page.right_sibling_pagenum;
+        buf_put_page(page, 0);
+        if (next_pagenum == 0) {
+            return NULL;
+        }
+
+        page = buf_get_page(table_id, next_pagenum);
+        *index = 0;
+
+        num_of_keys = page->frame->leaf_page.num_of_keys;
+        if (jump && num_of_keys > 0 && page->frame->leaf_page.records[num_of_keys - 1].key < target) {
+            // target may fall in the gap after the sibling,
+            //   so _find_leaf may latch the sibling again.
+            buf_put_page(page, 0);
+            page = buf_get_page(table_id, _find_leaf(table_id, root, target));
+        }
+    }
+}
+
+/**
+ * Merge join over the leaf chains of two non-empty tables.
+ * Holds one leaf of each table at a time.
+ * The side behind leaps to the key of the other side with _merge_seek,
+ *   so a long run of non-matching leaves costs a descent instead of a leaf each.
+ */
+static void _merge_join(int table_id_1, pagenum_t root_pagenum_1
+        , int table_id_2, pagenum_t root_pagenum_2, join_output_t *output) {
+    buffer_t *curr_page_1, *curr_page_2;
+    int curr_rec_1 = 0, curr_rec_2 = 0;
+    int64_t key_1, key_2;
+
+    curr_page_1 = buf_get_page(table_id_1, _find_leaf(table_id_1, root_pagenum_1, INT64_MIN));
+    curr_page_1 = _merge_seek(table_id_1, root_pagenum_1, curr_page_1, &curr_rec_1, INT64_MIN, false);
+    if (curr_page_1 == NULL) return;
+
+    curr_page_2 = buf_get_page(table_id_2, _find_leaf(table_id_2, root_pagenum_2, INT64_MIN));
+    curr_page_2 = _merge_seek(table_id_2, root_pagenum_2, curr_page_2, &curr_rec_2, INT64_MIN, false);
+
+    while (curr_page_1 && curr_page_2) {
+        key_1 = curr_page_1->frame->leaf_page.records[curr_rec_1].key;
+        key_2 = curr_page_2->frame->leaf_page.records[curr_rec_2].key;
+
+        if (key_1 < key_2) {
+            curr_page_1 = _merge_seek(table_id_1, root_pagenum_1, curr_page_1, &curr_rec_1, key_2, true);
+        } else if (key_2 < key_1) {
+            curr_page_2 = _merge_seek(table_id_2, root_pagenum_2, curr_page_2, &curr_rec_2, key_1, true);
+        } else {
+            join_output_row(output, &curr_page_1->frame->leaf_page.records[curr_rec_1]
+                , &curr_page_2->frame->leaf_page.records[curr_rec_2]);
+            if (key_1 == INT64_MAX) break;
+
+            // Matches tend to be dense. Step through siblings.
+            curr_page_1 = _merge_seek(table_id_1, root_pagenum_1, curr_page_1, &curr_rec_1, key_1 + 1, false);
+            if (curr_page_1 == NULL) break;
+            curr_page_2 = _merge_seek(table_id_2, root_pagenum_2, curr_page_2, &curr_rec_2, key_2 + 1, false);
+        }
+    }
+
+    if (curr_page_1) buf_put_page(curr_page_1, 0);
+    if (curr_page_2) buf_put_page(curr_page_2, 0);
+}
+
+/**
+ * Key-only merge join of a non-empty table with another table.
+ * root_pagenum_2 0 means the second table is empty.
+ * Reads just keys from latched leaves, so no value is copied.
+ * The first table steps record by record only in ANTI mode;
+ *   otherwise both sides leap with _merge_seek like _merge_join.
+ * \param output Output for SEMI and ANTI keys, or NULL.
+ * \return Number of keys reported by \p mode .
+ */
+static int64_t _key_join(int table_id_1, pagenum_t root_pagenum_1
+        , int table_id_2, pagenum_t root_pagenum_2, join_mode_t mode, join_output_t *output) {
+    buffer_t *curr_page_1, *curr_page_2 = NULL;
+    int curr_rec_1 = 0, curr_rec_2 = 0;
+    int64_t key_1, key_2 = 0, count = 0;
+    bool self = table_id_1 == table_id_2, matched, leap;
+
+    // Every key matches itself, and a leaf cannot be latched twice.
+    if (self && mode == join_mode_t::ANTI) return 0;
+
+    curr_page_1 = buf_get_page(table_id_1, _find_leaf(table_id_1, root_pagenum_1, INT64_MIN));
+    curr_page_1 = _merge_seek(table_id_1, root_pagenum_1, curr_page_1, &curr_rec_1, INT64_MIN, false);
+    if (curr_page_1 == NULL) return 0;
+
+    if (!self && root_pagenum_2) {
+        curr_page_2 = buf_get_page(table_id_2, _find_leaf(table_id_2, root_pagenum_2, INT64_MIN));
+        curr_page_2 = _merge_seek(table_id_2, root_pagenum_2, curr_page_2, &curr_rec_2, INT64_MIN, false);
+    }
+
+    while (curr_page_1) {
+        key_1 = curr_page_1->frame->leaf_page.records[curr_rec_1].key;
+
+        if (curr_page_2) {
+            key_2 = curr_page_2->frame->leaf_page.records[curr_rec_2].key;
+            if (key_2 < key_1) {
+                curr_page_2 = _merge_seek(table_id_2, root_pagenum_2, curr_page_2, &curr_rec_2, key_1, true);
+                continue;
+            }
+        } else if (!self && mode != join_mode_t::ANTI) {
+            break;
+        }
+
+        matched = self || (curr_page_2 && key_2 == key_1);
+        if (matched != (mode == join_mode_t::ANTI)) {
+            ++count;
+            if (output) join_output_key(output, key_1);
+        }
+        if (key_1 == INT64_MAX) break;
+
+        leap = !matched && mode != join_mode_t::ANTI;
+        curr_page_1 = _merge_seek(table_id_1, root_pagenum_1, curr_page_1, &curr_rec_1
+            , leap ? key_2 : key_1 + 1, leap);
+    }
+
+    if (curr_page_1) buf_put_page(curr_page_1, 0);
+    if (curr_page_2) buf_put_page(curr_page_2, 0);
+
+    return count;
+}
+
+/**
+ * Do natural join with given two tables
+ * and write result table to the file using given pathname.
+ * Two tables should have been opened earlier.
+ * 
+ * Result file format should contain a line of 
+ *      “a.key,a.value,b.key,b.value”
+ * where each items are separated by comma.
+ * Or, fixed 256-byte rows if \p format is join_format_t::BINARY.
+ * The join method is chosen by join_choose_method.
+ * 
+ * \param table_id_1 table id of the first join target table.
+ * \param table_id_2 table id of the second join target table.
+ * \param pathname path name for result file.
+ * \param format Format of result file.
+ * 
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_table(int table_id_1, int table_id_2, char * pathname, join_format_t format) {
+    return join_table_with_method(table_id_1, table_id_2, pathname, join_method_t::AUTO, format);
+}
+
+/**
+ * Load a leaf into given cursor and point its first record.
+ * Skip empty leaves. If there is no more record, invalidate the cursor.
+ */
+static void _cursor_load(leaf_cursor_t *cursor, pagenum_t page_number) {
+    buffer_t *leaf_page;
+
+    cursor->index = 0;
+    while ((cursor->page_number = page_number) != 0) {
+        if (cursor->keep_pages && cursor->page->leaf_page.num_of_keys > 0) {
+            cursor->kept_pages.push_back(cursor->page);
+            cursor->page = new page_t;
+        }
+        leaf_page = buf_get_page(cursor->table_id, page_number);
+        memcpy(cursor->page, leaf_page->frame, table_page_size[cursor->table_id]);
+        buf_put_page(leaf_page, 0);
+
+        if (cursor->page->leaf_page.num_of_keys > 0) break;
+        page_number = cursor->page->leaf_page.right_sibling_pagenum;
+    }
+}
+
+/**
+ * Point given cursor to the first record whose key is at least \p key .
+ */
+static void _cursor_seek(leaf_cursor_t *cursor, int table_id, pagenum_t root, int64_t key) {
+    buf_advise(table_id, true);
+    cursor->table_id = table_id;
+    _cursor_load(cursor, _find_leaf(table_id, root, key));
+
+    while (cursor->page_number != 0
+            && cursor->page->leaf_page.records[cursor->index].key < key) {
+        if (++cursor->index >= cursor->page->leaf_page.num_of_keys) {
+            _cursor_load(cursor, cursor->page->leaf_page.right_sibling_pagenum);
+        }
+    }
+}
+
+/**
+ * Move given cursor to the next record.
+ */
+static void _cursor_next(leaf_cursor_t *cursor) {
+    if (++cursor->index >= cursor->page->leaf_page.num_of_keys) {
+        _cursor_load(cursor, cursor->page->leaf_page.right_sibling_pagenum);
+    }
+}
+
+/**
+ * Move given cursor to the first record whose key is at least \p key .
+ * Binary search within the current leaf, then the right sibling.
+ *   If the key is beyond the sibling too, re-descend from the root.
+ */
+static void _cursor_skip(leaf_cursor_t *cursor, pagenum_t root, int64_t key) {
+    int lo, hi, mid;
+    bool sibling = false;
+
+    while (cursor->page_number) {
+        lo = cursor->index;
+        hi = cursor->page->leaf_page.num_of_keys;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (cursor->page->leaf_page.records[mid].key < key) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < cursor->page->leaf_page.num_of_keys) {
+            cursor->index = lo;
+            return;
+        }
+        if (sibling) {
+            _cursor_seek(cursor, cursor->table_id, root, key);
+            return;
+        }
+        _cursor_load(cursor, cursor->page->leaf_page.right_sibling_pagenum);
+        sibling = true;
+    }
+}
+
+/**
+ * Get the record a valid cursor points to.
+ */
+static inline record *_cursor_record(leaf_cursor_t *cursor) {
+    return &cursor->page->leaf_page.records[cursor->index];
+}
+
+/**
+ * Collect keys from upper internal levels of a tree in key order.
+ * Go down level by level until a level has \p min_keys keys
+ *   or the next level is the leaf level.
+ * \param keys Collected keys are appended to this.
+ */
+static void _collect_split_keys(int table_id, pagenum_t root, size_t min_keys
+        , std::vector<int64_t> &keys) {
+    std::vector<pagenum_t> level, next_level;
+    std::vector<int64_t> level_keys;
+    buffer_t *node;
+    bool leaf_children;
+    int i;
+
+    if (root == 0) return;
+    level.push_back(root);
+
+    while (!level.empty()) {
+        level_keys.clear();
+        next_level.clear();
+
+        for (pagenum_t page_number : level) {
+            node = buf_get_page(table_id, page_number);
+            if (node->frame->internal_page.is_leaf) {
+                buf_put_page(node, 0);
+                return;
+            }
+            next_level.push_back(node->frame->internal_page.first_pagenum);
+            for (i = 0; i < node->frame->internal_page.num_of_keys; ++i) {
+                level_keys.push_back(node->frame->internal_page.entries[i].key);
+                next_level.push_back(node->frame->internal_page.entries[i].pagenum);
+            }
+            buf_put_page(node, 0);
+        }
+
+        if (level_keys.size() >= min_keys) break;
+
+        // Stop before reading the whole leaf level.
+        node = buf_get_page(table_id, next_level[0]);
+        leaf_children = node->frame->internal_page.is_leaf;
+        buf_put_page(node, 0);
+        if (leaf_children) break;
+
+        level.swap(next_level);
+    }
+
+    keys.insert(keys.end(), level_keys.begin(), level_keys.end());
+}
+
+/**
+ * Work of a parallel join thread.
+ * Join records with key in [lo, hi) of two tables.
+ */
+class join_partition_t {
+public:
+    int table_id_1;
+    int table_id_2;
+    pagenum_t root_1;
+    pagenum_t root_2;
+    int64_t lo;
+    int64_t hi;
+    bool bounded;
+    std::string path;
+    join_format_t format;
+    int result;
+    pthread_t thread;
+};
+
+/**
+ * Body of a parallel join thread.
+ * Merge join over its key range and write rows to its own file.
+ */
+static void *_join_partition_main(void *arg) {
+    join_partition_t *partition = (join_partition_t*)arg;
+    leaf_cursor_t *cursor_1, *cursor_2;
+    join_output_t output;
+    int64_t key_1, key_2;
+
+    if (join_output_open(&output, partition->path.c_str(), partition->format) != 0) {
+        partition->result = 1;
+        return NULL;
+    }
+    cursor_1 = new leaf_cursor_t();
+    cursor_2 = new leaf_cursor_t();
+
+    _cursor_seek(cursor_1, partition->table_id_1, partition->root_1, partition->lo);
+    _cursor_seek(cursor_2, partition->table_id_2, partition->root_2, partition->lo);
+
+    while (cursor_1->page_number && cursor_2->page_number) {
+        key_1 = _cursor_record(cursor_1)->key;
+        key_2 = _cursor_record(cursor_2)->key;
+        if (partition->bounded && (key_1 >= partition->hi || key_2 >= partition->hi)) break;
+
+        if (key_1 < key_2) {
+            _cursor_skip(cursor_1, partition->root_1, key_2);
+        } else if (key_2 < key_1) {
+            _cursor_skip(cursor_2, partition->root_2, key_1);
+        } else {
+            join_output_row(&output, _cursor_record(cursor_1), _cursor_record(cursor_2));
+            _cursor_next(cursor_1);
+            _cursor_next(cursor_2);
+        }
+    }
+
+    delete cursor_1;
+    delete cursor_2;
+    partition->result = join_output_close(&output);
+
+    return NULL;
+}
+
+/**
+ * Do natural join of given two tables with multiple threads.
+ * Split points are picked from the root and upper internal levels of both trees,
+ *   and each thread merge-joins one disjoint key range into its own file.
+ * The files are concatenated in key order, so the result is the same as join_table.
+ * \param num_threads Number of threads. If not positive, use one per online processor.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_table_parallel(int table_id_1, int table_id_2, char *pathname
+        , int num_threads, join_format_t format) {
+    std::vector<int64_t> keys, split_keys;
+    std::vector<join_partition_t> partitions;
+    std::vector<std::string> part_paths;
+    pagenum_t root_1, root_2;
+    buffer_t *header;
+    size_t i;
+    int result = 0;
+
+    if (!pathname || !_fixed_leaves(table_id_1) || !_fixed_leaves(table_id_2)) {
+        return -1;
+    }
+    if (num_threads <= 0) {
+        num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    header = buf_get_page(table_id_1, 0);
+    root_1 = header->frame->header_page.root_pagenum;
+    buf_put_page(header, 0);
+
+    header = buf_get_page(table_id_2, 0);
+    root_2 = header->frame->header_page.root_pagenum;
+    buf_put_page(header, 0);
+
+    _collect_split_keys(table_id_1, root_1, num_threads * JOIN_SPLIT_KEYS_PER_THREAD, keys);
+    _collect_split_keys(table_id_2, root_2, num_threads * JOIN_SPLIT_KEYS_PER_THREAD, keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    for (i = 1; i < (size_t)num_threads && !keys.empty(); ++i) {
+        int64_t key = keys[i * keys.size() / num_threads];
+        if (split_keys.empty() || split_keys.back() < key) {
+            split_keys.push_back(key);
+        }
+    }
+
+    partitions.resize(split_keys.size() + 1);
+    for (i = 0; i < partitions.size(); ++i) {
+        partitions[i].table_id_1 = table_id_1;
+        partitions[i].table_id_2 = table_id_2;
+        partitions[i].root_1 = root_1;
+        partitions[i].root_2 = root_2;
+        partitions[i].lo = i == 0 ? INT64_MIN : split_keys[i - 1];
+        partitions[i].bounded = i < split_keys.size();
+        partitions[i].hi = partitions[i].bounded ? split_keys[i] : INT64_MAX;
+        partitions[i].path = std::string(pathname) + ".part" + std::to_string(i);
+        partitions[i].format = format;
+        partitions[i].result = 0;
+        part_paths.push_back(partitions[i].path);
+    }
+
+    for (i = 0; i < partitions.size(); ++i) {
+        if (pthread_create(&partitions[i].thread, NULL, _join_partition_main, &partitions[i]) != 0) {
+            _join_partition_main(&partitions[i]);
+            partitions[i].thread = pthread_self();
+        }
+    }
+    for (i = 0; i < partitions.size(); ++i) {
+        if (!pthread_equal(partitions[i].thread, pthread_self())) {
+            pthread_join(partitions[i].thread, NULL);
+        }
+        result |= partitions[i].result;
+    }
+
+    return join_output_concat(pathname, part_paths) || result;
+}
+
+/**
+ * Get root page number and number of pages from the header page of a table.
+ */
+static void _read_header(int table_id, pagenum_t *root, pagenum_t *num_of_pages) {
+    buffer_t *header = buf_get_page(table_id, 0);
+    *root = header->frame->header_page.root_pagenum;
+    *num_of_pages = header->frame->header_page.num_of_pages;
+    buf_put_page(header, 0);
+}
+
+/**
+ * Choose how to join given two tables on their tree keys.
+ * Costs are in page reads, from page counts in the header pages.
+ *   Merge join reads every leaf of both tables.
+ *   Index nested-loop join reads every leaf of the smaller table
+ *   and a leaf of the larger table for each of its records,
+ *   assuming internal pages of the larger tree stay in the buffer pool.
+ * Hash join is never cheaper than merge join on tree keys.
+ */
+join_method_t join_choose_method(int table_id_1, int table_id_2) {
+    pagenum_t root_1, root_2, pages_1, pages_2, small_pages, large_pages;
+    double merge_cost, index_cost;
+
+    _read_header(table_id_1, &root_1, &pages_1);
+    _read_header(table_id_2, &root_2, &pages_2);
+
+    small_pages = std::min(pages_1, pages_2);
+    large_pages = std::max(pages_1, pages_2);
+
+    merge_cost = small_pages + large_pages;
+    index_cost = small_pages + (double)small_pages
+        * _leaf_order(pages_1 <= pages_2 ? table_id_1 : table_id_2) / 2 * JOIN_PROBE_COST;
+
+    return index_cost < merge_cost ? join_method_t::INDEX_NESTED_LOOP : join_method_t::MERGE;
+}
+
+/**
+ * Index nested-loop join.
+ * Scan the outer table and probe the inner tree for each key.
+ * The last inner leaf is kept, so runs of keys in one leaf cost one descent.
+ * \param outer_is_first If true, outer records go to the first columns of rows.
+ */
+static void _index_nested_loop_join(int outer_table_id, pagenum_t outer_root
+        , int inner_table_id, pagenum_t inner_root, bool outer_is_first, join_output_t *output) {
+    leaf_cursor_t *outer = new leaf_cursor_t();
+    page_t *inner = new page_t;
+    pagenum_t inner_leaf = 0;
+    buffer_t *leaf_page;
+    record *outer_rec, *inner_rec;
+    int64_t key;
+    int lo, hi, mid, num_of_keys = 0;
+
+    _cursor_seek(outer, outer_table_id, outer_root, INT64_MIN);
+
+    for (; outer->page_number; _cursor_next(outer)) {
+        outer_rec = _cursor_record(outer);
+        key = outer_rec->key;
+
+        if (inner_leaf == 0 || num_of_keys == 0
+                || key < inner->leaf_page.records[0].key
+                || key > inner->leaf_page.records[num_of_keys - 1].key) {
+            inner_leaf = _find_leaf(inner_table_id, inner_root, key);
+            leaf_page = buf_get_page(inner_table_id, inner_leaf);
+            memcpy(inner, leaf_page->frame, table_page_size[inner_table_id]);
+            buf_put_page(leaf_page, 0);
+            num_of_keys = inner->leaf_page.num_of_keys;
+        }
+
+        lo = 0;
+        hi = num_of_keys;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (inner->leaf_page.records[mid].key < key) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == num_of_keys || inner->leaf_page.records[lo].key != key) continue;
+
+        inner_rec = &inner->leaf_page.records[lo];
+        if (outer_is_first) join_output_row(output, outer_rec, inner_rec);
+        else join_output_row(output, inner_rec, outer_rec);
+    }
+
+    delete outer;
+    delete inner;
+}
+
+/**
+ * Key extractor of hash join on tree keys.
+ */
+static int64_t _tree_key(const record *rec) {
+    return rec->key;
+}
+
+/**
+ * Hash of a join key to choose its partition.
+ * Independent from the hash of the in-memory hash table.
+ */
+static inline uint64_t _partition_hash(int64_t key) {
+    return ((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32;
+}
+
+/**
+ * Scan a table and distribute its records to partition files by join key.
+ * Each partition is buffered in JOIN_HASH_SPILL_RECORDS records.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _hash_partition(int table_id, pagenum_t root, join_key_t key_of
+        , const std::vector<int> &fds) {
+    std::vector<std::vector<record>> buffers(fds.size());
+    leaf_cursor_t *cursor = new leaf_cursor_t();
+    size_t p, bytes;
+    int result = 0;
+
+    for (_cursor_seek(cursor, table_id, root, INT64_MIN); cursor->page_number; _cursor_next(cursor)) {
+        p = _partition_hash(key_of(_cursor_record(cursor))) % fds.size();
+        buffers[p].push_back(*_cursor_record(cursor));
+        if (buffers[p].size() == JOIN_HASH_SPILL_RECORDS) {
+            bytes = buffers[p].size() * sizeof(record);
+            result |= write(fds[p], buffers[p].data(), bytes) != (ssize_t)bytes;
+            buffers[p].clear();
+        }
+    }
+    for (p = 0; p < fds.size(); ++p) {
+        bytes = buffers[p].size() * sizeof(record);
+        result |= bytes && write(fds[p], buffers[p].data(), bytes) != (ssize_t)bytes;
+    }
+
+    delete cursor;
+    return result;
+}
+
+/**
+ * Read a whole partition file.
+ */
+static int _read_partition(int fd, std::vector<record> &records) {
+    off_t size = lseek(fd, 0, SEEK_END);
+
+    records.resize(size / sizeof(record));
+    return pread(fd, records.data(), size, 0) != size;
+}
+
+/**
+ * Grace hash join.
+ * Both tables are partitioned by hash of their join keys into files,
+ *   so that each partition of the build side fits in JOIN_HASH_MEMORY_SIZE.
+ *   Then each build partition is loaded into a hash table
+ *   and probed by the matching partition of the other side.
+ * If the build side fits in memory, nothing is written to files.
+ * \param build_is_first If true, the first table is the build side.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _hash_join(int table_id_1, pagenum_t root_1, join_key_t key_of_1
+        , int table_id_2, pagenum_t root_2, join_key_t key_of_2
+        , pagenum_t build_pages, bool build_is_first, const char *pathname, join_output_t *output) {
+    int build_table_id = build_is_first ? table_id_1 : table_id_2;
+    int probe_table_id = build_is_first ? table_id_2 : table_id_1;
+    pagenum_t build_root = build_is_first ? root_1 : root_2;
+    pagenum_t probe_root = build_is_first ? root_2 : root_1;
+    join_key_t build_key_of = build_is_first ? key_of_1 : key_of_2;
+    join_key_t probe_key_of = build_is_first ? key_of_2 : key_of_1;
+    std::unordered_multimap<int64_t, record> table;
+    std::vector<int> build_fds, probe_fds;
+    std::vector<record> records;
+    leaf_cursor_t *cursor;
+    size_t num_partitions, p;
+    std::string part_path;
+    int fd, result = 0;
+
+    num_partitions = (build_pages * table_page_size[build_table_id] + JOIN_HASH_MEMORY_SIZE - 1) / JOIN_HASH_MEMORY_SIZE;
+    num_partitions = std::max((size_t)1, std::min(num_partitions, (size_t)JOIN_HASH_MAX_PARTITIONS));
+
+    auto probe = [&](const record *probe_rec) {
+        auto range = table.equal_range(probe_key_of(probe_rec));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (build_is_first) join_output_row(output, &it->second, probe_rec);
+            else join_output_row(output, probe_rec, &it->second);
+        }
+    };
+
+    // In-memory hash join.
+    if (num_partitions == 1) {
+        cursor = new leaf_cursor_t();
+        for (_cursor_seek(cursor, build_table_id, build_root, INT64_MIN); cursor->page_number; _cursor_next(cursor)) {
+            table.emplace(build_key_of(_cursor_record(cursor)), *_cursor_record(cursor));
+        }
+        for (_cursor_seek(cursor, probe_table_id, probe_root, INT64_MIN); cursor->page_number; _cursor_next(cursor)) {
+            probe(_cursor_record(cursor));
+        }
+        delete cursor;
+        return 0;
+    }
+
+    // Partition files are removed as soon as they are created.
+    for (p = 0; p < 2 * num_partitions; ++p) {
+        part_path = std::string(pathname) + ".hash" + std::to_string(p);
+        fd = open(part_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+            result = 1;
+            break;
+        }
+        unlink(part_path.c_str());
+        (p < num_partitions ? build_fds : probe_fds).push_back(fd);
+    }
+
+    if (result == 0) {
+        result |= _hash_partition(build_table_id, build_root, build_key_of, build_fds);
+        result |= _hash_partition(probe_table_id, probe_root, probe_key_of, probe_fds);
+    }
+
+    for (p = 0; result == 0 && p < num_partitions; ++p) {
+        result |= _read_partition(build_fds[p], records);
+        table.clear();
+        table.reserve(records.size());
+        for (const record &build_rec : records) {
+            table.emplace(build_key_of(&build_rec), build_rec);
+        }
+
+        result |= _read_partition(probe_fds[p], records);
+        for (const record &probe_rec : records) {
+            probe(&probe_rec);
+        }
+    }
+
+    for (int part_fd : build_fds) close(part_fd);
+    for (int part_fd : probe_fds) close(part_fd);
+
+    return result;
+}
+
+/**
+ * Do natural join with given two tables with given join method.
+ * Rows are in key order except with join_method_t::HASH.
+ * \param method Join method. AUTO asks join_choose_method.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_table_with_method(int table_id_1, int table_id_2, char *pathname
+        , join_method_t method, join_format_t format) {
+    pagenum_t root_1, root_2, pages_1, pages_2;
+    join_output_t output;
+    int result = 0;
+
+    if (!pathname || !_fixed_leaves(table_id_1) || !_fixed_leaves(table_id_2)
+            || join_output_open(&output, pathname, format) != 0) {
+        return -1;
+    }
+
+    _read_header(table_id_1, &root_1, &pages_1);
+    _read_header(table_id_2, &root_2, &pages_2);
+
+    if (!root_1 || !root_2) {
+        return join_output_close(&output);
+    }
+
+    if (method == join_method_t::AUTO) {
+        method = join_choose_method(table_id_1, table_id_2);
+    }
+
+    switch (method) {
+    case join_method_t::INDEX_NESTED_LOOP:
+        if (pages_1 <= pages_2) {
+            _index_nested_loop_join(table_id_1, root_1, table_id_2, root_2, true, &output);
+        } else {
+            _index_nested_loop_join(table_id_2, root_2, table_id_1, root_1, false, &output);
+        }
+        break;
+    case join_method_t::HASH:
+        result = _hash_join(table_id_1, root_1, _tree_key, table_id_2, root_2, _tree_key
+            , std::min(pages_1, pages_2), pages_1 <= pages_2, pathname, &output);
+        break;
+    default:
+        _merge_join(table_id_1, root_1, table_id_2, root_2, &output);
+        break;
+    }
+
+    return join_output_close(&output) || result;
+}
+
+/**
+ * Do equi-join of given two tables on keys extracted from their records,
+ *   e.g., a field in the value, with grace hash join.
+ * The smaller table by page count is the build side. Rows are in no particular order.
+ * \param key_of_1 Join key of a record of the first table.
+ * \param key_of_2 Join key of a record of the second table.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_table_hash(int table_id_1, int table_id_2, char *pathname
+        , join_key_t key_of_1, join_key_t key_of_2, join_format_t format) {
+    pagenum_t root_1, root_2, pages_1, pages_2;
+    join_output_t output;
+    int result = 0;
+
+    if (!pathname || !key_of_1 || !key_of_2 || !_fixed_leaves(table_id_1) || !_fixed_leaves(table_id_2)
+            || join_output_open(&output, pathname, format) != 0) {
+        return -1;
+    }
+
+    _read_header(table_id_1, &root_1, &pages_1);
+    _read_header(table_id_2, &root_2, &pages_2);
+
+    if (root_1 && root_2) {
+        result = _hash_join(table_id_1, root_1, key_of_1, table_id_2, root_2, key_of_2
+            , std::min(pages_1, pages_2), pages_1 <= pages_2, pathname, &output);
+    }
+
+    return join_output_close(&output) || result;
+}
+
+/**
+ * Start a pull-based merge join of given two tables.
+ * \return Return the iterator, or NULL if a table is not opened.
+ *   Release it with join_iterator_close.
+ */
+join_iterator_t *join_iterator_open(int table_id_1, int table_id_2) {
+    join_iterator_t *iterator;
+    pagenum_t pages_1, pages_2;
+
+    if (table_id_1 < 1 || table_id_1 > MAX_TABLE_ID || !stored_pathname[table_id_1]
+            || table_id_2 < 1 || table_id_2 > MAX_TABLE_ID || !stored_pathname[table_id_2]
+            || !_fixed_leaves(table_id_1) || !_fixed_leaves(table_id_2)) {
+        return NULL;
+    }
+
+    iterator = new join_iterator_t();
+    _read_header(table_id_1, &iterator->root_1, &pages_1);
+    _read_header(table_id_2, &iterator->root_2, &pages_2);
+    iterator->cursor_1.keep_pages = true;
+    iterator->cursor_2.keep_pages = true;
+    iterator->done = !iterator->root_1 || !iterator->root_2;
+
+    if (!iterator->done) {
+        _cursor_seek(&iterator->cursor_1, table_id_1, iterator->root_1, INT64_MIN);
+        _cursor_seek(&iterator->cursor_2, table_id_2, iterator->root_2, INT64_MIN);
+    }
+
+    return iterator;
+}
+
+/**
+ * Get the next batch of joined rows without copying values.
+ * Values point into leaf copies owned by the iterator,
+ *   so they are valid only until the next call on \p iterator .
+ * \param tuples Array to store at most \p max_tuples rows.
+ * \return Number of rows stored. 0 means the join is over.
+ */
+int join_iterator_next(join_iterator_t *iterator, join_tuple_t *tuples, int max_tuples) {
+    leaf_cursor_t *cursor_1 = &iterator->cursor_1, *cursor_2 = &iterator->cursor_2;
+    int64_t key_1, key_2;
+    int count = 0;
+
+    // Rows of the previous batch are consumed.
+    leaf_cursor_release(cursor_1);
+    leaf_cursor_release(cursor_2);
+
+    while (count < max_tuples && !iterator->done) {
+        if (!cursor_1->page_number || !cursor_2->page_number) {
+            iterator->done = true;
+            break;
+        }
+
+        key_1 = _cursor_record(cursor_1)->key;
+        key_2 = _cursor_record(cursor_2)->key;
+        if (key_1 < key_2) {
+            _cursor_skip(cursor_1, iterator->root_1, key_2);
+        } else if (key_2 < key_1) {
+            _cursor_skip(cursor_2, iterator->root_2, key_1);
+        } else {
+            tuples[count].key = key_1;
+            tuples[count].value_1 = _cursor_record(cursor_1)->value;
+            tuples[count].value_2 = _cursor_record(cursor_2)->value;
+            ++count;
+            _cursor_next(cursor_1);
+            _cursor_next(cursor_2);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Get the next batch of joined rows, copied into given buffer.
+ * \param rows Array to store at most \p max_rows rows.
+ * \return Number of rows stored. 0 means the join is over.
+ */
+int join_iterator_next_copy(join_iterator_t *iterator, join_row_t *rows, int max_rows) {
+    join_tuple_t tuples[ORDER_OF_LEAF];
+    int count = 0, batch, i;
+
+    while (count < max_rows) {
+        batch = join_iterator_next(iterator, tuples, std::min(max_rows - count, ORDER_OF_LEAF));
+        if (batch == 0) break;
+
+        for (i = 0; i < batch; ++i, ++count) {
+            rows[count].key = tuples[i].key;
+            memcpy(rows[count].value_1, tuples[i].value_1, sizeof(rows[count].value_1));
+            memcpy(rows[count].value_2, tuples[i].value_2, sizeof(rows[count].value_2));
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Finish a join started by join_iterator_open.
+ */
+void join_iterator_close(join_iterator_t *iterator) {
+    delete iterator;
+}
+
+/**
+ * Do natural join of \p num_tables tables in one pass
+ *   and write rows where all keys match to the file using given pathname.
+ * Leaf cursors of all tables leapfrog each other:
+ *   each one in turn skips to the largest key seen so far,
+ *   so no intermediate result is built.
+ * \param table_ids Ids of tables to join. Tables should have been opened earlier.
+ * \param format Format of result file. Rows list records in the order of \p table_ids .
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_tables(int *table_ids, int num_tables, char *pathname, join_format_t format) {
+    leaf_cursor_t *cursors;
+    std::vector<const record*> recs(num_tables > 0 ? num_tables : 0);
+    std::vector<pagenum_t> roots(recs.size());
+    join_output_t output;
+    pagenum_t pages;
+    int64_t target = 0, key;
+    int i, matched = 1;
+    bool empty = false;
+
+    if (!table_ids || num_tables < 1 || num_tables > MAX_TABLE_ID || !pathname) {
+        return -1;
+    }
+    for (i = 0; i < num_tables; ++i) {
+        if (table_ids[i] < 1 || table_ids[i] > MAX_TABLE_ID || !stored_pathname[table_ids[i]]
+                || !_fixed_leaves(table_ids[i])) {
+            return -1;
+        }
+    }
+    if (join_output_open(&output, pathname, format) != 0) {
+        return -1;
+    }
+
+    cursors = new leaf_cursor_t[num_tables];
+    for (i = 0; i < num_tables && !empty; ++i) {
+        _read_header(table_ids[i], &roots[i], &pages);
+        if (roots[i]) {
+            _cursor_seek(&cursors[i], table_ids[i], roots[i], INT64_MIN);
+        }
+        empty = !roots[i] || !cursors[i].page_number;
+    }
+
+    i = 0;
+    if (!empty) {
+        target = _cursor_record(&cursors[0])->key;
+    }
+    while (!empty) {
+        if (matched == num_tables) {
+            for (int j = 0; j < num_tables; ++j) {
+                recs[j] = _cursor_record(&cursors[j]);
+            }
+            join_output_row_n(&output, recs.data(), num_tables);
+            if (target == INT64_MAX) break;
+
+            _cursor_next(&cursors[i]);
+            if (!cursors[i].page_number) break;
+            target = _cursor_record(&cursors[i])->key;
+            matched = 1;
+            continue;
+        }
+
+        i = (i + 1) % num_tables;
+        _cursor_skip(&cursors[i], roots[i], target);
+        if (!cursors[i].page_number) break;
+
+        key = _cursor_record(&cursors[i])->key;
+        if (key == target) {
+            ++matched;
+        } else {
+            target = key;
+            matched = 1;
+        }
+    }
+
+    delete[] cursors;
+
+    return join_output_close(&output);
+}
+
+/**
+ * Do key-only join of given two tables.
+ * SEMI and ANTI write keys of the first table to the file using given pathname
+ *   in key order. COUNT writes no file, and \p pathname may be NULL.
+ * \param mode What to report about keys of the first table.
+ * \param num_rows If not NULL, store the number of keys reported.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int join_table_mode(int table_id_1, int table_id_2, char *pathname, join_mode_t mode
+        , int64_t *num_rows, join_format_t format) {
+    pagenum_t root_1, root_2, pages_1, pages_2;
+    join_output_t output;
+    bool writes = mode != join_mode_t::COUNT;
+    int64_t count = 0;
+
+    if (table_id_1 < 1 || table_id_1 > MAX_TABLE_ID || !stored_pathname[table_id_1]
+            || table_id_2 < 1 || table_id_2 > MAX_TABLE_ID || !stored_pathname[table_id_2]
+            || !_fixed_leaves(table_id_1) || !_fixed_leaves(table_id_2)) {
+        return -1;
+    }
+    if (writes && (!pathname || join_output_open(&output, pathname, format) != 0)) {
+        return -1;
+    }
+
+    _read_header(table_id_1, &root_1, &pages_1);
+    _read_header(table_id_2, &root_2, &pages_2);
+
+    if (root_1) {
+        count = _key_join(table_id_1, root_1, table_id_2, root_2, mode, writes ? &output : NULL);
+    }
+
+    if (num_rows) *num_rows = count;
+
+    return writes ? join_output_close(&output) : 0;
+}
+
+/**
+ * Start a scan of records with key in [lo, hi] of given table.
+ * Like joins, scans read leaves without record locks.
+ * \param decode Decoder of the value column. If NULL, values are not decoded.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_open(scan_t *scan, int table_id, int64_t lo, int64_t hi, scan_decode_t decode) {
+    pagenum_t root, pages;
+    buffer_t *leaf;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id]) {
+        return -1;
+    }
+
+    buf_advise(table_id, true);
+    scan->table_id = table_id;
+    scan->decode = decode;
+    scan->value_offset = -1;
+    scan->hi = hi;
+    scan->index = 0;
+
+    _read_header(table_id, &root, &pages);
+    scan->page_number = lo <= hi ? _find_leaf(table_id, root, lo) : 0;
+    if (scan->page_number == 0) {
+        return 0;
+    }
+
+    leaf = buf_get_page(table_id, scan->page_number);
+    while (scan->index < leaf->frame->leaf_page.num_of_keys
+            && _leaf_key(leaf->frame, scan->index) < lo) {
+        ++scan->index;
+    }
+    buf_put_page(leaf, 0);
+
+    return 0;
+}
+
+/**
+ * Read the next rows of a scan into a column batch.
+ * Each leaf is latched once, and keys and decoded values of all its records
+ *   are copied out while it is latched.
+ * Every row of the batch is selected.
+ * \return Number of rows read. 0 means the scan is over.
+ */
+int scan_next(scan_t *scan, scan_batch_t *batch) {
+    buffer_t *leaf;
+    page_t *page;
+    char buffer[120];
+    int num_of_keys, i, n = 0;
+
+    while (scan->page_number && n < SCAN_BATCH_SIZE) {
+        leaf = buf_get_page(scan->table_id, scan->page_number);
+        page = leaf->frame;
+        num_of_keys = page->leaf_page.num_of_keys;
+
+        // Take the whole leaf, or what fits in the batch.
+        if (num_of_keys - scan->index > SCAN_BATCH_SIZE - n) {
+            num_of_keys = scan->index + SCAN_BATCH_SIZE - n;
+        }
+        for (i = scan->index; i < num_of_keys && _leaf_key(page, i) <= scan->hi; ++i, ++n) {
+            batch->keys[n] = _leaf_key(page, i);
+        }
+        if (scan->decode) {
+            for (int j = scan->index; j < i; ++j) {
+                batch->values[n - i + j] = scan->decode(_leaf_value(scan->table_id, page, j, buffer));
+            }
+        } else if (scan->value_offset >= 0) {
+            for (int j = scan->index; j < i; ++j) {
+                memcpy(&batch->values[n - i + j]
+                    , _leaf_value(scan->table_id, page, j, buffer) + scan->value_offset, sizeof(int64_t));
+            }
+        }
+
+        if (i < num_of_keys) {
+            // Upper bound reached.
+            scan->page_number = 0;
+        } else if (i < leaf->frame->leaf_page.num_of_keys) {
+            scan->index = i;
+        } else {
+            scan->page_number = leaf->frame->leaf_page.right_sibling_pagenum;
+            scan->index = 0;
+        }
+        buf_put_page(leaf, 0);
+    }
+
+    for (i = 0; i < n; ++i) {
+        batch->selection[i] = 1;
+    }
+    batch->size = n;
+
+    return n;
+}
+
+/**
+ * Aggregate a column over the rest of an opened scan, filtered by all predicates.
+ * Rows are filtered and aggregated a batch at a time.
+ * \param column Column to aggregate.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_aggregate(scan_t *scan, const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t column, scan_aggregate_t *aggregate) {
+    scan_batch_t *batch;
+
+    scan_aggregate_init(aggregate);
+
+    batch = new scan_batch_t;
+    while (scan_next(scan, batch) > 0) {
+        scan_filter(batch, predicates, num_predicates);
+        scan_aggregate_batch(aggregate, batch, column);
+    }
+    delete batch;
+
+    return 0;
+}
+
+/**
+ * Aggregate a column over records of given table with key in [lo, hi]
+ *   that satisfy all predicates, e.g.,
+ *   SELECT COUNT(*), SUM(v), MIN(v), MAX(v) FROM t WHERE lo <= key <= hi AND ...
+ * \param decode Decoder of the value column. NULL if no predicate or aggregate uses values.
+ * \param column Column to aggregate.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_table_aggregate(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t column, scan_aggregate_t *aggregate) {
+    scan_t scan;
+
+    scan_aggregate_init(aggregate);
+    if (scan_open(&scan, table_id, lo, hi, decode) != 0) {
+        return -1;
+    }
+
+    return scan_aggregate(&scan, predicates, num_predicates, column, aggregate);
+}
+
+/**
+ * Group the rest of an opened scan, filtered by all predicates,
+ *   and aggregate a column per group.
+ * Groups that do not fit in GROUP_MEMORY_SIZE spill to a temporary table
+ *   "<table path>.group.<pid>.<serial>", which takes a table id while the query runs.
+ * \param group_column Column to group by.
+ * \param aggregate_column Column to aggregate.
+ * \param emit Called once per group in no particular order.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_group(scan_t *scan, const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t group_column, scan_column_t aggregate_column
+        , group_emit_t emit, void *arg) {
+    group_aggregator_t *aggregator;
+    temp_table_t spill;
+    scan_batch_t *batch;
+    int result;
+
+    if (!emit) {
+        return -1;
+    }
+
+    temp_table_init(&spill, stored_pathname[scan->table_id], ".group");
+    aggregator = new group_aggregator_t();
+    if (group_aggregator_init(aggregator, &spill, 0) != 0) {
+        delete aggregator;
+        return -1;
+    }
+
+    batch = new scan_batch_t;
+    while (scan_next(scan, batch) > 0) {
+        scan_filter(batch, predicates, num_predicates);
+        group_aggregator_add(aggregator
+            , group_column == scan_column_t::KEY ? batch->keys : batch->values
+            , aggregate_column == scan_column_t::KEY ? batch->keys : batch->values
+            , batch->selection, batch->size);
+    }
+    delete batch;
+
+    result = group_aggregator_finish(aggregator, emit, arg);
+    delete aggregator;
+    result |= temp_table_drop(&spill);
+
+    return result;
+}
+
+/**
+ * Group records of given table with key in [lo, hi] that satisfy all predicates
+ *   and aggregate a column per group, e.g.,
+ *   SELECT g, COUNT(*), SUM(v) FROM t WHERE ... GROUP BY g HAVING ...
+ * \param group_column Column to group by.
+ * \param aggregate_column Column to aggregate.
+ * \param emit Called once per group in no particular order.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_table_group(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , scan_column_t group_column, scan_column_t aggregate_column
+        , group_emit_t emit, void *arg) {
+    scan_t scan;
+
+    if (scan_open(&scan, table_id, lo, hi, decode) != 0) {
+        return -1;
+    }
+
+    return scan_group(&scan, predicates, num_predicates, group_column, aggregate_column, emit, arg);
+}
+
+/**
+ * Sort records of given table with key in [lo, hi] that satisfy all predicates, e.g.,
+ *   SELECT * FROM t WHERE ... ORDER BY v
+ * Runs go to a temporary table "<table path>.sort.<pid>.<serial>",
+ *   which takes a table id while the query runs.
+ * Fails if concurrent sorts already hold their share of the buffer pool.
+ * \param decode Decoder of the value column for predicates. NULL if none uses values.
+ * \param order Sort order. Equal rows stay in key order.
+ * \param emit Called once per row in sort order.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_table_sort(int table_id, int64_t lo, int64_t hi, scan_decode_t decode
+        , const scan_predicate_t *predicates, int num_predicates
+        , const sort_order_t *order, sort_emit_t emit, void *arg) {
+    temp_table_t temp;
+    scan_batch_t *batch;
+    sort_t *sort;
+    page_t *leaf;
+    buffer_t *leaf_page;
+    pagenum_t root, pages, page_number;
+    record rec;
+    int i, first, num_of_keys, result;
+    bool done = false;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || !order || !emit) {
+        return -1;
+    }
+    buf_advise(table_id, true);
+
+    temp_table_init(&temp, stored_pathname[table_id], ".sort");
+    sort = new sort_t();
+    if (sort_init(sort, order, &temp) != 0) {
+        delete sort;
+        temp_table_drop(&temp);
+        return -1;
+    }
+
+    _read_header(table_id, &root, &pages);
+    page_number = lo <= hi ? _find_leaf(table_id, root, lo) : 0;
+    batch = new scan_batch_t;
+    leaf = new page_t;
+
+    while (page_number && !done) {
+        leaf_page = buf_get_page(table_id, page_number);
+        memcpy(leaf, leaf_page->frame, table_page_size[table_id]);
+        buf_put_page(leaf_page, 0);
+
+        // Filter the leaf in batches. Slotted leaves of large pages exceed one batch.
+        num_of_keys = leaf->leaf_page.num_of_keys;
+        first = 0;
+        while (first < num_of_keys && _leaf_key(leaf, first) < lo) {
+            ++first;
+        }
+        while (first < num_of_keys && !done) {
+            for (i = first; i < num_of_keys && i - first < SCAN_BATCH_SIZE; ++i) {
+                if (_leaf_key(leaf, i) > hi) {
+                    done = true;
+                    break;
+                }
+                batch->keys[i - first] = _leaf_key(leaf, i);
+                batch->values[i - first] = decode ? decode(_leaf_value(table_id, leaf, i, rec.value)) : 0;
+            }
+            batch->size = i - first;
+            scan_filter(batch, predicates, num_predicates);
+
+            for (i = 0; i < batch->size; ++i) {
+                if (!batch->selection[i]) continue;
+                if (leaf->leaf_page.is_leaf == LEAF_SLOTTED) {
+                    rec.key = batch->keys[i];
+                    _leaf_value(table_id, leaf, first + i, rec.value);
+                    sort_add(sort, &rec);
+                } else {
+                    sort_add(sort, &leaf->leaf_page.records[first + i]);
+                }
+            }
+            first += batch->size;
+        }
+        page_number = leaf->leaf_page.right_sibling_pagenum;
+    }
+    delete leaf;
+    delete batch;
+
+    result = sort_finish(sort, emit, arg);
+    delete sort;
+    result |= temp_table_drop(&temp);
+
+    return result;
+}
+
+/**
+ * Set the schema of an empty table.
+ * Columns are packed into the value in order and stored in the header page.
+ *   From then on, values of the table are raw 120-byte buffers.
+ * \param columns Columns with type, name and width of CHAR columns.
+ *   Offsets and widths are filled in.
+ * \param num_columns Number of columns. 0 makes values untyped strings again.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int db_set_schema(int table_id, column_def *columns, int num_columns) {
+    buffer_t *header;
+    int result = 0;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || file_is_mapped(table_id)
+            || (num_columns > 0 && !columns) || schema_layout(columns, num_columns) != 0) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    if (header->frame->header_page.root_pagenum != 0) {
+        // Existing values would be reinterpreted.
+        result = -1;
+    } else {
+        header->frame->header_page.num_of_columns = num_columns;
+        memcpy(header->frame->header_page.columns, columns, num_columns * sizeof(column_def));
+    }
+    buf_put_page(header, result == 0);
+
+    return result;
+}
+
+/**
+ * Get the schema of a table.
+ * \param columns Array of MAX_COLUMNS columns to store the schema.
+ * \return Number of columns, 0 if values are untyped, or -1 if the table is not opened.
+ */
+int db_get_schema(int table_id, column_def *columns) {
+    buffer_t *header;
+    int num_columns;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id]) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    num_columns = header->frame->header_page.num_of_columns;
+    memcpy(columns, header->frame->header_page.columns, num_columns * sizeof(column_def));
+    buf_put_page(header, 0);
+
+    return num_columns;
+}
+
+/**
+ * Start a scan whose value column is an INT column of the table schema.
+ * The column is copied from its offset, with no parsing.
+ * \param column Index of the column in the schema.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int scan_open_column(scan_t *scan, int table_id, int64_t lo, int64_t hi, int column) {
+    column_def columns[MAX_COLUMNS];
+    int num_columns = db_get_schema(table_id, columns);
+
+    if (column < 0 || column >= num_columns || columns[column].type != COLUMN_TYPE_INT
+            || scan_open(scan, table_id, lo, hi, NULL) != 0) {
+        return -1;
+    }
+    scan->value_offset = columns[column].offset;
+
+    return 0;
+}
+
+/**
+ * Set the leaf format of an empty table. It is stored in the header page.
+ * Slotted leaves hold values of any length behind a slot directory,
+ *   with values longer than SLOTTED_MAX_INLINE_SIZE in overflow pages.
+ *   Values are not updated in place, and joins don't take these tables.
+ *   Scans and sorts see values cut or NUL-padded to 120 bytes.
+ * \param format LEAF_FIXED or LEAF_SLOTTED.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int db_set_leaf_format(int table_id, int format) {
+    buffer_t *header;
+    int result = 0;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || file_is_mapped(table_id)
+            || (format != LEAF_FIXED && format != LEAF_SLOTTED)) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    if (header->frame->header_page.root_pagenum != 0) {
+        // Existing leaves would be reinterpreted.
+        result = -1;
+    } else {
+        header->frame->header_page.leaf_format = format;
+    }
+    buf_put_page(header, result == 0);
+
+    return result;
+}
+
+/**
+ * Set whether pages of an empty table are compressed on disk.
+ * Compressed pages take slots of PAGE_SLOT_UNIT bytes tracked by a page map,
+ *   so half-full pages and padded values take less disk space.
+ *   Pages are compressed when written and decompressed when read,
+ *   so pages in the buffer pool are not changed.
+ * The table must have no page but the header page.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int db_set_compression(int table_id, bool compress) {
+    buffer_t *header;
+    pagenum_t num_of_pages;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || file_is_mapped(table_id)) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    num_of_pages = header->frame->header_page.num_of_pages;
+    buf_put_page(header, 0);
+    if (num_of_pages != 1) {
+        // Pages are allocated already.
+        return -1;
+    }
+
+    return buf_set_compression(table_id, compress);
+}
+
+/**
+ * Set the page size of an empty table.
+ * Larger pages give higher orders, so trees are shallower
+ *   and scans read more records for each page.
+ *   Smaller pages waste less of the buffer pool on random access.
+ * The size is stored in the header page, and the file is rewritten with it.
+ * The table must have no page but the header page.
+ * \param page_size Power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int db_set_page_size(int table_id, uint32_t page_size) {
+    buffer_t *header;
+    pagenum_t num_of_pages;
+
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id] || file_is_mapped(table_id)
+            || page_size < MIN_PAGE_SIZE || page_size > MAX_PAGE_SIZE
+            || (page_size & (page_size - 1)) != 0) {
+        return -1;
+    }
+
+    header = buf_get_page(table_id, 0);
+    num_of_pages = header->frame->header_page.num_of_pages;
+    buf_put_page(header, 0);
+    if (num_of_pages != 1) {
+        // Pages are allocated already.
+        return -1;
+    }
+
+    return buf_set_page_size(table_id, page_size);
+}
+
+/**
+ * Turn direct I/O of an open table on or off.
+ * With direct I/O, pages bypass the OS page cache,
+ *   so memory holds each page once, in the buffer pool,
+ *   and reads and writes take the time of the device.
+ * This is a mode of the open table, not stored in the file,
+ *   and may be set any time after the table is opened.
+ * Compressed and mapped tables can't use direct I/O.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int db_set_direct_io(int table_id, bool direct) {
+    if (table_id < 1 || table_id > MAX_TABLE_ID || !stored_pathname[table_id]) {
+        return -1;
+    }
+
+    return buf_set_direct_io(table_id, direct);
 }
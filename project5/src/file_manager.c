@@ -1,4 +1,10 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sys/mman.h>
+
 #include "file_manager.h"
+#include "page_codec.h"
 
 // CONSTANTS.
 
@@ -8,6 +14,11 @@
  */
 const uint64_t ON_DISK_PAGE_SIZE = 4096;
 
+/**
+ * Capacities of slots in units. A page takes at most this many units.
+ */
+#define PAGE_SLOT_CLASSES (MAX_PAGE_SIZE / PAGE_SLOT_UNIT)
+
 
 // GLOBALS.
 
@@ -28,6 +39,372 @@ int fd[MAX_TABLE_ID + 1] = { -1 };
  */
 char *stored_pathname[MAX_TABLE_ID + 1] = {};
 
+/** 
+ * Page sizes of opened tables.
+ * Use table id (1 ~ MAX_TABLE_ID) for index.
+ */
+uint32_t table_page_size[MAX_TABLE_ID + 1] = {};
+
+/**
+ * Slot list of a compressed table file, used as a stack.
+ */
+typedef struct {
+    uint32_t *offsets;
+    size_t size;
+    size_t capacity;
+} slot_list;
+
+/**
+ * Extent of slots, for rebuilding free slots and for released slots.
+ */
+typedef struct {
+    uint32_t offset;
+    uint32_t units;
+} slot_extent;
+
+/**
+ * In-memory state of a compressed table file.
+ * Free slots are kept by capacity in units,
+ *   and rebuilt from gaps between used slots when the file is opened.
+ * Released slots were left by pages that moved.
+ *   They become free once the new map entries are synced.
+ * Latch orders slot moves and page map updates of the table.
+ */
+typedef struct {
+    pthread_mutex_t latch;
+    page_map_superblock superblock;
+    page_map_entry *map[PAGE_MAP_MAX_BLOCKS];
+    uint32_t end_unit;
+    slot_list free_slots[PAGE_SLOT_CLASSES + 1];
+    slot_extent *released;
+    size_t num_released;
+} compressed_file;
+
+/** 
+ * State of compressed tables.
+ * NULL means the table file is not compressed.
+ * Use table id (1 ~ MAX_TABLE_ID) for index.
+ */
+static compressed_file *compressed[MAX_TABLE_ID + 1];
+
+/**
+ * Read-only mapping of a table file.
+ * advice is the last advice given to madvise, which is not repeated.
+ */
+typedef struct {
+    char *addr;
+    size_t length;
+    int advice;
+} mapped_file;
+
+/** 
+ * Mappings of tables opened by file_open_mapped.
+ * NULL means the table file is not mapped.
+ * Use table id (1 ~ MAX_TABLE_ID) for index.
+ */
+static mapped_file *mapped[MAX_TABLE_ID + 1];
+
+
+/**
+ * Units of the superblock and of a map block.
+ */
+static uint32_t _block_units(void) {
+    return PAGE_MAP_BLOCK_SIZE / PAGE_SLOT_UNIT;
+}
+
+static void _push_slot(slot_list *list, uint32_t offset) {
+    if (list->size == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->offsets = realloc(list->offsets, list->capacity * sizeof(uint32_t));
+    }
+    list->offsets[list->size++] = offset;
+}
+
+/**
+ * Free slots in given range of units.
+ * A range longer than a page is cut into page-sized slots.
+ */
+static void _free_slots(compressed_file *file, uint32_t offset, uint32_t units) {
+    uint32_t capacity;
+
+    while (units > 0) {
+        capacity = units < PAGE_SLOT_CLASSES ? units : PAGE_SLOT_CLASSES;
+        _push_slot(&file->free_slots[capacity], offset);
+        offset += capacity;
+        units -= capacity;
+    }
+}
+
+/**
+ * Allocate a slot of given units.
+ * Take a free slot of the same capacity, or split a larger one.
+ *   If there is none, append the slot to the end of the file.
+ * \return Offset of the slot in units.
+ */
+static uint32_t _alloc_slot(compressed_file *file, uint32_t units) {
+    uint32_t capacity, offset;
+
+    for (capacity = units; capacity <= PAGE_SLOT_CLASSES; ++capacity) {
+        if (file->free_slots[capacity].size > 0) {
+            offset = file->free_slots[capacity].offsets[--file->free_slots[capacity].size];
+            _free_slots(file, offset + units, capacity - units);
+            return offset;
+        }
+    }
+
+    offset = file->end_unit;
+    file->end_unit += units;
+    return offset;
+}
+
+static void _write_superblock(int table_id, compressed_file *file) {
+    pwrite(fd[table_id], &file->superblock, sizeof(page_map_superblock), 0);
+}
+
+static void _write_map_entry(int table_id, compressed_file *file, pagenum_t pagenum) {
+    uint32_t block = pagenum / PAGE_MAP_ENTRIES_PER_BLOCK, index = pagenum % PAGE_MAP_ENTRIES_PER_BLOCK;
+
+    pwrite(fd[table_id], &file->map[block][index], sizeof(page_map_entry)
+        , (off_t)file->superblock.map_blocks[block] * PAGE_SLOT_UNIT + index * sizeof(page_map_entry));
+}
+
+/**
+ * Add an empty map block, for the next PAGE_MAP_ENTRIES_PER_BLOCK pages.
+ * \return Return 0 if success, or -1 if the superblock is full.
+ */
+static int _add_map_block(int table_id, compressed_file *file) {
+    uint32_t block = file->superblock.num_of_map_blocks;
+
+    if (block == PAGE_MAP_MAX_BLOCKS) {
+        return -1;
+    }
+
+    file->map[block] = calloc(PAGE_MAP_ENTRIES_PER_BLOCK, sizeof(page_map_entry));
+    file->superblock.map_blocks[block] = _alloc_slot(file, _block_units());
+    pwrite(fd[table_id], file->map[block], PAGE_MAP_ENTRIES_PER_BLOCK * sizeof(page_map_entry)
+        , (off_t)file->superblock.map_blocks[block] * PAGE_SLOT_UNIT);
+    ++file->superblock.num_of_map_blocks;
+
+    return 0;
+}
+
+static void _destroy_compressed(compressed_file *file) {
+    uint32_t i;
+
+    for (i = 0; i < file->superblock.num_of_map_blocks; ++i) {
+        free(file->map[i]);
+    }
+    for (i = 0; i <= PAGE_SLOT_CLASSES; ++i) {
+        free(file->free_slots[i].offsets);
+    }
+    free(file->released);
+    pthread_mutex_destroy(&file->latch);
+    free(file);
+}
+
+static int _compare_extents(const void *a, const void *b) {
+    uint32_t x = ((const slot_extent*)a)->offset, y = ((const slot_extent*)b)->offset;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Load the superblock and the page map of a compressed table file,
+ * and rebuild its free slots from gaps between used slots.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+static int _load_compressed(int table_id) {
+    compressed_file *file = calloc(1, sizeof(compressed_file));
+    slot_extent *extents;
+    size_t num_of_extents = 0;
+    uint32_t block, i, next;
+    pagenum_t pagenum;
+    page_map_entry *entry;
+    off_t size;
+
+    pthread_mutex_init(&file->latch, NULL);
+    if (pread(fd[table_id], &file->superblock, sizeof(page_map_superblock), 0)
+            != sizeof(page_map_superblock) || file->superblock.version != 1
+            || file->superblock.num_of_map_blocks > PAGE_MAP_MAX_BLOCKS
+            || file->superblock.page_size < MIN_PAGE_SIZE || file->superblock.page_size > MAX_PAGE_SIZE) {
+        file->superblock.num_of_map_blocks = 0;
+        _destroy_compressed(file);
+        return -1;
+    }
+
+    size = lseek(fd[table_id], 0, SEEK_END);
+    file->end_unit = (size + PAGE_SLOT_UNIT - 1) / PAGE_SLOT_UNIT;
+
+    extents = malloc((1 + file->superblock.num_of_map_blocks * (PAGE_MAP_ENTRIES_PER_BLOCK + 1))
+        * sizeof(slot_extent));
+    extents[num_of_extents].offset = 0;
+    extents[num_of_extents++].units = _block_units();
+
+    for (block = 0; block < file->superblock.num_of_map_blocks; ++block) {
+        file->map[block] = malloc(PAGE_MAP_ENTRIES_PER_BLOCK * sizeof(page_map_entry));
+        pread(fd[table_id], file->map[block], PAGE_MAP_ENTRIES_PER_BLOCK * sizeof(page_map_entry)
+            , (off_t)file->superblock.map_blocks[block] * PAGE_SLOT_UNIT);
+        extents[num_of_extents].offset = file->superblock.map_blocks[block];
+        extents[num_of_extents++].units = _block_units();
+
+        for (i = 0; i < PAGE_MAP_ENTRIES_PER_BLOCK; ++i) {
+            pagenum = (pagenum_t)block * PAGE_MAP_ENTRIES_PER_BLOCK + i;
+            entry = &file->map[block][i];
+            if (pagenum < file->superblock.num_of_pages && entry->capacity > 0) {
+                extents[num_of_extents].offset = entry->offset;
+                extents[num_of_extents++].units = entry->capacity;
+            }
+        }
+    }
+
+    qsort(extents, num_of_extents, sizeof(slot_extent), _compare_extents);
+    for (i = 0, next = 0; i < num_of_extents; ++i) {
+        if (extents[i].offset > next) {
+            _free_slots(file, next, extents[i].offset - next);
+        }
+        if (extents[i].offset + extents[i].units > next) {
+            next = extents[i].offset + extents[i].units;
+        }
+    }
+    if (file->end_unit > next) {
+        _free_slots(file, next, file->end_unit - next);
+    }
+    free(extents);
+
+    table_page_size[table_id] = file->superblock.page_size;
+    compressed[table_id] = file;
+    return 0;
+}
+
+/**
+ * Start an empty compressed file for a table, with the page size of the table.
+ * The header page is to be written.
+ */
+static void _create_compressed(int table_id) {
+    compressed_file *file = calloc(1, sizeof(compressed_file));
+
+    pthread_mutex_init(&file->latch, NULL);
+    file->superblock.magic = PAGE_MAP_MAGIC;
+    file->superblock.version = 1;
+    file->superblock.num_of_pages = 1;
+    file->superblock.page_size = table_page_size[table_id];
+    file->end_unit = _block_units();
+    _add_map_block(table_id, file);
+    _write_superblock(table_id, file);
+    compressed[table_id] = file;
+}
+
+/**
+ * Read a page of a compressed table file.
+ * The map entry is copied under the latch. The slot can't move while it is read,
+ *   since the buffer manager doesn't read and write the same page at once.
+ */
+static void _read_compressed(int table_id, pagenum_t pagenum, page_t *dest) {
+    compressed_file *file = compressed[table_id];
+    uint32_t page_size = table_page_size[table_id];
+    char data[MAX_PAGE_SIZE];
+    page_map_entry entry = { 0, 0, 0 };
+
+    pthread_mutex_lock(&file->latch);
+    if (pagenum < file->superblock.num_of_pages) {
+        entry = file->map[pagenum / PAGE_MAP_ENTRIES_PER_BLOCK][pagenum % PAGE_MAP_ENTRIES_PER_BLOCK];
+    }
+    pthread_mutex_unlock(&file->latch);
+
+    if (entry.size == 0) {
+        memset(dest, 0, page_size);
+    } else if (entry.size == PAGE_MAP_RAW) {
+        pread(fd[table_id], dest, page_size, (off_t)entry.offset * PAGE_SLOT_UNIT);
+    } else if (pread(fd[table_id], data, entry.size, (off_t)entry.offset * PAGE_SLOT_UNIT) != entry.size
+            || page_decompress(data, entry.size, (char*)dest, page_size) != (int)page_size) {
+        fprintf(stderr, "Corrupted page %lu of table %d\n", (unsigned long)pagenum, table_id);
+        memset(dest, 0, page_size);
+    }
+}
+
+/**
+ * Free the released slots of a compressed table file, whose map is synced.
+ * Latch of the file must be held.
+ */
+static void _free_released(compressed_file *file) {
+    size_t i;
+
+    for (i = 0; i < file->num_released; ++i) {
+        _free_slots(file, file->released[i].offset, file->released[i].units);
+    }
+    file->num_released = 0;
+}
+
+/**
+ * Write a page of a compressed table file.
+ * A page is stored uncompressed unless compression saves a unit at least.
+ * It is overwritten in place if it fits in its slot.
+ *   Otherwise, it moves to a new slot, and the old one is released.
+ *   Released slots are freed once the file is synced, by file_sync
+ *   or by this function when PAGE_SLOT_RELEASE_BATCH of them wait.
+ */
+static void _write_compressed(int table_id, pagenum_t pagenum, const page_t *src) {
+    compressed_file *file = compressed[table_id];
+    uint32_t page_size = table_page_size[table_id];
+    char data[MAX_PAGE_SIZE];
+    const char *payload = data;
+    page_map_entry *entry, old_entry;
+    int size;
+    uint32_t units;
+
+    size = page_compress((const char*)src, page_size, data, page_size - PAGE_SLOT_UNIT);
+    if (size == 0) {
+        size = page_size;
+        payload = (const char*)src;
+    }
+    units = (size + PAGE_SLOT_UNIT - 1) / PAGE_SLOT_UNIT;
+
+    pthread_mutex_lock(&file->latch);
+    entry = &file->map[pagenum / PAGE_MAP_ENTRIES_PER_BLOCK][pagenum % PAGE_MAP_ENTRIES_PER_BLOCK];
+    old_entry = *entry;
+    if (entry->capacity < units) {
+        entry->offset = _alloc_slot(file, units);
+        entry->capacity = units;
+    }
+    entry->size = size == (int)page_size ? PAGE_MAP_RAW : size;
+
+    pwrite(fd[table_id], payload, size, (off_t)entry->offset * PAGE_SLOT_UNIT);
+    _write_map_entry(table_id, file, pagenum);
+    if (old_entry.capacity > 0 && old_entry.offset != entry->offset) {
+        if (file->released == NULL) {
+            file->released = malloc(PAGE_SLOT_RELEASE_BATCH * sizeof(slot_extent));
+        }
+        file->released[file->num_released].offset = old_entry.offset;
+        file->released[file->num_released].units = old_entry.capacity;
+        if (++file->num_released == PAGE_SLOT_RELEASE_BATCH) {
+            fdatasync(fd[table_id]);
+            _free_released(file);
+        }
+    }
+    pthread_mutex_unlock(&file->latch);
+}
+
+/**
+ * Add a page to a compressed table file. Its slot is allocated when it is written.
+ * \return Page number of the new page, or -1 if the page map is full.
+ */
+static off_t _extend_compressed(int table_id) {
+    compressed_file *file = compressed[table_id];
+    pagenum_t pagenum;
+
+    pthread_mutex_lock(&file->latch);
+    pagenum = file->superblock.num_of_pages;
+    if (pagenum == (pagenum_t)file->superblock.num_of_map_blocks * PAGE_MAP_ENTRIES_PER_BLOCK
+            && _add_map_block(table_id, file) != 0) {
+        pthread_mutex_unlock(&file->latch);
+        return -1;
+    }
+    ++file->superblock.num_of_pages;
+    _write_superblock(table_id, file);
+    pthread_mutex_unlock(&file->latch);
+
+    return pagenum;
+}
+
 
 // FUNCTION DEFINITIONS.
 
@@ -68,11 +445,29 @@ int file_open_file(char *pathname) {
     // Create file.
     if (new_fd < 0) {
         new_fd = open(pathname, O_RDWR | O_CREAT, S_IRWXG | S_IRWXU | S_IRWXO);
+        memset(&header, 0, ON_DISK_PAGE_SIZE);
         header.header_page.free_pagenum = 0;
         header.header_page.root_pagenum = 0;
         header.header_page.num_of_pages = 1;
+        header.header_page.page_size = ON_DISK_PAGE_SIZE;
         fd[empty_id] = new_fd;
+        table_page_size[empty_id] = ON_DISK_PAGE_SIZE;
         file_write_page(empty_id, 0, &header);
+        file_sync(empty_id);
+    }
+
+    /* Page size is in the header page, within its first ON_DISK_PAGE_SIZE bytes.
+     * Compressed file starts with a superblock instead, which has the page size.
+     */
+    fd[empty_id] = new_fd;
+    memset(&header, 0, ON_DISK_PAGE_SIZE);
+    pread(new_fd, &header, ON_DISK_PAGE_SIZE, 0);
+    table_page_size[empty_id] = header.header_page.page_size
+        ? header.header_page.page_size : ON_DISK_PAGE_SIZE;
+    if (header.header_page.free_pagenum == PAGE_MAP_MAGIC && _load_compressed(empty_id) != 0) {
+        close(new_fd);
+        fd[empty_id] = -1;
+        return -1;
     }
 
     // Allocate and Copy pathname
@@ -90,10 +485,120 @@ int file_open_file(char *pathname) {
     return empty_id;
 }
 
+/**
+ * Open a table file read-only and map the whole file into memory.
+ * Pages are read in place from the mapping by file_mapped_page,
+ *   so the file must not be changed while it is mapped.
+ * A compressed file can't be mapped, since its pages are not in place.
+ * \param pathname Path name of an existing table file, which is not open yet.
+ * \return If success, return unique table id of the mapped file.
+ *      Otherwise, return negative value.
+ */
+int file_open_mapped(char *pathname) {
+    page_t header;
+    struct stat st;
+    mapped_file *file;
+    void *addr;
+    uint32_t page_size;
+    int table_id, empty_id = 0;
+    int new_fd;
+
+    for (table_id = MAX_TABLE_ID; table_id >= 1; --table_id) {
+        if (stored_pathname[table_id]) {
+            if (strcmp(stored_pathname[table_id], pathname) == 0) {
+                // Opened for writing, or mapped already.
+                return -1;
+            }
+        } else {
+            empty_id = table_id;
+        }
+    }
+
+    if (empty_id == 0) {
+        return -1;
+    }
+
+    new_fd = open(pathname, O_RDONLY);
+    if (new_fd < 0) {
+        return -1;
+    }
+    memset(&header, 0, ON_DISK_PAGE_SIZE);
+    if (fstat(new_fd, &st) != 0 || (size_t)st.st_size < ON_DISK_PAGE_SIZE
+            || pread(new_fd, &header, ON_DISK_PAGE_SIZE, 0) != (ssize_t)ON_DISK_PAGE_SIZE
+            || header.header_page.free_pagenum == PAGE_MAP_MAGIC) {
+        close(new_fd);
+        return -1;
+    }
+    // Pages are used in place, so the header must agree with the file.
+    page_size = header.header_page.page_size ? header.header_page.page_size : ON_DISK_PAGE_SIZE;
+    if (page_size < MIN_PAGE_SIZE || page_size > MAX_PAGE_SIZE || (page_size & (page_size - 1)) != 0
+            || header.header_page.num_of_pages == 0
+            || header.header_page.num_of_pages > (uint64_t)st.st_size / page_size) {
+        close(new_fd);
+        return -1;
+    }
+
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, new_fd, 0);
+    if (addr == MAP_FAILED) {
+        close(new_fd);
+        return -1;
+    }
+
+    file = malloc(sizeof(mapped_file));
+    file->addr = addr;
+    file->length = st.st_size;
+    file->advice = MADV_NORMAL;
+
+    fd[empty_id] = new_fd;
+    table_page_size[empty_id] = page_size;
+    mapped[empty_id] = file;
+    stored_pathname[empty_id] = strdup(pathname);
+
+    return empty_id;
+}
+
+/**
+ * Get a page of a mapped table in place.
+ * \return Pointer to the page in the mapping,
+ *   or NULL if the table is not mapped or the page is beyond the file.
+ */
+const page_t *file_mapped_page(int table_id, pagenum_t pagenum) {
+    mapped_file *file = mapped[table_id];
+
+    if (!file || (pagenum + 1) * table_page_size[table_id] > file->length) {
+        return NULL;
+    }
+    return (const page_t*)(file->addr + pagenum * table_page_size[table_id]);
+}
+
+/**
+ * Check whether a table is opened by file_open_mapped.
+ * \return Non-zero value if mapped, otherwise 0.
+ */
+int file_is_mapped(int table_id) {
+    return mapped[table_id] != NULL;
+}
+
+/**
+ * Tell the kernel how the mapping of a table is going to be read.
+ * The advice is given only when it changes. Nothing is done for a table not mapped.
+ * \param advice MADV_SEQUENTIAL for scans, or MADV_RANDOM for point lookups.
+ */
+void file_advise(int table_id, int advice) {
+    mapped_file *file = mapped[table_id];
+
+    if (!file || file->advice == advice) {
+        return;
+    }
+    madvise(file->addr, file->length, advice);
+    file->advice = advice;
+}
+
 /**
  * Extend given corresponding table(file) to \p table_id for one page.
  * Additional length is on-disk page size.
  * Additional space is not initialized.
+ * A compressed file just gets a page map entry, and reads zeros for the page.
  * Increase number of pages in header page.
  * \param table_id Table id of extension target table(file)
  * \param header_page If this argument is NULL, just directly write header page.
@@ -105,13 +610,33 @@ int file_open_file(char *pathname) {
 off_t file_extend_file(int table_id, page_t *header_page) {
     off_t result;
     pagenum_t num_of_pages;
-    char buf = 0;
 
-    // Extend the file.
+    if (compressed[table_id]) {
+        result = _extend_compressed(table_id);
+        if (result < 0) {
+            return -1;
+        }
+        num_of_pages = result + 1;
+        result = num_of_pages * table_page_size[table_id] - 1;
 
-    result = lseek(fd[table_id], ON_DISK_PAGE_SIZE - 1, SEEK_END);
+        if (header_page == NULL) {
+            page_t header;
+            file_read_page(table_id, 0, &header);
+            header.header_page.num_of_pages = num_of_pages;
+            file_write_page(table_id, 0, &header);
+        } else {
+            header_page->header_page.num_of_pages = num_of_pages;
+        }
+        return result;
+    }
+
+    /* Extend the file.
+     * ftruncate works under direct I/O too, where a write of one byte fails.
+     */
+
+    result = lseek(fd[table_id], 0, SEEK_END) + table_page_size[table_id] - 1;
 
-    if (write(fd[table_id], &buf, 1) < 1) {
+    if (ftruncate(fd[table_id], result + 1) != 0) {
         perror("Fail to extend file");
         return -1;
     }
@@ -119,7 +644,7 @@ off_t file_extend_file(int table_id, page_t *header_page) {
 
     // Update header page.
 
-    num_of_pages = (result + 1) / ON_DISK_PAGE_SIZE;
+    num_of_pages = (result + 1) / table_page_size[table_id];
 
     if (header_page == NULL) {
         pwrite(fd[table_id], &num_of_pages, 8, 16);
@@ -139,19 +664,51 @@ off_t file_extend_file(int table_id, page_t *header_page) {
  * \param dest Result of reading operation. The page is stored in here.
  */
 void file_read_page(int table_id, pagenum_t pagenum, page_t* dest) {
-    pread(fd[table_id], dest, ON_DISK_PAGE_SIZE, pagenum * ON_DISK_PAGE_SIZE);
+    if (compressed[table_id]) {
+        _read_compressed(table_id, pagenum, dest);
+        return;
+    }
+    pread(fd[table_id], dest, table_page_size[table_id], pagenum * table_page_size[table_id]);
 }
 
 /**
  * Write an in-memory page(src) to the on-disk page
+ * The page is not synced to disk here. Durability comes from the log,
+ *      and file_sync is called when the table is closed.
  * \param table_id Indicating the table 
  *      where writing operation is performed.
  * \param pagenum Indicating the page which is target of writing operation.
  * \param src Source structure of writing operation.
  */
 void file_write_page(int table_id, pagenum_t pagenum, const page_t* src) {
-    pwrite(fd[table_id], src, ON_DISK_PAGE_SIZE, pagenum * ON_DISK_PAGE_SIZE);
-    fsync(fd[table_id]);
+    if (compressed[table_id]) {
+        _write_compressed(table_id, pagenum, src);
+        return;
+    }
+    pwrite(fd[table_id], src, table_page_size[table_id], pagenum * table_page_size[table_id]);
+}
+
+/**
+ * Flush all written pages of the table to disk.
+ * \param table_id Indicating the table to be synced.
+ * \return Return 0 if success, otherwise return non-zero value,
+ *      e.g., when an earlier write failed.
+ */
+int file_sync(int table_id) {
+    compressed_file *file = compressed[table_id];
+    int result;
+
+    if (file) {
+        // No slot is released between the sync and freeing.
+        pthread_mutex_lock(&file->latch);
+        result = fdatasync(fd[table_id]);
+        if (result == 0) {
+            _free_released(file);
+        }
+        pthread_mutex_unlock(&file->latch);
+        return result;
+    }
+    return fdatasync(fd[table_id]);
 }
 
 /** 
@@ -166,6 +723,125 @@ int file_close_file(int table_id) {
     fd[table_id] = -1;
     free(stored_pathname[table_id]);
     stored_pathname[table_id] = NULL;
+    if (compressed[table_id]) {
+        _destroy_compressed(compressed[table_id]);
+        compressed[table_id] = NULL;
+    }
+    if (mapped[table_id]) {
+        munmap(mapped[table_id]->addr, mapped[table_id]->length);
+        free(mapped[table_id]);
+        mapped[table_id] = NULL;
+    }
 
     return 0;
 }
+
+/**
+ * Convert the file of a table that has only the header page
+ *   to a compressed file, or back to a plain file.
+ * A compressed file starts with a superblock, followed by map blocks of PAGE_MAP_BLOCK_SIZE bytes
+ *   and slots of compressed pages in any order.
+ * \param header_page Current header page, which is written to the new file.
+ * \param compress If non-zero, compress the file. Otherwise, make it plain.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int file_set_compression(int table_id, const page_t *header_page, int compress) {
+    // Compressed pages have sizes and offsets direct I/O can't take.
+    if (header_page->header_page.num_of_pages != 1 || (compress && file_is_direct_io(table_id))) {
+        return -1;
+    }
+    if (!compress == !compressed[table_id]) {
+        return 0;
+    }
+    if (ftruncate(fd[table_id], 0) != 0) {
+        return -1;
+    }
+
+    if (compress) {
+        _create_compressed(table_id);
+    } else {
+        _destroy_compressed(compressed[table_id]);
+        compressed[table_id] = NULL;
+    }
+    file_write_page(table_id, 0, header_page);
+    file_sync(table_id);
+
+    return 0;
+}
+
+/**
+ * Check whether the file of a table is compressed.
+ * \return Non-zero value if compressed, otherwise 0.
+ */
+int file_is_compressed(int table_id) {
+    return compressed[table_id] != NULL;
+}
+
+/**
+ * Rewrite the file of a table that has only the header page
+ *   with the page size in the header page.
+ * \param header_page Current header page with the new page size,
+ *   which is written to the new file.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int file_set_page_size(int table_id, const page_t *header_page) {
+    uint32_t page_size = header_page->header_page.page_size;
+    int was_compressed = compressed[table_id] != NULL;
+
+    if (header_page->header_page.num_of_pages != 1 || page_size < MIN_PAGE_SIZE
+            || page_size > MAX_PAGE_SIZE || (page_size & (page_size - 1)) != 0) {
+        return -1;
+    }
+    if (ftruncate(fd[table_id], 0) != 0) {
+        return -1;
+    }
+
+    if (was_compressed) {
+        _destroy_compressed(compressed[table_id]);
+        compressed[table_id] = NULL;
+    }
+    table_page_size[table_id] = page_size;
+    if (was_compressed) {
+        _create_compressed(table_id);
+    }
+    file_write_page(table_id, 0, header_page);
+    file_sync(table_id);
+
+    return 0;
+}
+
+/**
+ * Turn direct I/O of a table file on or off.
+ * With direct I/O, pages are read into and written from buffer frames
+ *   without going through the OS page cache, so the table is cached only once.
+ *   Pages of the file cached so far are dropped.
+ * Buffers must be aligned to PAGE_ALIGNMENT, as buffer frames are.
+ * Compressed and mapped files can't use direct I/O.
+ * \param direct If non-zero, turn direct I/O on. Otherwise, turn it off.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int file_set_direct_io(int table_id, int direct) {
+    int flags = fcntl(fd[table_id], F_GETFL);
+
+    if (flags < 0 || (direct && (compressed[table_id] || mapped[table_id]))) {
+        return -1;
+    }
+    if (direct) {
+        fsync(fd[table_id]);
+        posix_fadvise(fd[table_id], 0, 0, POSIX_FADV_DONTNEED);
+        flags |= O_DIRECT;
+    } else {
+        flags &= ~O_DIRECT;
+    }
+
+    return fcntl(fd[table_id], F_SETFL, flags) != 0;
+}
+
+/**
+ * Check whether a table file uses direct I/O.
+ * \return Non-zero value if so, otherwise 0.
+ */
+int file_is_direct_io(int table_id) {
+    int flags = fcntl(fd[table_id], F_GETFL);
+    return flags >= 0 && (flags & O_DIRECT) != 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * filter_manager.cc
+ */
+
+#include <string>
+#include <utility>
+
+#include "filter_manager.hpp"
+
+
+// TYPES.
+
+/**
+ * Header of a saved filter file. Counters follow it.
+ * The table is stamped with its root and number of pages when saved,
+ *   and a filter whose stamp doesn't match the table is not loaded.
+ */
+typedef struct {
+    uint64_t magic;
+    uint64_t num_of_counters;
+    uint64_t num_of_keys;
+    pagenum_t root;
+    pagenum_t num_of_pages;
+} filter_file_header;
+
+
+// FUNCTIONS.
+
+/**
+ * Mix bits of a key, so that near keys get far hashes.
+ */
+static inline uint64_t _mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * Indexes of counters of a key, by double hashing.
+ */
+static void _indexes(const filter_t *filter, int64_t key, uint64_t *indexes) {
+    uint64_t h1 = _mix((uint64_t)key), h2 = _mix(h1) | 1;
+    int i;
+
+    for (i = 0; i < FILTER_NUM_HASHES; ++i) {
+        indexes[i] = (h1 + i * h2) & (filter->num_of_counters - 1);
+    }
+}
+
+/**
+ * Create an empty filter sized for twice \p num_of_keys keys,
+ *   so that it is not full before the table doubles.
+ */
+filter_t *filter_create(uint64_t num_of_keys) {
+    filter_t *filter = new filter_t();
+    uint64_t num_of_counters = FILTER_MIN_COUNTERS;
+
+    while (num_of_counters < 2 * num_of_keys * FILTER_COUNTERS_PER_KEY) {
+        num_of_counters *= 2;
+    }
+
+    pthread_rwlock_init(&filter->latch, NULL);
+    filter->num_of_counters = num_of_counters;
+    filter->num_of_keys = 0;
+    filter->counters = new uint8_t[num_of_counters]();
+
+    return filter;
+}
+
+/**
+ * Free a filter. Nobody may hold it.
+ */
+void filter_destroy(filter_t *filter) {
+    pthread_rwlock_destroy(&filter->latch);
+    delete[] filter->counters;
+    delete filter;
+}
+
+/**
+ * Add a key, which is not in the table yet.
+ */
+void filter_add(filter_t *filter, int64_t key) {
+    uint64_t indexes[FILTER_NUM_HASHES];
+    int i;
+
+    _indexes(filter, key, indexes);
+    pthread_rwlock_wrlock(&filter->latch);
+    for (i = 0; i < FILTER_NUM_HASHES; ++i) {
+        if (filter->counters[indexes[i]] < UINT8_MAX) {
+            ++filter->counters[indexes[i]];
+        }
+    }
+    ++filter->num_of_keys;
+    pthread_rwlock_unlock(&filter->latch);
+}
+
+/**
+ * Remove a key, which was deleted from the table.
+ */
+void filter_remove(filter_t *filter, int64_t key) {
+    uint64_t indexes[FILTER_NUM_HASHES];
+    int i;
+
+    _indexes(filter, key, indexes);
+    pthread_rwlock_wrlock(&filter->latch);
+    for (i = 0; i < FILTER_NUM_HASHES; ++i) {
+        if (filter->counters[indexes[i]] > 0 && filter->counters[indexes[i]] < UINT8_MAX) {
+            --filter->counters[indexes[i]];
+        }
+    }
+    if (filter->num_of_keys > 0) {
+        --filter->num_of_keys;
+    }
+    pthread_rwlock_unlock(&filter->latch);
+}
+
+/**
+ * Test a key.
+ * \return false if the key is surely not in the table,
+ *   or true if it may be.
+ */
+bool filter_may_contain(filter_t *filter, int64_t key) {
+    uint64_t indexes[FILTER_NUM_HASHES];
+    bool result = true;
+    int i;
+
+    _indexes(filter, key, indexes);
+    pthread_rwlock_rdlock(&filter->latch);
+    for (i = 0; i < FILTER_NUM_HASHES && result; ++i) {
+        result = filter->counters[indexes[i]] > 0;
+    }
+    pthread_rwlock_unlock(&filter->latch);
+
+    return result;
+}
+
+/**
+ * Check whether a filter holds more keys than it is sized for,
+ *   so that it should be rebuilt larger.
+ */
+bool filter_is_full(filter_t *filter) {
+    return filter->num_of_keys * FILTER_COUNTERS_PER_KEY > filter->num_of_counters;
+}
+
+/**
+ * Exchange counters of two filters.
+ * A filter rebuilt aside takes the place of the one in use,
+ *   which readers may hold.
+ */
+void filter_swap(filter_t *filter, filter_t *other) {
+    pthread_rwlock_wrlock(&filter->latch);
+    std::swap(filter->num_of_counters, other->num_of_counters);
+    std::swap(filter->num_of_keys, other->num_of_keys);
+    std::swap(filter->counters, other->counters);
+    pthread_rwlock_unlock(&filter->latch);
+}
+
+/**
+ * Save a filter next to its table, stamped with the table.
+ * \param pathname Path name of the table.
+ * \return Return 0 if success, otherwise return non-zero value.
+ */
+int filter_save(filter_t *filter, const char *pathname, pagenum_t root, pagenum_t num_of_pages) {
+    std::string path = std::string(pathname) + FILTER_FILE_SUFFIX;
+    filter_file_header header;
+    FILE *file;
+    int result = 0;
+
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    pthread_rwlock_rdlock(&filter->latch);
+    header.magic = FILTER_MAGIC;
+    header.num_of_counters = filter->num_of_counters;
+    header.num_of_keys = filter->num_of_keys;
+    header.root = root;
+    header.num_of_pages = num_of_pages;
+    if (fwrite(&header, sizeof(header), 1, file) != 1
+            || fwrite(filter->counters, 1, filter->num_of_counters, file) != filter->num_of_counters) {
+        result = -1;
+    }
+    pthread_rwlock_unlock(&filter->latch);
+
+    result |= fclose(file);
+    if (result != 0) {
+        unlink(path.c_str());
+    }
+    return result;
+}
+
+/**
+ * Load the filter saved next to a table, and delete the file,
+ *   since the filter in memory goes ahead of it from now on.
+ * \param pathname Path name of the table.
+ * \return The filter, or NULL if there is no saved filter matching the stamp.
+ */
+filter_t *filter_load(const char *pathname, pagenum_t root, pagenum_t num_of_pages) {
+    std::string path = std::string(pathname) + FILTER_FILE_SUFFIX;
+    filter_file_header header;
+    filter_t *filter = NULL;
+    FILE *file;
+
+    file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == FILTER_MAGIC
+            && header.root == root && header.num_of_pages == num_of_pages
+            && header.num_of_counters >= FILTER_MIN_COUNTERS
+            && (header.num_of_counters & (header.num_of_counters - 1)) == 0) {
+        filter = filter_create(0);
+        delete[] filter->counters;
+        filter->num_of_counters = header.num_of_counters;
+        filter->num_of_keys = header.num_of_keys;
+        filter->counters = new uint8_t[header.num_of_counters];
+        if (fread(filter->counters, 1, header.num_of_counters, file) != header.num_of_counters) {
+            filter_destroy(filter);
+            filter = NULL;
+        }
+    }
+
+    fclose(file);
+    unlink(path.c_str());
+    return filter;
+}
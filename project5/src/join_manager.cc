@@ -0,0 +1,274 @@
+/*
+ * join_manager.cc
+ */
+
+#include <errno.h>
+#include <new>
+
+#include "join_manager.hpp"
+
+
+leaf_cursor_t::leaf_cursor_t() : table_id(0), page_number(0), page(new page_t())
+        , index(0), keep_pages(false), kept_pages() {
+
+    // Do nothing.
+}
+
+
+leaf_cursor_t::~leaf_cursor_t() {
+    leaf_cursor_release(this);
+    delete page;
+}
+
+
+// FUNCTIONS.
+
+/**
+ * Write decimal form of given integer to \p dest .
+ * \return Number of characters written. At most 20.
+ */
+static size_t _format_int64(int64_t value, char *dest) {
+    char digits[20];
+    uint64_t magnitude;
+    size_t len = 0, n = 0;
+
+    if (value < 0) {
+        dest[len++] = '-';
+        magnitude = 0 - (uint64_t)value;
+    } else {
+        magnitude = value;
+    }
+
+    do {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    while (n) {
+        dest[len++] = digits[--n];
+    }
+
+    return len;
+}
+
+/**
+ * Open or create the result file of a join and allocate its buffer.
+ * Existing content of the file is discarded.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int join_output_open(join_output_t *output, const char *pathname, join_format_t format) {
+    output->fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (output->fd < 0) {
+        return 1;
+    }
+
+    output->buffer = new (std::nothrow) char[JOIN_OUTPUT_BUFFER_SIZE];
+    if (output->buffer == NULL) {
+        close(output->fd);
+        return 1;
+    }
+
+    output->format = format;
+    output->used = 0;
+    output->failed = false;
+
+    return 0;
+}
+
+/**
+ * Write "key,value" form of given record to \p dest .
+ * \return Number of characters written.
+ */
+static size_t _format_record(const record *rec, char *dest) {
+    size_t len, value_len;
+
+    len = _format_int64(rec->key, dest);
+    dest[len++] = ',';
+    value_len = strnlen(rec->value, sizeof(rec->value));
+    memcpy(dest + len, rec->value, value_len);
+
+    return len + value_len;
+}
+
+/**
+ * Append a joined row.
+ * Values are NUL-terminated unless they take all 120 bytes.
+ */
+void join_output_row(join_output_t *output, const record *rec_1, const record *rec_2) {
+    char *dest;
+    size_t len;
+
+    if (output->used + JOIN_TEXT_ROW_MAX_SIZE > JOIN_OUTPUT_BUFFER_SIZE) {
+        join_output_flush(output);
+    }
+    dest = output->buffer + output->used;
+
+    if (output->format == join_format_t::BINARY) {
+        memcpy(dest, rec_1, sizeof(record));
+        memcpy(dest + sizeof(record), rec_2, sizeof(record));
+        output->used += JOIN_BINARY_ROW_SIZE;
+        return;
+    }
+
+    len = _format_record(rec_1, dest);
+    dest[len++] = ',';
+    len += _format_record(rec_2, dest + len);
+    dest[len++] = '\n';
+
+    output->used += len;
+}
+
+/**
+ * Append a row of a single key.
+ * Text rows are a key and a newline, and binary rows are a key in host byte order.
+ */
+void join_output_key(join_output_t *output, int64_t key) {
+    char *dest;
+    size_t len;
+
+    if (output->used + JOIN_TEXT_ROW_MAX_SIZE > JOIN_OUTPUT_BUFFER_SIZE) {
+        join_output_flush(output);
+    }
+    dest = output->buffer + output->used;
+
+    if (output->format == join_format_t::BINARY) {
+        memcpy(dest, &key, sizeof(key));
+        output->used += sizeof(key);
+        return;
+    }
+
+    len = _format_int64(key, dest);
+    dest[len++] = '\n';
+
+    output->used += len;
+}
+
+/**
+ * Append a row joined from \p num_records records.
+ * Text rows list "key,value" of each record, and binary rows are
+ *   \p num_records records of JOIN_BINARY_ROW_SIZE / 2 bytes.
+ */
+void join_output_row_n(join_output_t *output, const record * const *recs, int num_records) {
+    char *dest;
+    size_t len = 0;
+    int i;
+
+    if (output->used + num_records * JOIN_TEXT_ROW_MAX_SIZE / 2 > JOIN_OUTPUT_BUFFER_SIZE) {
+        join_output_flush(output);
+    }
+    dest = output->buffer + output->used;
+
+    if (output->format == join_format_t::BINARY) {
+        for (i = 0; i < num_records; ++i) {
+            memcpy(dest + i * sizeof(record), recs[i], sizeof(record));
+        }
+        output->used += num_records * sizeof(record);
+        return;
+    }
+
+    for (i = 0; i < num_records; ++i) {
+        len += _format_record(recs[i], dest + len);
+        dest[len++] = i + 1 < num_records ? ',' : '\n';
+    }
+
+    output->used += len;
+}
+
+/**
+ * Write out buffered rows.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int join_output_flush(join_output_t *output) {
+    size_t written = 0;
+    ssize_t result;
+
+    while (written < output->used && !output->failed) {
+        result = write(output->fd, output->buffer + written, output->used - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            perror("Fail to write join result");
+            output->failed = true;
+            break;
+        }
+        written += result;
+    }
+    output->used = 0;
+
+    return output->failed;
+}
+
+/**
+ * Write out remaining rows, close the result file and free the buffer.
+ * \return If every row has been written, return 0. Otherwise, return non-zero value.
+ */
+int join_output_close(join_output_t *output) {
+    int result = join_output_flush(output);
+
+    result |= close(output->fd) != 0;
+    delete[] output->buffer;
+    output->buffer = NULL;
+    output->fd = -1;
+
+    return result;
+}
+
+/**
+ * Concatenate given files in order into the result file,
+ *   then remove them. Data is copied inside the kernel if possible.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int join_output_concat(const char *pathname, const std::vector<std::string> &part_paths) {
+    int fd, part_fd, result = 0;
+    ssize_t copied;
+    char *buffer = NULL;
+
+    fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0) {
+        return 1;
+    }
+
+    for (const std::string &part_path : part_paths) {
+        part_fd = open(part_path.c_str(), O_RDONLY);
+        if (part_fd < 0) {
+            result = 1;
+            continue;
+        }
+
+        while ((copied = copy_file_range(part_fd, NULL, fd, NULL, JOIN_OUTPUT_BUFFER_SIZE, 0)) > 0) {
+            continue;
+        }
+        // Not supported between these files. Copy through user space.
+        if (copied < 0) {
+            if (buffer == NULL) {
+                buffer = new char[JOIN_OUTPUT_BUFFER_SIZE];
+            }
+            while ((copied = read(part_fd, buffer, JOIN_OUTPUT_BUFFER_SIZE)) > 0) {
+                if (write(fd, buffer, copied) != copied) {
+                    copied = -1;
+                    break;
+                }
+            }
+            result |= copied < 0;
+        }
+
+        close(part_fd);
+        unlink(part_path.c_str());
+    }
+
+    delete[] buffer;
+    result |= close(fd) != 0;
+
+    return result;
+}
+
+
+/**
+ * Free leaf copies kept by given cursor.
+ * Pointers into leaves other than the current one become invalid.
+ */
+void leaf_cursor_release(leaf_cursor_t *cursor) {
+    for (page_t *page : cursor->kept_pages) {
+        delete page;
+    }
+    cursor->kept_pages.clear();
+}
@@ -4,7 +4,10 @@
 
 std::vector<trx_t*> trx_system_t::table = std::vector<trx_t*>();
 pthread_mutex_t trx_system_t::latch = PTHREAD_MUTEX_INITIALIZER;
+int trx_system_t::next_tid = 1;
+int trx_system_t::commits_since_collect = 0;
 pthread_mutex_t lock_hash_table_t::table_latch = PTHREAD_MUTEX_INITIALIZER;
+lock_hash_table_element_t lock_hash_table_t::table[LOCK_HASH_TABLE_SIZE] = {};
 
 
 // MEMBER FUNCTIONS.
@@ -19,10 +22,11 @@ lock_t::lock_t(int table_id, pagenum_t page_number
 }
 
 
-trx_t::trx_t() : status(trx_status_t::RUNNING), trx_locks()
+trx_t::trx_t() : status(trx_status_t::RUNNING), read_only(false)
+        , read_ts(0), last_lsn(0), trx_locks(), page_lock_counts(), table_lock_counts()
         , waiting_for(nullptr)
         , trx_mutex(PTHREAD_MUTEX_INITIALIZER)
-        , trx_cond(PTHREAD_COND_INITIALIZER), undo_logs() {
+        , trx_cond(PTHREAD_COND_INITIALIZER), undo_logs(), versions() {
 
     // Do nothing.
 }
@@ -38,24 +42,31 @@ int lock_hash_table_t::hashing(pagenum_t page_number) {
 
 
 trx_t::~trx_t() {
-    // TODO
+    pthread_mutex_destroy(&trx_mutex);
+    pthread_cond_destroy(&trx_cond);
 }
 
 
 // FUNCTIONS.
 
 /**
- * 
+ * Allocate a transaction and register it to the transaction table.
+ * Read timestamp is taken under the transaction table latch,
+ *   so version garbage collection always sees the new snapshot.
+ * \return tid of new transaction.
  */
-int begin_trx() {
+static int _begin_trx(bool read_only) {
 
     trx_t *new_trx = new trx_t();
+    new_trx->read_only = read_only;
 
     pthread_mutex_lock(&trx_system_t::latch);
 
     new_trx->tid = trx_system_t::next_tid;
     ++trx_system_t::next_tid;
 
+    new_trx->read_ts = version_snapshot_ts();
+
     trx_system_t::table.push_back(new_trx);
 
     pthread_mutex_unlock(&trx_system_t::latch);
@@ -64,220 +75,666 @@ int begin_trx() {
 }
 
 /**
- * 
+ * Unregister given transaction from the transaction table and free it.
  */
-int deadlock_detection(trx_t *target_trx, trx_t *waited_trx) {
+static void _remove_trx(trx_t *trx) {
+    pthread_mutex_lock(&trx_system_t::latch);
+
+    auto pos = std::lower_bound(trx_system_t::table.begin(), trx_system_t::table.end(), trx->tid,
+    [](const trx_t *lhs, const int &tid) {
+        return lhs->tid < tid;
+    });
+    trx_system_t::table.erase(pos);
+
+    pthread_mutex_unlock(&trx_system_t::latch);
+
+    delete trx;
+}
+
+/**
+ * Begin a new transaction.
+ * \return tid of new transaction.
+ */
+int begin_trx() {
+    return _begin_trx(false);
+}
+
+/**
+ * Begin a new read-only transaction.
+ * It reads a consistent snapshot as of its beginning
+ *   without acquiring any lock, so it never waits for writers.
+ * \return tid of new transaction.
+ */
+int begin_read_only_trx() {
+    return _begin_trx(true);
+}
+
+/**
+ * Find the running transaction with given tid.
+ * \return The transaction, or nullptr if there is no such transaction.
+ */
+trx_t *trx_get(int tid) {
+    trx_t *trx = nullptr;
+
+    pthread_mutex_lock(&trx_system_t::latch);
+
+    auto pos = std::lower_bound(trx_system_t::table.begin(), trx_system_t::table.end(), tid,
+    [](const trx_t *lhs, const int &tid) {
+        return lhs->tid < tid;
+    });
+    if (pos != trx_system_t::table.end() && (*pos)->tid == tid) {
+        trx = *pos;
+    }
+
+    pthread_mutex_unlock(&trx_system_t::latch);
 
-    trx_t *curr_trx = waited_trx;
-    lock_t *curr_lock;
-    while (curr_trx->status == trx_status_t::WAITING && curr_trx != target_trx) {
-        curr_lock = curr_trx->waiting_for;
-        curr_trx = curr_lock->trx;
+    return trx;
+}
+
+/**
+ * Get the oldest read timestamp any running or future snapshot can have.
+ * Versions committed at or before this timestamp are never read again.
+ */
+int64_t trx_oldest_snapshot(void) {
+    int64_t oldest_ts;
+
+    pthread_mutex_lock(&trx_system_t::latch);
+
+    oldest_ts = version_snapshot_ts();
+    for (trx_t *trx : trx_system_t::table) {
+        if (trx->read_only && trx->read_ts < oldest_ts) {
+            oldest_ts = trx->read_ts;
+        }
     }
 
-    if (curr_trx == target_trx) {
-        return LOCK_DEADLOCK;
+    pthread_mutex_unlock(&trx_system_t::latch);
+
+    return oldest_ts;
+}
+
+/**
+ * Commit given transaction.
+ * Make its versions visible to new snapshots and release all its locks.
+ * \return tid of committed transaction if success. Otherwise, return 0.
+ */
+int end_trx(int tid) {
+    trx_t *trx = trx_get(tid);
+    bool collect = false;
+
+    if (trx == nullptr) {
+        return 0;
+    }
+
+    log_commit(trx);
+    version_commit(trx);
+    release_locks(trx);
+    _remove_trx(trx);
+
+    pthread_mutex_lock(&trx_system_t::latch);
+    if (++trx_system_t::commits_since_collect >= VERSION_COLLECT_INTERVAL) {
+        trx_system_t::commits_since_collect = 0;
+        collect = true;
+    }
+    pthread_mutex_unlock(&trx_system_t::latch);
+
+    if (collect) {
+        version_collect();
+    }
+
+    return tid;
+}
+
+/**
+ * Abort given transaction.
+ * Roll back all its modifications, release all its locks and free it.
+ */
+void abort_trx(trx_t *trx) {
+    undo_trx(trx);
+    log_rollback(trx);
+    release_locks(trx);
+    _remove_trx(trx);
+}
+
+
+/**
+ * Compatibility of lock modes held by different transactions.
+ * Indexed by [held mode][requested mode].
+ */
+static const bool LOCK_COMPATIBLE[5][5] = {
+    //            IS     IX     S      SIX    X
+    /* IS  */ { true,  true,  true,  true,  false },
+    /* IX  */ { true,  true,  false, false, false },
+    /* S   */ { true,  false, true,  false, false },
+    /* SIX */ { true,  false, false, false, false },
+    /* X   */ { false, false, false, false, false },
+};
+
+/**
+ * The weakest mode which is at least as strong as both of two modes.
+ * Used when a transaction requests another mode on a resource it already holds.
+ */
+static const lock_mode_t LOCK_SUPREMUM[5][5] = {
+    /* IS  */ { lock_mode_t::INTENTION_SHARED, lock_mode_t::INTENTION_EXCLUSIVE
+                , lock_mode_t::SHARED, lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::EXCLUSIVE },
+    /* IX  */ { lock_mode_t::INTENTION_EXCLUSIVE, lock_mode_t::INTENTION_EXCLUSIVE
+                , lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::EXCLUSIVE },
+    /* S   */ { lock_mode_t::SHARED, lock_mode_t::SHARED_INTENTION_EXCLUSIVE
+                , lock_mode_t::SHARED, lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::EXCLUSIVE },
+    /* SIX */ { lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::SHARED_INTENTION_EXCLUSIVE
+                , lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::SHARED_INTENTION_EXCLUSIVE, lock_mode_t::EXCLUSIVE },
+    /* X   */ { lock_mode_t::EXCLUSIVE, lock_mode_t::EXCLUSIVE
+                , lock_mode_t::EXCLUSIVE, lock_mode_t::EXCLUSIVE, lock_mode_t::EXCLUSIVE },
+};
+
+static bool _compatible(lock_mode_t held, lock_mode_t requested) {
+    return LOCK_COMPATIBLE[(int)held][(int)requested];
+}
+
+static lock_mode_t _supremum(lock_mode_t lhs, lock_mode_t rhs) {
+    return LOCK_SUPREMUM[(int)lhs][(int)rhs];
+}
+
+/**
+ * Check whether holding \p held already grants everything \p requested grants.
+ */
+static bool _covers(lock_mode_t held, lock_mode_t requested) {
+    return _supremum(held, requested) == held;
+}
+
+/**
+ * Append given lock to the tail of the hash list.
+ * Caller must hold lock_hash_table_t::table_latch.
+ */
+static void _append_to_hash_list(int hashed_idx, lock_t *lock) {
+    lock_hash_table_element_t *element = &lock_hash_table_t::table[hashed_idx];
+
+    lock->hash_prev = element->tail;
+    if (element->tail) {
+        element->tail->hash_next = lock;
     } else {
-        return LOCK_SUCCESS;
+        element->head = lock;
     }
+    element->tail = lock;
 }
 
+/**
+ * Find the first lock on given resource.
+ * Locks on a resource are linked in the order of request,
+ *   so the first one in hash list is the head of the resource's lock list.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \return The head lock, or nullptr if there is no lock on the resource.
+ */
+static lock_t *_find_resource_head(int table_id, pagenum_t page_number, int record_index) {
+    lock_t *curr = lock_hash_table_t::table[lock_hash_table_t::hashing(page_number)].head;
+
+    while (curr && (record_index != curr->record_index
+            || table_id != curr->table_id
+            || page_number != curr->page_number)) {
+        curr = curr->hash_next;
+    }
+
+    return curr;
+}
 
 /**
- * 
+ * Get the mode which given transaction holds on a resource.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \param head The head of the resource's lock list. May be nullptr.
+ * \param held Output. Supremum of all acquired modes of \p trx .
+ * \return Whether \p trx holds any lock on the resource.
  */
-int acquire_lock(int table_id, pagenum_t page_number
-        , int record_index, lock_mode_t mode, trx_t *trx) {
+static bool _held_mode(lock_t *head, trx_t *trx, lock_mode_t *held) {
+    bool holding = false;
 
-    int hashed_idx = lock_hash_table_t::hashing(page_number);
-    lock_t *new_lock = nullptr;
-    
-    pthread_mutex_lock(&lock_hash_table_t::table_latch);
+    for (; head; head = head->same_record_next) {
+        if (head->trx != trx || !head->acquired) continue;
+        *held = holding ? _supremum(*held, head->mode) : head->mode;
+        holding = true;
+    }
 
-    lock_t *curr_lock_node = lock_hash_table_t::table[hashed_idx].head;
+    return holding;
+}
 
-    // Find first lock about same record.
-    while (curr_lock_node && (record_index != curr_lock_node->record_index 
-            || table_id != curr_lock_node->table_id 
-            || page_number != curr_lock_node->page_number)) {
-        curr_lock_node = curr_lock_node->hash_next;
+/**
+ * Count a record lock newly acquired by given transaction for lock escalation.
+ * Caller must hold lock_hash_table_t::table_latch.
+ */
+static void _count_record_lock(trx_t *trx, int table_id, pagenum_t page_number) {
+    ++trx->page_lock_counts[std::make_pair(table_id, page_number)];
+    ++trx->table_lock_counts[table_id];
+}
+
+/**
+ * Collect transactions which given waiting lock waits for.
+ * Those are holders of incompatible locks and,
+ *   unless the waiter upgrades a lock it already holds, all waiters ahead of it.
+ * Caller must hold lock_hash_table_t::table_latch.
+ */
+static void _get_blockers(lock_t *waiting, std::vector<trx_t*> &blockers) {
+    lock_t *head = waiting, *curr;
+    lock_mode_t held;
+    bool ahead = true;
+    bool holding;
+
+    while (head->same_record_prev) {
+        head = head->same_record_prev;
     }
+    holding = _held_mode(head, waiting->trx, &held);
 
-    // case : There is no lock about the record.
-    // Just lock.
-    if (curr_lock_node == nullptr) {
-        new_lock = new lock_t(table_id, page_number, record_index, mode, trx);
-        new_lock->acquired = true;
-        new_lock->hash_prev = lock_hash_table_t::table[hashed_idx].tail;
-        lock_hash_table_t::table[hashed_idx].tail->hash_next = new_lock;
-        lock_hash_table_t::table[hashed_idx].tail = new_lock;
+    for (curr = head; curr; curr = curr->same_record_next) {
+        if (curr == waiting) {
+            ahead = false;
+            continue;
+        }
+        if (curr->trx == waiting->trx) continue;
 
-        trx->trx_locks.push_back(new_lock);
+        if (curr->acquired ? !_compatible(curr->mode, waiting->mode) : (ahead && !holding)) {
+            blockers.push_back(curr->trx);
+        }
+    }
+}
 
-        pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+/**
+ * Unlink given lock from hash list and its resource's lock list, and free it.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \return The head of the resource's lock list after unlinking,
+ *      or nullptr if no lock remains on the resource.
+ */
+static lock_t *_unlink_lock(lock_t *lock) {
+    lock_t *head;
+    lock_hash_table_element_t *element;
+
+    // Unlink from the hash list.
+    element = &lock_hash_table_t::table[lock_hash_table_t::hashing(lock->page_number)];
+    if (lock->hash_prev) {
+        lock->hash_prev->hash_next = lock->hash_next;
+    } else {
+        element->head = lock->hash_next;
+    }
+    if (lock->hash_next) {
+        lock->hash_next->hash_prev = lock->hash_prev;
+    } else {
+        element->tail = lock->hash_prev;
+    }
 
-        return LOCK_SUCCESS;
+    // Unlink from the resource's lock list.
+    head = lock->same_record_prev;
+    while (head && head->same_record_prev) {
+        head = head->same_record_prev;
     }
+    if (lock->same_record_prev) {
+        lock->same_record_prev->same_record_next = lock->same_record_next;
+    }
+    if (lock->same_record_next) {
+        lock->same_record_next->same_record_prev = lock->same_record_prev;
+    }
+    if (head == nullptr) {
+        head = lock->same_record_next;
+    }
+
+    delete lock;
 
-    lock_t *head_of_the_record = curr_lock_node;
-    
-    // traverse the list and check whether given trx already acquired lock for the record.
-    bool lock_upgrade = false;
-    lock_t *tail_of_the_record = nullptr;
-    while (true) {
-        if (curr_lock_node->trx == trx) {
-            /* If lock target record is same and current lock is by given trx. 
-               It means given trx already acquired lock for the record. */
-            
-            if (mode == lock_mode_t::SHARED 
-                    || curr_lock_node->mode == lock_mode_t::EXCLUSIVE) {
-                pthread_mutex_unlock(&lock_hash_table_t::table_latch);
-                return LOCK_SUCCESS;
+    return head;
+}
+
+/**
+ * Grant waiting locks of a resource in the order of request.
+ * A waiting lock is granted when it is compatible with all acquired locks
+ *   of other transactions and no waiter ahead of it is still blocked.
+ * Lock upgrades of a transaction already holding the resource skip the queue.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \param head The first lock of the resource's lock list.
+ */
+static void _grant_waiting_locks(lock_t *head) {
+    lock_t *waiting, *curr;
+    bool blocked_ahead = false;
+    bool holding, grantable;
+
+    for (waiting = head; waiting; waiting = waiting->same_record_next) {
+        if (waiting->acquired) continue;
+
+        holding = false;
+        grantable = true;
+        for (curr = head; curr; curr = curr->same_record_next) {
+            if (!curr->acquired) continue;
+            if (curr->trx == waiting->trx) {
+                holding = true;
+            } else if (!_compatible(curr->mode, waiting->mode)) {
+                grantable = false;
             }
+        }
+
+        if (!grantable || (blocked_ahead && !holding)) {
+            blocked_ahead = true;
+            continue;
+        }
+
+        waiting->acquired = true;
+        if (waiting->record_index >= 0 && !holding) {
+            _count_record_lock(waiting->trx, waiting->table_id, waiting->page_number);
+        }
+
+        pthread_mutex_lock(&waiting->trx->trx_mutex);
+        waiting->trx->waiting_for = nullptr;
+        waiting->trx->status = trx_status_t::RUNNING;
+        pthread_cond_signal(&waiting->trx->trx_cond);
+        pthread_mutex_unlock(&waiting->trx->trx_mutex);
+    }
+}
+
+/**
+ * Release one lock of given transaction and grant locks waiting for it.
+ * Caller must hold lock_hash_table_t::table_latch.
+ */
+static void _release_lock(lock_t *lock) {
+    lock_t *head = _unlink_lock(lock);
+
+    if (head) {
+        _grant_waiting_locks(head);
+    }
+}
+
+/**
+ * Check whether \p waited_trx waits for \p target_trx directly or transitively.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \return LOCK_DEADLOCK if \p target_trx is reachable in the wait-for graph.
+ *      Otherwise, LOCK_SUCCESS.
+ */
+int deadlock_detection(trx_t *target_trx, trx_t *waited_trx) {
+    std::vector<trx_t*> stack(1, waited_trx);
+    std::vector<trx_t*> visited;
+    trx_t *curr_trx;
 
-            // case : need to lock mode upgrade
-            lock_upgrade = true;
-            break; // set flag and break the loop.
+    while (!stack.empty()) {
+        curr_trx = stack.back();
+        stack.pop_back();
+
+        if (curr_trx == target_trx) {
+            return LOCK_DEADLOCK;
+        }
+        if (std::find(visited.begin(), visited.end(), curr_trx) != visited.end()) {
+            continue;
         }
+        visited.push_back(curr_trx);
+
+        if (curr_trx->status == trx_status_t::WAITING) {
+            _get_blockers(curr_trx->waiting_for, stack);
+        }
+    }
 
-        if (curr_lock_node->same_record_next) {
-            curr_lock_node = curr_lock_node->same_record_next;
+    return LOCK_SUCCESS;
+}
+
+/**
+ * Acquire a lock on exactly one resource, without regard to its ancestors.
+ * If given transaction already holds the resource, its lock is upgraded
+ *   to the supremum of held and requested modes.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \param wait If false, give up instead of enqueuing a waiting lock.
+ * \return Same as acquire_lock. If \p wait is false and the lock is not
+ *      acquirable, return LOCK_CONFLICT without enqueuing.
+ */
+static int _acquire_resource(int table_id, pagenum_t page_number
+        , int record_index, lock_mode_t mode, trx_t *trx, bool wait) {
+
+    int hashed_idx = lock_hash_table_t::hashing(page_number);
+    lock_t *head = _find_resource_head(table_id, page_number, record_index);
+    lock_t *curr, *own = nullptr, *new_lock;
+    lock_mode_t held, target = mode;
+    bool holding, blocked = false;
+    std::vector<trx_t*> blockers;
+
+    holding = _held_mode(head, trx, &held);
+    if (holding) {
+        if (_covers(held, mode)) {
+            return LOCK_SUCCESS;
+        }
+        target = _supremum(held, mode);
+    }
+
+    for (curr = head; curr; curr = curr->same_record_next) {
+        if (curr->trx == trx) {
+            if (curr->acquired) own = curr;
             continue;
-        } else {
-            tail_of_the_record = curr_lock_node; // Store the tail of same record list.
+        }
+        if (curr->acquired ? !_compatible(curr->mode, target) : !holding) {
+            blocked = true;
             break;
         }
     }
 
-    if (lock_upgrade) {
-        
-        // Find the tail lock node of same record list.
-        while (curr_lock_node->same_record_next) {
-            curr_lock_node = curr_lock_node->same_record_next;
+    // case : lock is acquirable immediately.
+    if (!blocked) {
+        if (own) {
+            own->mode = target;
+            return LOCK_SUCCESS;
         }
 
-        tail_of_the_record = curr_lock_node;
+        new_lock = new lock_t(table_id, page_number, record_index, target, trx);
+        new_lock->acquired = true;
+        _append_to_hash_list(hashed_idx, new_lock);
+        if (head) {
+            for (curr = head; curr->same_record_next; curr = curr->same_record_next);
+            new_lock->same_record_prev = curr;
+            curr->same_record_next = new_lock;
+        }
+        trx->trx_locks.push_back(new_lock);
 
-        // case : Lock waiting for given trx exists. So, deadlock.
-        if (!curr_lock_node->acquired) {
-            pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+        if (record_index >= 0) {
+            _count_record_lock(trx, table_id, page_number);
+        }
+        return LOCK_SUCCESS;
+    }
+
+    if (!wait) {
+        return LOCK_CONFLICT;
+    }
+
+    // case : need to wait. Enqueue a waiting lock at the tail.
+    new_lock = new lock_t(table_id, page_number, record_index, target, trx);
+    _append_to_hash_list(hashed_idx, new_lock);
+    for (curr = head; curr->same_record_next; curr = curr->same_record_next);
+    new_lock->same_record_prev = curr;
+    curr->same_record_next = new_lock;
+
+    _get_blockers(new_lock, blockers);
+    for (trx_t *blocker : blockers) {
+        if (deadlock_detection(trx, blocker) == LOCK_DEADLOCK) {
+            _unlink_lock(new_lock);
             return LOCK_DEADLOCK;
         }
+    }
 
-        while (curr_lock_node) {
-            // case : There is another S mode lock. Need to wait for it.
-            if (curr_lock_node->trx != trx) {
-                
-                new_lock = new lock_t(table_id, page_number, record_index, mode, trx);
-                trx->waiting_for = curr_lock_node;
-                new_lock->hash_prev = lock_hash_table_t::table[hashed_idx].tail;
-                lock_hash_table_t::table[hashed_idx].tail->hash_next = new_lock;
-                lock_hash_table_t::table[hashed_idx].tail = new_lock;
-                new_lock->same_record_prev = tail_of_the_record;
-                tail_of_the_record->same_record_next = new_lock;
+    trx->trx_locks.push_back(new_lock);
+    trx->waiting_for = new_lock;
+    trx->status = trx_status_t::WAITING;
 
-                trx->trx_locks.push_back(new_lock);
-                trx->status = trx_status_t::WAITING;
+    return LOCK_CONFLICT;
+}
 
-                pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+/**
+ * Try to replace record locks of given transaction on a page
+ *   or pages locks on a table by one coarser lock.
+ * The coarser lock is EXCLUSIVE if any replaced lock allows writing,
+ *   and SHARED otherwise. Escalation never waits. If the coarser lock
+ *   is not acquirable immediately, keep finer locks as they are.
+ * Caller must hold lock_hash_table_t::table_latch.
+ * \param record_index LOCK_ON_PAGE to escalate to a page lock
+ *      or LOCK_ON_TABLE to escalate to a table lock.
+ */
+static void _escalate(trx_t *trx, int table_id, pagenum_t page_number, int record_index) {
+    lock_mode_t mode = lock_mode_t::SHARED;
 
-                return LOCK_CONFLICT;
-            }
-            curr_lock_node = curr_lock_node->same_record_prev;
+    auto replaced = [&](const lock_t *lock) {
+        if (lock->table_id != table_id || lock->record_index == LOCK_ON_TABLE) {
+            return false;
         }
+        return record_index == LOCK_ON_TABLE
+            || (lock->page_number == page_number && lock->record_index >= 0);
+    };
+
+    for (lock_t *lock : trx->trx_locks) {
+        if (replaced(lock) && lock->mode != lock_mode_t::SHARED
+                && lock->mode != lock_mode_t::INTENTION_SHARED) {
+            mode = lock_mode_t::EXCLUSIVE;
+        }
+    }
 
-        // case : can upgrade lock immediately.
-        tail_of_the_record->mode = mode;
+    if (_acquire_resource(table_id, page_number, record_index, mode, trx, false) != LOCK_SUCCESS) {
+        return;
+    }
 
-        pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+    for (auto it = trx->trx_locks.begin(); it != trx->trx_locks.end();) {
+        lock_t *lock = *it;
+        if (replaced(lock)) {
+            it = trx->trx_locks.erase(it);
+            _release_lock(lock);
+        } else {
+            ++it;
+        }
+    }
 
-        return LOCK_SUCCESS;
+    if (record_index == LOCK_ON_TABLE) {
+        auto first = trx->page_lock_counts.lower_bound(std::make_pair(table_id, (pagenum_t)0));
+        auto last = trx->page_lock_counts.lower_bound(std::make_pair(table_id + 1, (pagenum_t)0));
+        trx->page_lock_counts.erase(first, last);
+        trx->table_lock_counts.erase(table_id);
+    } else {
+        trx->page_lock_counts.erase(std::make_pair(table_id, page_number));
     }
+}
 
+/**
+ * Acquire a lock on a record, a page or a whole table.
+ * Before locking a record or a page, intention locks on its ancestors
+ *   are acquired, IS for SHARED request and IX for others.
+ * Nothing is acquired when an ancestor lock already covers the request.
+ * When a transaction holds too many record locks on a page or a table,
+ *   they are escalated to one page or table lock.
+ *
+ * \param page_number Page of the resource. Ignored for table lock.
+ * \param record_index Index of the record in the page,
+ *      LOCK_ON_PAGE for page lock or LOCK_ON_TABLE for table lock.
+ * \return LOCK_SUCCESS if acquired.
+ *         LOCK_CONFLICT if a waiting lock is enqueued. The caller must
+ *           release page latches, call lock_wait and try again.
+ *         LOCK_DEADLOCK if waiting would cause deadlock. Nothing is enqueued,
+ *           and the caller should abort the transaction.
+ */
+int acquire_lock(int table_id, pagenum_t page_number
+        , int record_index, lock_mode_t mode, trx_t *trx) {
 
-    // case : there is only locks by other trx. Check last lock's modes.
-    if (mode == lock_mode_t::SHARED && tail_of_the_record->mode == lock_mode_t::SHARED) {
-        if (tail_of_the_record->acquired) {
+    lock_mode_t intention, held;
+    int result;
 
-            new_lock = new lock_t(table_id, page_number, record_index, mode, trx);
-            new_lock->hash_prev = lock_hash_table_t::table[hashed_idx].tail;
-            lock_hash_table_t::table[hashed_idx].tail->hash_next = new_lock;
-            lock_hash_table_t::table[hashed_idx].tail = new_lock;
-            new_lock->same_record_prev = tail_of_the_record;
-            tail_of_the_record->same_record_next = new_lock;
-            new_lock->acquired = true;
+    if (record_index == LOCK_ON_TABLE) {
+        page_number = 0;
+    }
+
+    intention = (mode == lock_mode_t::SHARED || mode == lock_mode_t::INTENTION_SHARED)
+        ? lock_mode_t::INTENTION_SHARED : lock_mode_t::INTENTION_EXCLUSIVE;
 
-            trx->trx_locks.push_back(new_lock);
+    pthread_mutex_lock(&lock_hash_table_t::table_latch);
 
+    if (record_index != LOCK_ON_TABLE) {
+        // Table level.
+        if (_held_mode(_find_resource_head(table_id, 0, LOCK_ON_TABLE), trx, &held)
+                && _covers(held, mode)) {
             pthread_mutex_unlock(&lock_hash_table_t::table_latch);
             return LOCK_SUCCESS;
-        } else {
-            if (deadlock_detection(trx, tail_of_the_record->trx->waiting_for->trx) == LOCK_DEADLOCK) {
-                pthread_mutex_unlock(&lock_hash_table_t::table_latch);
-                return LOCK_DEADLOCK;
-            }
-            trx->waiting_for = tail_of_the_record->trx->waiting_for;
         }
-    } else {
-        if (deadlock_detection(trx, tail_of_the_record->trx) == LOCK_DEADLOCK) {
+        result = _acquire_resource(table_id, 0, LOCK_ON_TABLE, intention, trx, true);
+        if (result != LOCK_SUCCESS) {
             pthread_mutex_unlock(&lock_hash_table_t::table_latch);
-            return LOCK_DEADLOCK;
+            return result;
         }
-        trx->waiting_for = tail_of_the_record;
     }
 
-    new_lock = new lock_t(table_id, page_number, record_index, mode, trx);
-    new_lock->hash_prev = lock_hash_table_t::table[hashed_idx].tail;
-    lock_hash_table_t::table[hashed_idx].tail->hash_next = new_lock;
-    lock_hash_table_t::table[hashed_idx].tail = new_lock;
-    new_lock->same_record_prev = tail_of_the_record;
-    tail_of_the_record->same_record_next = new_lock;
+    if (record_index >= 0) {
+        // Page level.
+        if (_held_mode(_find_resource_head(table_id, page_number, LOCK_ON_PAGE), trx, &held)
+                && _covers(held, mode)) {
+            pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+            return LOCK_SUCCESS;
+        }
+        result = _acquire_resource(table_id, page_number, LOCK_ON_PAGE, intention, trx, true);
+        if (result != LOCK_SUCCESS) {
+            pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+            return result;
+        }
+    }
 
-    trx->trx_locks.push_back(new_lock);
-    trx->status = trx_status_t::WAITING;
+    result = _acquire_resource(table_id, page_number, record_index, mode, trx, true);
+
+    if (result == LOCK_SUCCESS && record_index >= 0) {
+        if (trx->table_lock_counts[table_id] > LOCK_TABLE_ESCALATION_THRESHOLD) {
+            _escalate(trx, table_id, 0, LOCK_ON_TABLE);
+        } else if (trx->page_lock_counts[std::make_pair(table_id, page_number)]
+                > LOCK_PAGE_ESCALATION_THRESHOLD) {
+            _escalate(trx, table_id, page_number, LOCK_ON_PAGE);
+        }
+    }
 
     pthread_mutex_unlock(&lock_hash_table_t::table_latch);
 
-    return LOCK_CONFLICT;
+    return result;
 }
 
-// int check_conflict(trx_t *trx) {
-
-// }
+/**
+ * Block given transaction until its waiting lock is granted.
+ * The waiting lock must have been enqueued by acquire_lock.
+ */
+void lock_wait(trx_t *trx) {
+    pthread_mutex_lock(&trx->trx_mutex);
+    while (trx->status == trx_status_t::WAITING) {
+        pthread_cond_wait(&trx->trx_cond, &trx->trx_mutex);
+    }
+    pthread_mutex_unlock(&trx->trx_mutex);
+}
 
 /**
- * 
+ * Roll back all modifications of given transaction in reverse order.
+ * Each restoration is logged as a COMPENSATE record,
+ *   so it is redone rather than undone again after a crash.
  */
 void undo_trx(trx_t *trx) {
     buffer_t *temp_page;
     undo_log_t log;
+    char *value;
+    uint64_t lsn;
     while (!trx->undo_logs.empty()) {
         log = trx->undo_logs.top();
         trx->undo_logs.pop();
 
         temp_page = buf_get_page(log.table_id, log.page_number);
-        strncpy(temp_page->frame.leaf_page.records[log.record_index].value, log.old_record, 120);
+        value = temp_page->frame->leaf_page.records[log.record_index].value;
+        lsn = log_write_compensate(trx, log.table_id, log.page_number
+            , value - (char*)temp_page->frame, 120, value, log.old_record, log.prev_lsn);
+        memcpy(value, log.old_record, 120);
+        if (lsn) temp_page->frame->leaf_page.page_lsn = lsn;
         buf_put_page(temp_page, 1);
     }
+    version_discard(trx);
 }
 
-
 /**
- * 
+ * Release all locks of given transaction
+ *   and wake up transactions whose locks become acquirable.
  */
-// void release_locks(trx_t *trx) {
-//     lock_t *temp_lock;
-//     while (!trx->trx_locks.empty()) {
-//         temp_lock = trx->trx_locks.front();
-//         trx->trx_locks.pop_front();
+void release_locks(trx_t *trx) {
+    lock_t *lock;
 
-//         pthread_mutex_lock(&lock_hash_table_t::table_latch);
-//         lok
-//     }
-// }
+    pthread_mutex_lock(&lock_hash_table_t::table_latch);
 
+    while (!trx->trx_locks.empty()) {
+        lock = trx->trx_locks.front();
+        trx->trx_locks.pop_front();
+        _release_lock(lock);
+    }
 
+    trx->waiting_for = nullptr;
+    trx->page_lock_counts.clear();
+    trx->table_lock_counts.clear();
 
-// int end_trx(int tid) {
-//     //TODO
-// }
+    pthread_mutex_unlock(&lock_hash_table_t::table_latch);
+}
@@ -0,0 +1,592 @@
+/*
+ * log_manager.cc
+ */
+
+#include "lock_manager.hpp"
+#include "log_manager.hpp"
+
+
+// STATIC VARIABLES.
+
+pthread_mutex_t log_manager_t::latch = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t log_manager_t::flush_cond = PTHREAD_COND_INITIALIZER;
+pthread_cond_t log_manager_t::flushed_cond = PTHREAD_COND_INITIALIZER;
+pthread_t log_manager_t::flusher;
+bool log_manager_t::running = false;
+int log_manager_t::fd = -1;
+char *log_manager_t::buffers[2] = { NULL, NULL };
+int log_manager_t::active = 0;
+size_t log_manager_t::buffer_used = 0;
+uint64_t log_manager_t::buffer_start_lsn = 0;
+uint64_t log_manager_t::next_lsn = 0;
+uint64_t log_manager_t::flushed_lsn = 0;
+uint64_t log_manager_t::flush_requested_lsn = 0;
+uint64_t log_manager_t::checkpoint_lsn = 0;
+uint64_t log_manager_t::table_lsns[MAX_TABLE_ID + 1] = {};
+
+/**
+ * Read-ahead buffer of log_read.
+ */
+static char *read_buffer = NULL;
+static uint64_t read_buffer_lsn = 0;
+static size_t read_buffer_len = 0;
+
+
+// FUNCTIONS.
+
+/**
+ * Body of the group commit thread.
+ * Whenever somebody waits for durability or the active buffer gets half full,
+ *   swap buffers and write out everything appended so far
+ *   with a single write and a single fdatasync.
+ * Commits which arrive during an fdatasync are gathered into the next one.
+ */
+static void *_flusher_main(void *) {
+    char *buf;
+    size_t len;
+    uint64_t start_lsn;
+
+    pthread_mutex_lock(&log_manager_t::latch);
+
+    while (true) {
+        while (log_manager_t::running
+                && log_manager_t::flush_requested_lsn < log_manager_t::flushed_lsn
+                && log_manager_t::buffer_used < LOG_BUFFER_SIZE / 2) {
+            pthread_cond_wait(&log_manager_t::flush_cond, &log_manager_t::latch);
+        }
+
+        if (log_manager_t::buffer_used == 0) {
+            if (!log_manager_t::running) break;
+            log_manager_t::flush_requested_lsn = 0;
+            continue;
+        }
+
+        buf = log_manager_t::buffers[log_manager_t::active];
+        len = log_manager_t::buffer_used;
+        start_lsn = log_manager_t::buffer_start_lsn;
+
+        log_manager_t::active ^= 1;
+        log_manager_t::buffer_used = 0;
+        log_manager_t::buffer_start_lsn += len;
+
+        // Appenders waiting for space can continue with the other buffer.
+        pthread_cond_broadcast(&log_manager_t::flushed_cond);
+        pthread_mutex_unlock(&log_manager_t::latch);
+
+        if (pwrite(log_manager_t::fd, buf, len, start_lsn) != (ssize_t)len) {
+            perror("Fail to write log");
+            exit(EXIT_FAILURE);
+        }
+        fdatasync(log_manager_t::fd);
+
+        pthread_mutex_lock(&log_manager_t::latch);
+        log_manager_t::flushed_lsn = start_lsn + len;
+        pthread_cond_broadcast(&log_manager_t::flushed_cond);
+    }
+
+    pthread_mutex_unlock(&log_manager_t::latch);
+
+    return NULL;
+}
+
+/**
+ * Open or create the log file and start the group commit thread.
+ * New records are appended after the existing end of log.
+ * \param log_path Path name of the log file.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int log_init(char *log_path) {
+    char header[LOG_HEADER_SIZE] = "BPTLOG";
+    off_t size;
+
+    if (log_manager_t::fd >= 0) {
+        return 1;
+    }
+
+    log_manager_t::fd = open(log_path, O_RDWR | O_CREAT, S_IRWXG | S_IRWXU | S_IRWXO);
+    if (log_manager_t::fd < 0) {
+        return 1;
+    }
+
+    size = lseek(log_manager_t::fd, 0, SEEK_END);
+    if (size < LOG_HEADER_SIZE) {
+        pwrite(log_manager_t::fd, header, LOG_HEADER_SIZE, 0);
+        fdatasync(log_manager_t::fd);
+        size = LOG_HEADER_SIZE;
+    }
+    log_manager_t::checkpoint_lsn = 0;
+    pread(log_manager_t::fd, &log_manager_t::checkpoint_lsn, 8, LOG_CHECKPOINT_LSN_OFFSET);
+    memset(log_manager_t::table_lsns, 0, sizeof(log_manager_t::table_lsns));
+
+    log_manager_t::buffers[0] = new char[LOG_BUFFER_SIZE];
+    log_manager_t::buffers[1] = new char[LOG_BUFFER_SIZE];
+    log_manager_t::active = 0;
+    log_manager_t::buffer_used = 0;
+    log_manager_t::buffer_start_lsn = size;
+    log_manager_t::next_lsn = size;
+    log_manager_t::flushed_lsn = size;
+    log_manager_t::flush_requested_lsn = 0;
+    log_manager_t::running = true;
+
+    if (pthread_create(&log_manager_t::flusher, NULL, _flusher_main, NULL) != 0) {
+        log_manager_t::running = false;
+        close(log_manager_t::fd);
+        log_manager_t::fd = -1;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Write out all remaining log records, stop the group commit thread
+ *   and close the log file.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int log_shutdown(void) {
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&log_manager_t::latch);
+    log_manager_t::running = false;
+    pthread_cond_signal(&log_manager_t::flush_cond);
+    pthread_mutex_unlock(&log_manager_t::latch);
+
+    pthread_join(log_manager_t::flusher, NULL);
+
+    delete[] log_manager_t::buffers[0];
+    delete[] log_manager_t::buffers[1];
+    log_manager_t::buffers[0] = log_manager_t::buffers[1] = NULL;
+    delete[] read_buffer;
+    read_buffer = NULL;
+    read_buffer_len = 0;
+
+    if (close(log_manager_t::fd) != 0) {
+        return 1;
+    }
+    log_manager_t::fd = -1;
+
+    return 0;
+}
+
+/**
+ * Check whether write-ahead logging is turned on by init_db.
+ */
+bool log_enabled(void) {
+    return log_manager_t::fd >= 0;
+}
+
+/**
+ * Get LSN the next log record will have.
+ * Read without the log latch, so it may be a little behind
+ *   but never ahead of records appended so far.
+ */
+uint64_t log_end_lsn(void) {
+    if (!log_enabled()) {
+        return 0;
+    }
+    return __atomic_load_n(&log_manager_t::next_lsn, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Get on-disk size of a log record.
+ * \param length Length of each image. Ignored if the type has no image.
+ */
+uint32_t log_record_size(log_type_t type, uint32_t length) {
+    switch (type) {
+    case log_type_t::UPDATE:
+        return LOG_RECORD_HEADER_SIZE + 20 + 2 * length;
+    case log_type_t::COMPENSATE:
+        return LOG_RECORD_HEADER_SIZE + 20 + 2 * length + 8;
+    case log_type_t::TABLE:
+        return LOG_RECORD_HEADER_SIZE + 8 + length;
+    case log_type_t::CHECKPOINT:
+        return LOG_RECORD_HEADER_SIZE + length;
+    default:
+        return LOG_RECORD_HEADER_SIZE;
+    }
+}
+
+/**
+ * Write given log record to \p dest in on-disk form.
+ * \p dest must have at least rec->log_size bytes.
+ */
+void log_serialize(const log_record_t *rec, char *dest) {
+    memcpy(dest, &rec->log_size, 4);
+    memcpy(dest + 4, &rec->lsn, 8);
+    memcpy(dest + 12, &rec->prev_lsn, 8);
+    memcpy(dest + 20, &rec->trx_id, 4);
+    memcpy(dest + 24, &rec->type, 4);
+
+    if (rec->type == log_type_t::TABLE) {
+        memcpy(dest + LOG_RECORD_HEADER_SIZE, &rec->table_id, 4);
+        memcpy(dest + LOG_RECORD_HEADER_SIZE + 4, &rec->length, 4);
+        memcpy(dest + LOG_RECORD_HEADER_SIZE + 8, rec->pathname, rec->length);
+        return;
+    }
+
+    if (rec->type == log_type_t::CHECKPOINT) {
+        memcpy(dest + LOG_RECORD_HEADER_SIZE, rec->payload, rec->length);
+        return;
+    }
+
+    if (rec->type != log_type_t::UPDATE && rec->type != log_type_t::COMPENSATE) {
+        return;
+    }
+
+    dest += LOG_RECORD_HEADER_SIZE;
+    memcpy(dest, &rec->table_id, 4);
+    memcpy(dest + 4, &rec->page_number, 8);
+    memcpy(dest + 12, &rec->offset, 4);
+    memcpy(dest + 16, &rec->length, 4);
+    memcpy(dest + 20, rec->old_image, rec->length);
+    memcpy(dest + 20 + rec->length, rec->new_image, rec->length);
+
+    if (rec->type == log_type_t::COMPENSATE) {
+        memcpy(dest + 20 + 2 * rec->length, &rec->next_undo_lsn, 8);
+    }
+}
+
+/**
+ * Read a log record in on-disk form.
+ * \param len Number of valid bytes from \p src .
+ * \return If \p src holds a complete and well-formed record, return 0.
+ *      Otherwise (e.g., torn record at the end of log), return non-zero value.
+ */
+int log_parse(const char *src, size_t len, log_record_t *rec) {
+    if (len < LOG_RECORD_HEADER_SIZE) {
+        return 1;
+    }
+
+    memcpy(&rec->log_size, src, 4);
+    memcpy(&rec->lsn, src + 4, 8);
+    memcpy(&rec->prev_lsn, src + 12, 8);
+    memcpy(&rec->trx_id, src + 20, 4);
+    memcpy(&rec->type, src + 24, 4);
+
+    if (rec->log_size < LOG_RECORD_HEADER_SIZE || rec->log_size > len
+            || (int)rec->type < (int)log_type_t::BEGIN
+            || (int)rec->type > (int)log_type_t::CHECKPOINT) {
+        return 1;
+    }
+
+    if (rec->type == log_type_t::TABLE) {
+        if (rec->log_size < LOG_RECORD_HEADER_SIZE + 8) {
+            return 1;
+        }
+        memcpy(&rec->table_id, src + LOG_RECORD_HEADER_SIZE, 4);
+        memcpy(&rec->length, src + LOG_RECORD_HEADER_SIZE + 4, 4);
+        if (rec->length >= LOG_MAX_PATH_LENGTH
+                || rec->log_size != log_record_size(rec->type, rec->length)) {
+            return 1;
+        }
+        memcpy(rec->pathname, src + LOG_RECORD_HEADER_SIZE + 8, rec->length);
+        rec->pathname[rec->length] = '\0';
+        return 0;
+    }
+
+    if (rec->type == log_type_t::CHECKPOINT) {
+        rec->length = rec->log_size - LOG_RECORD_HEADER_SIZE;
+        rec->payload = src + LOG_RECORD_HEADER_SIZE;
+        return 0;
+    }
+
+    if (rec->type != log_type_t::UPDATE && rec->type != log_type_t::COMPENSATE) {
+        return rec->log_size == LOG_RECORD_HEADER_SIZE ? 0 : 1;
+    }
+
+    if (rec->log_size < LOG_RECORD_HEADER_SIZE + 20) {
+        return 1;
+    }
+    src += LOG_RECORD_HEADER_SIZE;
+    memcpy(&rec->table_id, src, 4);
+    memcpy(&rec->page_number, src + 4, 8);
+    memcpy(&rec->offset, src + 12, 4);
+    memcpy(&rec->length, src + 16, 4);
+
+    if (rec->length > LOG_MAX_IMAGE_SIZE
+            || rec->log_size != log_record_size(rec->type, rec->length)) {
+        return 1;
+    }
+    memcpy(rec->old_image, src + 20, rec->length);
+    memcpy(rec->new_image, src + 20 + rec->length, rec->length);
+
+    if (rec->type == log_type_t::COMPENSATE) {
+        memcpy(&rec->next_undo_lsn, src + 20 + 2 * rec->length, 8);
+    }
+
+    return 0;
+}
+
+/**
+ * Append a log record to the log buffer.
+ * LSN of the record is assigned here. The record is not durable yet.
+ * \param rec Log record to append. log_size and lsn are filled in.
+ * \return LSN of the record, or 0 if logging is turned off.
+ */
+uint64_t log_write(log_record_t *rec) {
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    rec->log_size = log_record_size(rec->type, rec->length);
+
+    pthread_mutex_lock(&log_manager_t::latch);
+
+    // Wait until the group commit thread swaps buffers.
+    while (log_manager_t::buffer_used + rec->log_size > LOG_BUFFER_SIZE) {
+        pthread_cond_signal(&log_manager_t::flush_cond);
+        pthread_cond_wait(&log_manager_t::flushed_cond, &log_manager_t::latch);
+    }
+
+    rec->lsn = log_manager_t::next_lsn;
+    log_serialize(rec, log_manager_t::buffers[log_manager_t::active] + log_manager_t::buffer_used);
+    log_manager_t::buffer_used += rec->log_size;
+    __atomic_store_n(&log_manager_t::next_lsn, rec->lsn + rec->log_size, __ATOMIC_RELEASE);
+
+    if (log_manager_t::buffer_used >= LOG_BUFFER_SIZE / 2) {
+        pthread_cond_signal(&log_manager_t::flush_cond);
+    }
+
+    pthread_mutex_unlock(&log_manager_t::latch);
+
+    return rec->lsn;
+}
+
+/**
+ * Make all log records up to given LSN durable.
+ * Called before a dirty page is written to keep the write-ahead rule,
+ *   and at commit. Concurrent callers share one fdatasync.
+ * \param lsn LSN of the last record which must be durable.
+ */
+void log_flush(uint64_t lsn) {
+    if (!log_enabled()) {
+        return;
+    }
+
+    pthread_mutex_lock(&log_manager_t::latch);
+
+    if (lsn >= log_manager_t::next_lsn) {
+        lsn = log_manager_t::next_lsn - 1;
+    }
+
+    while (log_manager_t::flushed_lsn <= lsn) {
+        if (log_manager_t::flush_requested_lsn < lsn) {
+            log_manager_t::flush_requested_lsn = lsn;
+        }
+        pthread_cond_signal(&log_manager_t::flush_cond);
+        pthread_cond_wait(&log_manager_t::flushed_cond, &log_manager_t::latch);
+    }
+
+    pthread_mutex_unlock(&log_manager_t::latch);
+}
+
+/**
+ * Append a record of given type without any body, linked to trx's previous record.
+ */
+static uint64_t _write_trx_record(trx_t *trx, log_type_t type) {
+    log_record_t rec;
+
+    rec.type = type;
+    rec.length = 0;
+    rec.trx_id = trx->tid;
+    rec.prev_lsn = trx->last_lsn;
+    trx->last_lsn = log_write(&rec);
+
+    return trx->last_lsn;
+}
+
+/**
+ * Append an UPDATE record of given transaction.
+ * A BEGIN record is written before the first update of a transaction,
+ *   so transactions that never write leave nothing in the log.
+ * \param offset Offset of modified bytes from the beginning of the page.
+ * \return LSN of the record, which should be stamped in the page.
+ */
+uint64_t log_write_update(trx_t *trx, int table_id, pagenum_t page_number
+        , uint32_t offset, uint32_t length, const char *old_image, const char *new_image) {
+    log_record_t rec;
+
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    if (trx->last_lsn == 0) {
+        _write_trx_record(trx, log_type_t::BEGIN);
+    }
+
+    rec.type = log_type_t::UPDATE;
+    rec.trx_id = trx->tid;
+    rec.prev_lsn = trx->last_lsn;
+    rec.table_id = table_id;
+    rec.page_number = page_number;
+    rec.offset = offset;
+    rec.length = length;
+    memcpy(rec.old_image, old_image, length);
+    memcpy(rec.new_image, new_image, length);
+    trx->last_lsn = log_write(&rec);
+
+    return trx->last_lsn;
+}
+
+/**
+ * Append a COMPENSATE record for an update undone by rollback.
+ * \param old_image Image before undo, i.e. after image of the undone update.
+ * \param new_image Image after undo, i.e. before image of the undone update.
+ * \param next_undo_lsn prev_lsn of the undone update.
+ *      The next record of the transaction to be undone.
+ * \return LSN of the record, which should be stamped in the page.
+ */
+uint64_t log_write_compensate(trx_t *trx, int table_id, pagenum_t page_number
+        , uint32_t offset, uint32_t length, const char *old_image, const char *new_image
+        , uint64_t next_undo_lsn) {
+    log_record_t rec;
+
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    rec.type = log_type_t::COMPENSATE;
+    rec.trx_id = trx->tid;
+    rec.prev_lsn = trx->last_lsn;
+    rec.table_id = table_id;
+    rec.page_number = page_number;
+    rec.offset = offset;
+    rec.length = length;
+    memcpy(rec.old_image, old_image, length);
+    memcpy(rec.new_image, new_image, length);
+    rec.next_undo_lsn = next_undo_lsn;
+    trx->last_lsn = log_write(&rec);
+
+    return trx->last_lsn;
+}
+
+/**
+ * Append a TABLE record which binds given table id to its path name.
+ * Written whenever a table is opened, so that recovery can find
+ *   the file of every table id used in later records.
+ * \return LSN of the record, or 0 if logging is turned off.
+ */
+uint64_t log_write_table(int table_id, const char *pathname) {
+    log_record_t rec;
+
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    rec.type = log_type_t::TABLE;
+    rec.trx_id = 0;
+    rec.prev_lsn = 0;
+    rec.table_id = table_id;
+    rec.length = strlen(pathname);
+    if (rec.length >= LOG_MAX_PATH_LENGTH) {
+        return 0;
+    }
+    memcpy(rec.pathname, pathname, rec.length + 1);
+    log_manager_t::table_lsns[table_id] = log_write(&rec);
+
+    return log_manager_t::table_lsns[table_id];
+}
+
+/**
+ * Append a COMMIT record and wait until it becomes durable.
+ * Read-only transactions skip logging.
+ */
+void log_commit(trx_t *trx) {
+    if (!log_enabled() || trx->last_lsn == 0) {
+        return;
+    }
+
+    log_flush(_write_trx_record(trx, log_type_t::COMMIT));
+}
+
+/**
+ * Append a ROLLBACK record after all updates of the transaction are undone.
+ * It needs not to be durable at once. Without it, recovery undoes again.
+ */
+void log_rollback(trx_t *trx) {
+    if (!log_enabled() || trx->last_lsn == 0) {
+        return;
+    }
+
+    _write_trx_record(trx, log_type_t::ROLLBACK);
+}
+
+/**
+ * Read the log record at given LSN from the log file.
+ * Records are read through a read-ahead buffer, so a sequential scan
+ *   costs one pread per LOG_READ_BUFFER_SIZE bytes.
+ * Only records already written to the file can be read.
+ * Not thread safe. Used by recovery before any transaction starts.
+ * \return If there is a complete record at \p lsn , return 0.
+ *      Otherwise, return non-zero value.
+ */
+int log_read(uint64_t lsn, log_record_t *rec) {
+    ssize_t len;
+
+    if (!log_enabled()) {
+        return 1;
+    }
+    if (read_buffer == NULL) {
+        read_buffer = new char[LOG_READ_BUFFER_SIZE];
+    }
+
+    if (lsn >= read_buffer_lsn && lsn < read_buffer_lsn + read_buffer_len
+            && log_parse(read_buffer + (lsn - read_buffer_lsn)
+                , read_buffer_len - (lsn - read_buffer_lsn), rec) == 0) {
+        return 0;
+    }
+
+    len = pread(log_manager_t::fd, read_buffer, LOG_READ_BUFFER_SIZE, lsn);
+    if (len <= 0) {
+        read_buffer_len = 0;
+        return 1;
+    }
+    read_buffer_lsn = lsn;
+    read_buffer_len = len;
+
+    return log_parse(read_buffer, read_buffer_len, rec);
+}
+
+/**
+ * Discard the log from given LSN to the end.
+ * Used to cut off a torn record written partially at crash.
+ * Must be called before any record is appended.
+ */
+void log_truncate(uint64_t lsn) {
+    if (!log_enabled()) {
+        return;
+    }
+
+    pthread_mutex_lock(&log_manager_t::latch);
+
+    if (ftruncate(log_manager_t::fd, lsn) == 0) {
+        fdatasync(log_manager_t::fd);
+        log_manager_t::buffer_start_lsn = lsn;
+        log_manager_t::next_lsn = lsn;
+        log_manager_t::flushed_lsn = lsn;
+    }
+    read_buffer_len = 0;
+
+    pthread_mutex_unlock(&log_manager_t::latch);
+}
+
+/**
+ * Point the log header to given checkpoint record.
+ * The record must be durable already.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int log_write_master(uint64_t checkpoint_lsn) {
+    if (!log_enabled()) {
+        return 1;
+    }
+
+    if (pwrite(log_manager_t::fd, &checkpoint_lsn, 8, LOG_CHECKPOINT_LSN_OFFSET) != 8
+            || fdatasync(log_manager_t::fd) != 0) {
+        return 1;
+    }
+    log_manager_t::checkpoint_lsn = checkpoint_lsn;
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "page_codec.h"
+
+/*
+ * LZ77 codec for pages, in the block format of LZ4.
+ * A block is a sequence of
+ *   token: high 4 bits literal length, low 4 bits match length - PAGE_CODEC_MIN_MATCH,
+ *     each 15 continued by bytes added to it, until a byte other than 255,
+ *   literals,
+ *   2-byte little-endian offset of the match and the continued match length.
+ * The last sequence has literals only.
+ */
+
+
+// FUNCTION DEFINITIONS.
+
+static uint32_t _read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static int _hash(uint32_t value) {
+    return (value * 2654435761u) >> (32 - PAGE_CODEC_HASH_BITS);
+}
+
+/**
+ * Write a length continued after a token nibble of 15.
+ * \return Next output position, or NULL if it doesn't fit.
+ */
+static uint8_t *_write_length(uint8_t *op, const uint8_t *oend, int length) {
+    for (; length >= 255; length -= 255) {
+        if (op >= oend) return NULL;
+        *op++ = 255;
+    }
+    if (op >= oend) return NULL;
+    *op++ = length;
+    return op;
+}
+
+/**
+ * Write a sequence of literals and a match.
+ * \param match_length Length of the match, or 0 for the last sequence.
+ * \return Next output position, or NULL if it doesn't fit.
+ */
+static uint8_t *_write_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals
+        , int literal_length, int offset, int match_length) {
+    uint8_t *token = op++;
+    int code = match_length ? match_length - PAGE_CODEC_MIN_MATCH : 0;
+
+    if (token >= oend) return NULL;
+    *token = (literal_length < 15 ? literal_length : 15) << 4 | (code < 15 ? code : 15);
+    if (literal_length >= 15 && !(op = _write_length(op, oend, literal_length - 15))) {
+        return NULL;
+    }
+    if (literal_length > oend - op) return NULL;
+    memcpy(op, literals, literal_length);
+    op += literal_length;
+
+    if (match_length) {
+        if (oend - op < 2) return NULL;
+        *op++ = offset & 0xFF;
+        *op++ = offset >> 8;
+        if (code >= 15 && !(op = _write_length(op, oend, code - 15))) {
+            return NULL;
+        }
+    }
+    return op;
+}
+
+/**
+ * Compress a buffer, taking the first match found by a hash table of 4-byte prefixes.
+ * \param capacity Size of \p dest . Compression fails if the output doesn't fit,
+ *   so callers pass the largest size worth storing.
+ * \return Compressed size, or 0 if it doesn't fit in \p capacity .
+ */
+int page_compress(const char *src, int src_size, char *dest, int capacity) {
+    int32_t table[1 << PAGE_CODEC_HASH_BITS];
+    const uint8_t *base = (const uint8_t*)src;
+    const uint8_t *ip = base, *anchor = base, *end = base + src_size;
+    const uint8_t *match_limit = src_size > PAGE_CODEC_MATCH_LIMIT ? end - PAGE_CODEC_MATCH_LIMIT : base;
+    const uint8_t *ref;
+    uint8_t *op = (uint8_t*)dest, *oend = (uint8_t*)dest + capacity;
+    int h, length;
+
+    memset(table, -1, sizeof(table));
+
+    while (ip < match_limit) {
+        h = _hash(_read32(ip));
+        ref = table[h] < 0 ? NULL : base + table[h];
+        table[h] = ip - base;
+
+        if (!ref || ip - ref > PAGE_CODEC_MAX_OFFSET || _read32(ref) != _read32(ip)) {
+            ++ip;
+            continue;
+        }
+
+        length = PAGE_CODEC_MIN_MATCH;
+        while (ip + length < end - PAGE_CODEC_LAST_LITERALS && ref[length] == ip[length]) {
+            ++length;
+        }
+
+        op = _write_sequence(op, oend, anchor, ip - anchor, ip - ref, length);
+        if (!op) return 0;
+        ip += length;
+        anchor = ip;
+    }
+
+    op = _write_sequence(op, oend, anchor, end - anchor, 0, 0);
+    return op ? op - (uint8_t*)dest : 0;
+}
+
+/**
+ * Decompress a buffer. Corrupted input never makes it read or write out of bounds.
+ * \return Decompressed size, or -1 if the input is corrupted or too large for \p dest_size .
+ */
+int page_decompress(const char *src, int src_size, char *dest, int dest_size) {
+    const uint8_t *ip = (const uint8_t*)src, *iend = ip + src_size;
+    uint8_t *op = (uint8_t*)dest, *oend = op + dest_size;
+    const uint8_t *ref;
+    int token, length, offset;
+    uint8_t byte;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        length = token >> 4;
+        if (length == 15) {
+            do {
+                if (ip >= iend) return -1;
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+        }
+        if (length > iend - ip || length > oend - op) return -1;
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        // The last sequence has no match.
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -1;
+        offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > op - (uint8_t*)dest) return -1;
+
+        length = (token & 15) + PAGE_CODEC_MIN_MATCH;
+        if ((token & 15) == 15) {
+            do {
+                if (ip >= iend) return -1;
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+        }
+        if (length > oend - op) return -1;
+
+        // Byte by byte, since a match may overlap its own output.
+        for (ref = op - offset; length > 0; --length) {
+            *op++ = *ref++;
+        }
+    }
+
+    return op - (uint8_t*)dest;
+}
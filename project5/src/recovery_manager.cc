@@ -0,0 +1,582 @@
+/*
+ * recovery_manager.cc
+ */
+
+#include <set>
+#include <time.h>
+#include <unistd.h>
+
+#include "disk_based_bpt.hpp"
+#include "recovery_manager.hpp"
+
+
+// STATIC VARIABLES.
+
+pthread_mutex_t checkpoint_manager_t::latch = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t checkpoint_manager_t::cond = PTHREAD_COND_INITIALIZER;
+pthread_t checkpoint_manager_t::thread;
+bool checkpoint_manager_t::running = false;
+
+
+// FUNCTIONS.
+
+/**
+ * Body of a redo thread.
+ * Reapply each modification of the partition
+ *   unless the page already reflects it.
+ */
+static void *_redo_main(void *arg) {
+    redo_partition_t *partition = (redo_partition_t*)arg;
+    buffer_t *temp_page;
+
+    for (const redo_item_t &item : partition->items) {
+        temp_page = buf_get_page(item.table_id, item.page_number);
+        if (temp_page->frame->leaf_page.page_lsn >= item.lsn) {
+            buf_put_page(temp_page, 0);
+            continue;
+        }
+        memcpy((char*)temp_page->frame + item.offset, item.image, item.length);
+        temp_page->frame->leaf_page.page_lsn = item.lsn;
+        // The change is older than the pin, so rec_lsn set by the pin is too late.
+        if (temp_page->rec_lsn > item.lsn) {
+            temp_page->rec_lsn = item.lsn;
+        }
+        buf_put_page(temp_page, 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Redo given modifications.
+ * They are partitioned by hash of (table id, page number) into one partition
+ *   per online processor, and each partition is redone by its own thread.
+ * \param items Modifications in LSN order.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _redo(const std::vector<redo_item_t> &items) {
+    long num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<redo_partition_t> partitions;
+    uint64_t hashed;
+    int result = 0;
+
+    if (num_workers < 1 || items.size() < RECOVERY_PARALLEL_THRESHOLD) {
+        num_workers = 1;
+    } else if (num_workers > RECOVERY_MAX_WORKERS) {
+        num_workers = RECOVERY_MAX_WORKERS;
+    }
+
+    partitions.resize(num_workers);
+    for (const redo_item_t &item : items) {
+        hashed = item.page_number * 31 + item.table_id;
+        partitions[hashed % num_workers].items.push_back(item);
+    }
+
+    if (num_workers == 1) {
+        _redo_main(&partitions[0]);
+        return 0;
+    }
+
+    for (long i = 0; i < num_workers; ++i) {
+        if (pthread_create(&partitions[i].thread, NULL, _redo_main, &partitions[i]) != 0) {
+            // Redo the rest here. Pages of different partitions never overlap.
+            _redo_main(&partitions[i]);
+            partitions[i].thread = pthread_self();
+        }
+    }
+    for (long i = 0; i < num_workers; ++i) {
+        if (!pthread_equal(partitions[i].thread, pthread_self())) {
+            result |= pthread_join(partitions[i].thread, NULL);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Roll back loser transactions together, from the latest record to the oldest.
+ * Every restoration is logged as a COMPENSATE record,
+ *   and a loser gets a ROLLBACK record when it has nothing left to undo.
+ * An undo interrupted by another crash resumes from next_undo_lsn
+ *   of the last COMPENSATE record.
+ * A table id in the log may be bound to another path later,
+ *   so the table of a record is resolved by its LSN.
+ * \param losers Loser transactions whose last_lsn is their last record.
+ * \param record_tables Current table id of each record found by analysis.
+ * \param checkpoint_table_ids Binding LSN and current table id of each table id
+ *          in the checkpoint, for records before the analysis started.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _undo(std::vector<trx_t*> &losers, const std::map<uint64_t, int> &record_tables
+        , const std::map<int, std::pair<uint64_t, int>> &checkpoint_table_ids) {
+    std::map<uint64_t, trx_t*> to_undo;
+    log_record_t rec;
+    buffer_t *temp_page;
+    char *target;
+    trx_t *trx;
+    uint64_t lsn, next_lsn;
+    int table_id, result = 0;
+
+    for (trx_t *loser : losers) {
+        to_undo[loser->last_lsn] = loser;
+    }
+
+    while (!to_undo.empty()) {
+        auto pos = std::prev(to_undo.end());
+        lsn = pos->first;
+        trx = pos->second;
+        to_undo.erase(pos);
+
+        if (log_read(lsn, &rec) != 0) {
+            result = 1;
+            next_lsn = 0;
+        } else if (rec.type == log_type_t::UPDATE) {
+            auto record_table = record_tables.find(lsn);
+            auto checkpoint_table = checkpoint_table_ids.find(rec.table_id);
+            table_id = 0;
+            if (record_table != record_tables.end()) {
+                table_id = record_table->second;
+            } else if (checkpoint_table != checkpoint_table_ids.end()
+                    && checkpoint_table->second.first < lsn) {
+                table_id = checkpoint_table->second.second;
+            }
+            if (table_id > 0) {
+                temp_page = buf_get_page(table_id, rec.page_number);
+                target = (char*)temp_page->frame + rec.offset;
+                temp_page->frame->leaf_page.page_lsn = log_write_compensate(trx
+                    , table_id, rec.page_number, rec.offset, rec.length
+                    , target, rec.old_image, rec.prev_lsn);
+                memcpy(target, rec.old_image, rec.length);
+                buf_put_page(temp_page, 1);
+            } else {
+                result = 1;
+            }
+            next_lsn = rec.prev_lsn;
+        } else if (rec.type == log_type_t::COMPENSATE) {
+            next_lsn = rec.next_undo_lsn;
+        } else {
+            next_lsn = rec.type == log_type_t::BEGIN ? 0 : rec.prev_lsn;
+        }
+
+        if (next_lsn == 0) {
+            log_rollback(trx);
+            delete trx;
+        } else {
+            to_undo[next_lsn] = trx;
+        }
+    }
+    losers.clear();
+
+    return result;
+}
+
+/**
+ * Append \p len bytes from \p src to a checkpoint payload.
+ */
+static void _put(std::string &payload, const void *src, size_t len) {
+    payload.append((const char*)src, len);
+}
+
+/**
+ * Read \p len bytes of a checkpoint payload from \p pos into \p dest .
+ * \return If the payload has enough bytes, return 0. Otherwise, return non-zero value.
+ */
+static int _get(const log_record_t *rec, size_t &pos, void *dest, size_t len) {
+    if (pos + len > rec->length) {
+        return 1;
+    }
+    memcpy(dest, rec->payload + pos, len);
+    pos += len;
+    return 0;
+}
+
+/**
+ * Write given checkpoint to on-disk form.
+ * Layout: begin_lsn 8, next_tid 4,
+ *   number of tables 4, (table_id 4, lsn 8, path length 4, path) per table,
+ *   number of trxs 4, (tid 4, last_lsn 8) per trx,
+ *   number of dirty pages 4, (table_id 4, page_number 8, rec_lsn 8) per page.
+ */
+static std::string _serialize_checkpoint(const checkpoint_t &ckpt) {
+    std::string payload;
+    uint32_t count, len;
+
+    _put(payload, &ckpt.begin_lsn, 8);
+    _put(payload, &ckpt.next_tid, 4);
+
+    count = ckpt.tables.size();
+    _put(payload, &count, 4);
+    for (const checkpoint_table_t &table : ckpt.tables) {
+        len = table.pathname.size();
+        _put(payload, &table.table_id, 4);
+        _put(payload, &table.lsn, 8);
+        _put(payload, &len, 4);
+        _put(payload, table.pathname.data(), len);
+    }
+
+    count = ckpt.trxs.size();
+    _put(payload, &count, 4);
+    for (const auto &trx : ckpt.trxs) {
+        _put(payload, &trx.first, 4);
+        _put(payload, &trx.second, 8);
+    }
+
+    count = ckpt.dirty_pages.size();
+    _put(payload, &count, 4);
+    for (const dirty_page_t &dirty_page : ckpt.dirty_pages) {
+        _put(payload, &dirty_page.table_id, 4);
+        _put(payload, &dirty_page.page_number, 8);
+        _put(payload, &dirty_page.rec_lsn, 8);
+    }
+
+    return payload;
+}
+
+/**
+ * Read a checkpoint from a CHECKPOINT record.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _parse_checkpoint(const log_record_t *rec, checkpoint_t &ckpt) {
+    size_t pos = 0;
+    uint32_t count, len;
+    checkpoint_table_t table;
+    std::pair<int, uint64_t> trx;
+    dirty_page_t dirty_page;
+    char pathname[LOG_MAX_PATH_LENGTH];
+
+    if (_get(rec, pos, &ckpt.begin_lsn, 8) || _get(rec, pos, &ckpt.next_tid, 4)
+            || _get(rec, pos, &count, 4)) {
+        return 1;
+    }
+    while (count--) {
+        if (_get(rec, pos, &table.table_id, 4) || _get(rec, pos, &table.lsn, 8)
+                || _get(rec, pos, &len, 4) || len >= LOG_MAX_PATH_LENGTH
+                || _get(rec, pos, pathname, len)) {
+            return 1;
+        }
+        table.pathname.assign(pathname, len);
+        ckpt.tables.push_back(table);
+    }
+
+    if (_get(rec, pos, &count, 4)) {
+        return 1;
+    }
+    while (count--) {
+        if (_get(rec, pos, &trx.first, 4) || _get(rec, pos, &trx.second, 8)) {
+            return 1;
+        }
+        ckpt.trxs.push_back(trx);
+    }
+
+    if (_get(rec, pos, &count, 4)) {
+        return 1;
+    }
+    while (count--) {
+        if (_get(rec, pos, &dirty_page.table_id, 4)
+                || _get(rec, pos, &dirty_page.page_number, 8)
+                || _get(rec, pos, &dirty_page.rec_lsn, 8)) {
+            return 1;
+        }
+        ckpt.dirty_pages.push_back(dirty_page);
+    }
+
+    return 0;
+}
+
+/**
+ * Take a fuzzy checkpoint.
+ * Record open tables, transactions and the dirty page table in the log
+ *   without writing any page or stopping transactions,
+ *   then point the log header to the record.
+ * Dirty pages are written by the checkpoint thread separately.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int checkpoint(void) {
+    checkpoint_t ckpt;
+    checkpoint_table_t table;
+    std::string payload;
+    log_record_t rec;
+    uint64_t lsn;
+    int table_id;
+
+    if (!log_enabled()) {
+        return 1;
+    }
+
+    // Anything logged before gathering begins is covered by what is gathered.
+    ckpt.begin_lsn = log_end_lsn();
+
+    for (table_id = 1; table_id <= MAX_TABLE_ID; ++table_id) {
+        if (stored_pathname[table_id] && log_manager_t::table_lsns[table_id]) {
+            table.table_id = table_id;
+            table.lsn = log_manager_t::table_lsns[table_id];
+            table.pathname = stored_pathname[table_id];
+            ckpt.tables.push_back(table);
+        }
+    }
+
+    pthread_mutex_lock(&trx_system_t::latch);
+    ckpt.next_tid = trx_system_t::next_tid;
+    for (trx_t *trx : trx_system_t::table) {
+        if (trx->last_lsn) {
+            ckpt.trxs.push_back(std::make_pair(trx->tid, trx->last_lsn));
+        }
+    }
+    pthread_mutex_unlock(&trx_system_t::latch);
+
+    buf_dirty_pages(ckpt.dirty_pages);
+
+    payload = _serialize_checkpoint(ckpt);
+    // Too many dirty pages to fit in a log buffer. Keep the previous checkpoint.
+    if (payload.size() + LOG_RECORD_HEADER_SIZE > LOG_BUFFER_SIZE) {
+        return 1;
+    }
+
+    rec.type = log_type_t::CHECKPOINT;
+    rec.trx_id = 0;
+    rec.prev_lsn = 0;
+    rec.length = payload.size();
+    rec.payload = payload.data();
+    lsn = log_write(&rec);
+
+    log_flush(lsn);
+    return log_write_master(lsn);
+}
+
+/**
+ * Body of the checkpoint thread.
+ * Write out a few dirty pages every tick, so that pages don't stay dirty
+ *   long enough to hold back the start point of recovery,
+ *   and take a checkpoint every CHECKPOINT_INTERVAL_TICKS ticks.
+ */
+static void *_checkpoint_main(void *) {
+    struct timespec deadline;
+    uint64_t checkpointed_lsn = log_end_lsn();
+    int ticks = 0;
+
+    pthread_mutex_lock(&checkpoint_manager_t::latch);
+
+    while (checkpoint_manager_t::running) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += CHECKPOINT_TICK_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&checkpoint_manager_t::cond, &checkpoint_manager_t::latch, &deadline);
+        if (!checkpoint_manager_t::running) break;
+
+        pthread_mutex_unlock(&checkpoint_manager_t::latch);
+
+        buf_flush_pages(CHECKPOINT_FLUSH_PAGES);
+        if (++ticks >= CHECKPOINT_INTERVAL_TICKS && log_end_lsn() != checkpointed_lsn) {
+            ticks = 0;
+            if (checkpoint() == 0) {
+                checkpointed_lsn = log_end_lsn();
+            }
+        }
+
+        pthread_mutex_lock(&checkpoint_manager_t::latch);
+    }
+
+    pthread_mutex_unlock(&checkpoint_manager_t::latch);
+
+    return NULL;
+}
+
+/**
+ * Start the checkpoint thread.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int checkpoint_start(void) {
+    if (!log_enabled() || checkpoint_manager_t::running) {
+        return 1;
+    }
+
+    checkpoint_manager_t::running = true;
+    if (pthread_create(&checkpoint_manager_t::thread, NULL, _checkpoint_main, NULL) != 0) {
+        checkpoint_manager_t::running = false;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Stop the checkpoint thread and wait for it.
+ */
+void checkpoint_stop(void) {
+    if (!checkpoint_manager_t::running) {
+        return;
+    }
+
+    pthread_mutex_lock(&checkpoint_manager_t::latch);
+    checkpoint_manager_t::running = false;
+    pthread_cond_signal(&checkpoint_manager_t::cond);
+    pthread_mutex_unlock(&checkpoint_manager_t::latch);
+
+    pthread_join(checkpoint_manager_t::thread, NULL);
+}
+
+/**
+ * Restore the database to a consistent state after a crash.
+ * Analysis scans the log to find loser transactions and modifications to redo,
+ *   and cuts off a torn record at the end of log.
+ * If there is a checkpoint, the scan starts from the earliest of its begin_lsn,
+ *   the oldest rec_lsn of its dirty pages and last_lsn of its transactions.
+ * Redo repeats history in parallel, and undo rolls back the losers.
+ * Tables referred to by the log are opened and stay open,
+ *   so open_table on them returns the same table id afterwards.
+ * Must be called right after log_init, before any transaction begins.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int recover(void) {
+    std::map<int, uint64_t> active_trxs;
+    std::set<int> finished_trxs;
+    std::map<int, int> log_table_paths;
+    std::map<int, std::pair<uint64_t, int>> checkpoint_tables, checkpoint_table_ids;
+    std::map<uint64_t, int> record_tables;
+    std::map<std::string, int> path_indexes;
+    std::vector<std::string> paths;
+    std::vector<int> path_table_ids;
+    std::vector<redo_item_t> redo_items;
+    std::vector<trx_t*> losers;
+    checkpoint_t ckpt;
+    redo_item_t item;
+    log_record_t rec;
+    uint64_t lsn, start_lsn = LOG_HEADER_SIZE, end_lsn;
+    int max_tid = 0, path_index, result;
+
+    if (!log_enabled()) {
+        return 0;
+    }
+
+    auto path_index_of = [&](const std::string &pathname) {
+        if (path_indexes.count(pathname) == 0) {
+            path_indexes[pathname] = paths.size();
+            paths.push_back(pathname);
+        }
+        return path_indexes[pathname];
+    };
+
+    end_lsn = log_manager_t::next_lsn;
+
+    if (log_manager_t::checkpoint_lsn != 0
+            && log_read(log_manager_t::checkpoint_lsn, &rec) == 0
+            && rec.lsn == log_manager_t::checkpoint_lsn
+            && rec.type == log_type_t::CHECKPOINT
+            && _parse_checkpoint(&rec, ckpt) == 0) {
+        start_lsn = ckpt.begin_lsn;
+        for (const dirty_page_t &dirty_page : ckpt.dirty_pages) {
+            start_lsn = std::min(start_lsn, dirty_page.rec_lsn);
+        }
+        // A transaction may have logged its COMMIT before begin_lsn
+        //   and still be in the checkpoint. Scan from its last record to see it.
+        for (const auto &trx : ckpt.trxs) {
+            start_lsn = std::min(start_lsn, trx.second);
+        }
+        // A binding holds only after its TABLE record.
+        for (const checkpoint_table_t &table : ckpt.tables) {
+            checkpoint_tables[table.table_id]
+                = std::make_pair(table.lsn, path_index_of(table.pathname));
+        }
+        max_tid = ckpt.next_tid - 1;
+    } else {
+        ckpt.begin_lsn = 0;
+    }
+
+    // Analysis.
+    for (lsn = start_lsn; lsn < end_lsn; lsn += rec.log_size) {
+        if (log_read(lsn, &rec) != 0 || rec.lsn != lsn) break;
+
+        if (rec.trx_id > max_tid) {
+            max_tid = rec.trx_id;
+        }
+
+        switch (rec.type) {
+        case log_type_t::BEGIN:
+            active_trxs[rec.trx_id] = lsn;
+            break;
+        case log_type_t::COMMIT:
+        case log_type_t::ROLLBACK:
+            active_trxs.erase(rec.trx_id);
+            finished_trxs.insert(rec.trx_id);
+            break;
+        case log_type_t::TABLE:
+            log_table_paths[rec.table_id] = path_index_of(rec.pathname);
+            break;
+        case log_type_t::CHECKPOINT:
+            if (lsn != log_manager_t::checkpoint_lsn) break;
+            // Transactions may have logged more between begin_lsn and here.
+            for (const auto &trx : ckpt.trxs) {
+                if (finished_trxs.count(trx.first) == 0
+                        && active_trxs[trx.first] < trx.second) {
+                    active_trxs[trx.first] = trx.second;
+                }
+            }
+            break;
+        case log_type_t::UPDATE:
+        case log_type_t::COMPENSATE:
+            active_trxs[rec.trx_id] = lsn;
+
+            if (log_table_paths.count(rec.table_id)) {
+                path_index = log_table_paths[rec.table_id];
+            } else if (checkpoint_tables.count(rec.table_id)
+                    && checkpoint_tables[rec.table_id].first < lsn) {
+                path_index = checkpoint_tables[rec.table_id].second;
+            } else {
+                // The table was closed before the checkpoint, so it is on disk.
+                break;
+            }
+
+            item.lsn = lsn;
+            item.table_id = path_index;
+            item.page_number = rec.page_number;
+            item.offset = rec.offset;
+            item.length = rec.length;
+            memcpy(item.image, rec.new_image, rec.length);
+            redo_items.push_back(item);
+            break;
+        }
+    }
+
+    if (lsn < end_lsn) {
+        log_truncate(lsn);
+    }
+
+    pthread_mutex_lock(&trx_system_t::latch);
+    if (trx_system_t::next_tid <= max_tid) {
+        trx_system_t::next_tid = max_tid + 1;
+    }
+    pthread_mutex_unlock(&trx_system_t::latch);
+
+    // Items refer to path indexes so far. Map them to current table ids.
+    for (const std::string &path : paths) {
+        path_table_ids.push_back(open_table((char*)path.c_str()));
+    }
+    for (redo_item_t &redo_item : redo_items) {
+        redo_item.table_id = path_table_ids[redo_item.table_id];
+        record_tables[redo_item.lsn] = redo_item.table_id;
+    }
+    redo_items.erase(std::remove_if(redo_items.begin(), redo_items.end()
+        , [](const redo_item_t &redo_item) {
+            return redo_item.table_id <= 0;
+        }), redo_items.end());
+    for (const auto &table : checkpoint_tables) {
+        checkpoint_table_ids[table.first]
+            = std::make_pair(table.second.first, path_table_ids[table.second.second]);
+    }
+
+    // Redo.
+    result = _redo(redo_items);
+    redo_items.clear();
+
+    // Undo.
+    for (const auto &active_trx : active_trxs) {
+        trx_t *loser = new trx_t();
+        loser->tid = active_trx.first;
+        loser->last_lsn = active_trx.second;
+        losers.push_back(loser);
+    }
+    result |= _undo(losers, record_tables, checkpoint_table_ids);
+
+    return result;
+}
@@ -0,0 +1,717 @@
+/*
+ * scan_manager.cc
+ */
+
+#include <algorithm>
+#include <new>
+
+#include "buffer_manager.hpp"
+#include "scan_manager.hpp"
+
+
+// GLOBALS.
+
+/**
+ * Number of temporary tables named so far.
+ */
+static uint64_t temp_table_serial = 0;
+
+/**
+ * Number of frames reserved by running sorts, under sort_pool_latch.
+ */
+static pthread_mutex_t sort_pool_latch = PTHREAD_MUTEX_INITIALIZER;
+static int sort_reserved_pages = 0;
+
+
+// FUNCTIONS.
+
+/**
+ * Decode an optionally signed decimal integer at the beginning of a value.
+ * \return The integer, or 0 if the value does not start with one.
+ */
+int64_t scan_decode_int(const char *value) {
+    const char *end = value + 120;
+    uint64_t magnitude = 0;
+    bool negative = false;
+
+    if (value < end && (*value == '-' || *value == '+')) {
+        negative = *value++ == '-';
+    }
+    while (value < end && *value >= '0' && *value <= '9') {
+        magnitude = magnitude * 10 + (*value++ - '0');
+    }
+
+    return negative ? -(int64_t)magnitude : (int64_t)magnitude;
+}
+
+/**
+ * Apply one comparison to a column of a batch.
+ * Loops have no branch in the body, so that compilers can vectorize them.
+ */
+static void _filter_column(const int64_t *column, uint8_t *selection, int size
+        , scan_op_t op, int64_t operand) {
+    int i;
+
+    switch (op) {
+    case scan_op_t::EQ:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] == operand;
+        break;
+    case scan_op_t::NE:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] != operand;
+        break;
+    case scan_op_t::LT:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] < operand;
+        break;
+    case scan_op_t::LE:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] <= operand;
+        break;
+    case scan_op_t::GT:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] > operand;
+        break;
+    case scan_op_t::GE:
+        for (i = 0; i < size; ++i) selection[i] &= column[i] >= operand;
+        break;
+    }
+}
+
+/**
+ * Select rows of given batch that satisfy all predicates.
+ */
+void scan_filter(scan_batch_t *batch, const scan_predicate_t *predicates, int num_predicates) {
+    int i;
+
+    for (i = 0; i < batch->size; ++i) {
+        batch->selection[i] = 1;
+    }
+
+    for (i = 0; i < num_predicates; ++i) {
+        _filter_column(predicates[i].column == scan_column_t::KEY ? batch->keys : batch->values
+            , batch->selection, batch->size, predicates[i].op, predicates[i].operand);
+    }
+}
+
+/**
+ * Reset given aggregate to that of no row.
+ */
+void scan_aggregate_init(scan_aggregate_t *aggregate) {
+    aggregate->count = 0;
+    aggregate->sum = 0;
+    aggregate->min = INT64_MAX;
+    aggregate->max = INT64_MIN;
+}
+
+/**
+ * Add selected rows of given batch to an aggregate.
+ * Unselected rows are masked out instead of skipped, to keep the loop branch-free.
+ */
+void scan_aggregate_batch(scan_aggregate_t *aggregate, const scan_batch_t *batch, scan_column_t column) {
+    const int64_t *values = column == scan_column_t::KEY ? batch->keys : batch->values;
+    int64_t count = 0, sum = 0, min = aggregate->min, max = aggregate->max, mask, value;
+    int i;
+
+    for (i = 0; i < batch->size; ++i) {
+        mask = -(int64_t)batch->selection[i];
+        count += batch->selection[i];
+        sum += values[i] & mask;
+        value = (values[i] & mask) | (INT64_MAX & ~mask);
+        min = value < min ? value : min;
+        value = (values[i] & mask) | (INT64_MIN & ~mask);
+        max = value > max ? value : max;
+    }
+
+    aggregate->count += count;
+    aggregate->sum += sum;
+    aggregate->min = min;
+    aggregate->max = max;
+}
+
+/**
+ * \return Average of aggregated rows, or 0 if there is none.
+ */
+double scan_aggregate_avg(const scan_aggregate_t *aggregate) {
+    return aggregate->count ? (double)aggregate->sum / aggregate->count : 0;
+}
+
+/**
+ * Name an unopened temporary table after a table, as
+ *   "<table path><suffix>.<process id>.<serial>".
+ * Concurrent queries on one table get different files and table ids,
+ *   so that none drops pages of another.
+ * \param pathname Path name of the table the query reads.
+ * \param suffix Suffix naming the operator, e.g., ".sort".
+ */
+void temp_table_init(temp_table_t *temp, const char *pathname, const char *suffix) {
+    uint64_t serial = __atomic_fetch_add(&temp_table_serial, 1, __ATOMIC_RELAXED);
+
+    temp->pathname = std::string(pathname) + suffix + "." + std::to_string(getpid())
+        + "." + std::to_string(serial);
+    temp->table_id = 0;
+    temp->next_page = 0;
+}
+
+/**
+ * Allocate a page at the end of a temporary table, opening it if needed.
+ * The page is not read from disk, so its content is undefined.
+ * \return Page number, or 0 if the table cannot be opened.
+ */
+pagenum_t temp_table_alloc(temp_table_t *temp) {
+    if (temp->table_id <= 0) {
+        temp->table_id = buf_open_table((char*)temp->pathname.c_str());
+        if (temp->table_id <= 0) {
+            temp->table_id = 0;
+            return 0;
+        }
+        unlink(temp->pathname.c_str());
+        temp->next_page = 1;
+    }
+
+    return temp->next_page++;
+}
+
+/**
+ * Discard a temporary table with its pages in the buffer pool.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int temp_table_drop(temp_table_t *temp) {
+    int result = 0;
+
+    if (temp->table_id > 0) {
+        result = buf_drop_table(temp->table_id);
+        temp->table_id = 0;
+    }
+
+    return result;
+}
+
+/**
+ * Hash a group. Low bits pick a slot, and high bits pick spill partitions.
+ */
+static inline uint64_t _group_hash(int64_t group) {
+    uint64_t hash = (uint64_t)group * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29);
+}
+
+/**
+ * Prepare an empty group aggregator.
+ * \param spill Temporary table for groups that do not fit in memory.
+ *   Its table_id should be 0 until the first spill opens it.
+ * \param depth Number of times rows fed to this aggregator have been partitioned.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int group_aggregator_init(group_aggregator_t *aggregator, temp_table_t *spill, int depth) {
+    aggregator->capacity = GROUP_INITIAL_CAPACITY;
+    aggregator->entries = new (std::nothrow) group_entry_t[aggregator->capacity]();
+    if (aggregator->entries == NULL) {
+        return 1;
+    }
+
+    aggregator->max_capacity = GROUP_INITIAL_CAPACITY;
+    while (aggregator->max_capacity * 2 * sizeof(group_entry_t) <= GROUP_MEMORY_SIZE) {
+        aggregator->max_capacity *= 2;
+    }
+    aggregator->size = 0;
+    aggregator->depth = depth;
+    aggregator->spill = spill;
+
+    return 0;
+}
+
+/**
+ * Double the hash table and rehash its groups.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _group_grow(group_aggregator_t *aggregator) {
+    group_entry_t *entries;
+    size_t capacity = aggregator->capacity * 2, mask = capacity - 1, i, slot;
+
+    entries = new (std::nothrow) group_entry_t[capacity]();
+    if (entries == NULL) {
+        return 1;
+    }
+
+    for (i = 0; i < aggregator->capacity; ++i) {
+        if (aggregator->entries[i].aggregate.count == 0) continue;
+        slot = _group_hash(aggregator->entries[i].group) & mask;
+        while (entries[slot].aggregate.count) {
+            slot = (slot + 1) & mask;
+        }
+        entries[slot] = aggregator->entries[i];
+    }
+
+    delete[] aggregator->entries;
+    aggregator->entries = entries;
+    aggregator->capacity = capacity;
+
+    return 0;
+}
+
+/**
+ * Write buffered rows of a partition to a new spill page.
+ * The spill table is opened by the first spill.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+static int _group_spill_page(group_aggregator_t *aggregator, int partition) {
+    temp_table_t *spill = aggregator->spill;
+    std::vector<group_value_pair> &rows = aggregator->partition_rows[partition];
+    pagenum_t page_number;
+    buffer_t *page;
+
+    page_number = temp_table_alloc(spill);
+    if (page_number == 0) {
+        return 1;
+    }
+
+    page = buf_get_page(spill->table_id, page_number);
+    page->frame->spill_page.num_of_rows = rows.size();
+    page->frame->spill_page.page_lsn = 0;
+    memcpy(page->frame->spill_page.rows, rows.data(), rows.size() * sizeof(group_value_pair));
+    buf_put_page(page, 1);
+
+    aggregator->partition_pages[partition].push_back(page_number);
+    rows.clear();
+
+    return 0;
+}
+
+/**
+ * Aggregate selected rows into their groups.
+ * A new group that does not fit in memory is spilled with its row.
+ * \param groups Group of each row.
+ * \param values Aggregated column of each row.
+ * \param selection 1 for rows to aggregate. If NULL, all rows.
+ */
+void group_aggregator_add(group_aggregator_t *aggregator, const int64_t *groups, const int64_t *values
+        , const uint8_t *selection, int num_rows) {
+    group_entry_t *entry;
+    scan_aggregate_t *aggregate;
+    uint64_t hash;
+    size_t slot;
+    int i, partition, shift = 64 - 4 * (aggregator->depth + 1);
+
+    for (i = 0; i < num_rows; ++i) {
+        if (selection && !selection[i]) continue;
+
+        hash = _group_hash(groups[i]);
+        while (true) {
+            slot = hash & (aggregator->capacity - 1);
+            while (aggregator->entries[slot].aggregate.count
+                    && aggregator->entries[slot].group != groups[i]) {
+                slot = (slot + 1) & (aggregator->capacity - 1);
+            }
+            entry = &aggregator->entries[slot];
+            // Keep the table at most half full.
+            if (entry->aggregate.count || 2 * (aggregator->size + 1) <= aggregator->capacity) break;
+
+            if (aggregator->capacity < aggregator->max_capacity
+                    || aggregator->depth >= GROUP_MAX_SPILL_DEPTH) {
+                if (_group_grow(aggregator) == 0) continue;
+            }
+            entry = NULL;
+            break;
+        }
+
+        if (entry == NULL) {
+            partition = (hash >> shift) & (GROUP_SPILL_PARTITIONS - 1);
+            aggregator->partition_rows[partition].push_back({ groups[i], values[i] });
+            // Without a spill table, rows stay buffered in their partition,
+            //   since their groups must not get a second entry in memory.
+            if (aggregator->partition_rows[partition].size() == GROUP_ROWS_PER_PAGE) {
+                _group_spill_page(aggregator, partition);
+            }
+            continue;
+        }
+
+        aggregate = &entry->aggregate;
+        if (aggregate->count == 0) {
+            entry->group = groups[i];
+            scan_aggregate_init(aggregate);
+            ++aggregator->size;
+        }
+        ++aggregate->count;
+        aggregate->sum += values[i];
+        aggregate->min = values[i] < aggregate->min ? values[i] : aggregate->min;
+        aggregate->max = values[i] > aggregate->max ? values[i] : aggregate->max;
+    }
+}
+
+/**
+ * Emit every group and free the hash table.
+ * Groups in memory go first in no particular order.
+ *   Then each spilled partition is read back through the buffer pool
+ *   and aggregated by a child aggregator one level deeper.
+ * The spill table is left to the caller to drop.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int group_aggregator_finish(group_aggregator_t *aggregator, group_emit_t emit, void *arg) {
+    group_aggregator_t *child;
+    temp_table_t *spill = aggregator->spill;
+    int64_t groups[GROUP_ROWS_PER_PAGE], values[GROUP_ROWS_PER_PAGE];
+    buffer_t *page;
+    size_t i, j, num_rows;
+    int partition, result = 0;
+
+    for (i = 0; i < aggregator->capacity; ++i) {
+        if (aggregator->entries[i].aggregate.count) {
+            emit(aggregator->entries[i].group, &aggregator->entries[i].aggregate, arg);
+        }
+    }
+    delete[] aggregator->entries;
+    aggregator->entries = NULL;
+
+    for (partition = 0; partition < GROUP_SPILL_PARTITIONS; ++partition) {
+        std::vector<group_value_pair> &rows = aggregator->partition_rows[partition];
+        if (rows.empty() && aggregator->partition_pages[partition].empty()) continue;
+
+        child = new group_aggregator_t();
+        if (group_aggregator_init(child, spill, aggregator->depth + 1) != 0) {
+            delete child;
+            result = 1;
+            break;
+        }
+
+        for (pagenum_t page_number : aggregator->partition_pages[partition]) {
+            page = buf_get_page(spill->table_id, page_number);
+            num_rows = page->frame->spill_page.num_of_rows;
+            for (j = 0; j < num_rows; ++j) {
+                groups[j] = page->frame->spill_page.rows[j].group;
+                values[j] = page->frame->spill_page.rows[j].value;
+            }
+            buf_put_page(page, 0);
+            group_aggregator_add(child, groups, values, NULL, num_rows);
+        }
+        for (j = 0; j < rows.size(); j += num_rows) {
+            num_rows = std::min(rows.size() - j, (size_t)GROUP_ROWS_PER_PAGE);
+            for (i = 0; i < num_rows; ++i) {
+                groups[i] = rows[j + i].group;
+                values[i] = rows[j + i].value;
+            }
+            group_aggregator_add(child, groups, values, NULL, num_rows);
+        }
+        aggregator->partition_pages[partition].clear();
+        rows.clear();
+
+        result |= group_aggregator_finish(child, emit, arg);
+        delete child;
+    }
+
+    return result;
+}
+
+/**
+ * Get the sort key of a row. 0 when rows are compared as strings.
+ */
+static inline int64_t _sort_key(const sort_order_t *order, const record *rec) {
+    if (order->column == scan_column_t::KEY) return rec->key;
+    return order->decode ? order->decode(rec->value) : 0;
+}
+
+/**
+ * Compare two rows in the sort order.
+ * \return Negative if \p rec_1 goes first, positive if \p rec_2 goes first, otherwise 0.
+ */
+static inline int _sort_compare(const sort_order_t *order, int64_t key_1, const record *rec_1
+        , int64_t key_2, const record *rec_2) {
+    int result;
+
+    if (order->column == scan_column_t::VALUE && !order->decode) {
+        result = strncmp(rec_1->value, rec_2->value, sizeof(rec_1->value));
+    } else {
+        result = (key_1 > key_2) - (key_1 < key_2);
+    }
+
+    return order->descending ? -result : result;
+}
+
+/**
+ * Unpin frames of the run area without writing them.
+ */
+static void _sort_release_area(sort_t *sort) {
+    for (buffer_t *page : sort->area) {
+        buf_put_page(page, 0);
+    }
+    sort->area.clear();
+}
+
+/**
+ * Reserve frames for the run area of a sort and one more for the page being written,
+ *   which is all a sort pins at a time.
+ * \return Number of area pages, or 0 if too few frames are left.
+ */
+static int _sort_reserve(sort_t *sort) {
+    int budget = std::max(SORT_MIN_AREA_PAGES + 1, g_buffer_size / SORT_MAX_POOL_FRACTION);
+    int area_pages = std::max(SORT_MIN_AREA_PAGES, g_buffer_size / SORT_POOL_FRACTION);
+
+    pthread_mutex_lock(&sort_pool_latch);
+    area_pages = std::min(area_pages, budget - sort_reserved_pages - 1);
+    if (area_pages < SORT_MIN_AREA_PAGES) {
+        area_pages = 0;
+    } else {
+        sort_reserved_pages += area_pages + 1;
+        sort->reserved_pages = area_pages + 1;
+    }
+    pthread_mutex_unlock(&sort_pool_latch);
+
+    return area_pages;
+}
+
+/**
+ * Return frames reserved by a sort.
+ */
+static void _sort_unreserve(sort_t *sort) {
+    pthread_mutex_lock(&sort_pool_latch);
+    sort_reserved_pages -= sort->reserved_pages;
+    sort->reserved_pages = 0;
+    pthread_mutex_unlock(&sort_pool_latch);
+}
+
+/**
+ * Prepare an empty sort and pin its run area.
+ * \param temp Temporary table for the run area and runs.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int sort_init(sort_t *sort, const sort_order_t *order, temp_table_t *temp) {
+    int area_pages, i;
+    pagenum_t page_number;
+
+    sort->order = *order;
+    sort->temp = temp;
+    sort->reserved_pages = 0;
+    sort->failed = false;
+
+    area_pages = _sort_reserve(sort);
+    if (area_pages == 0) {
+        return 1;
+    }
+    for (i = 0; i < area_pages; ++i) {
+        page_number = temp_table_alloc(temp);
+        if (page_number == 0) {
+            _sort_release_area(sort);
+            _sort_unreserve(sort);
+            return 1;
+        }
+        sort->area.push_back(buf_get_page(temp->table_id, page_number));
+    }
+    sort->entries.reserve(area_pages * SORT_ROWS_PER_PAGE);
+
+    return 0;
+}
+
+/**
+ * Sort rows of the run area. Equal rows keep their order.
+ */
+static void _sort_area(sort_t *sort) {
+    const sort_order_t *order = &sort->order;
+
+    std::stable_sort(sort->entries.begin(), sort->entries.end()
+        , [order](const sort_entry_t &entry_1, const sort_entry_t &entry_2) {
+            return _sort_compare(order, entry_1.sort_key, entry_1.rec, entry_2.sort_key, entry_2.rec) < 0;
+        });
+}
+
+/**
+ * Appends rows to a new run, one page at a time.
+ * Pages of a run are allocated back to back, so a run is a page range.
+ */
+class sort_writer_t {
+public:
+    sort_t *sort;
+    sort_run_t run;
+    buffer_t *page;
+};
+
+static void _sort_writer_add(sort_writer_t *writer, const record *rec) {
+    sort_t *sort = writer->sort;
+    pagenum_t page_number;
+
+    if (writer->page && writer->page->frame->leaf_page.num_of_keys == SORT_ROWS_PER_PAGE) {
+        buf_put_page(writer->page, 1);
+        writer->page = NULL;
+    }
+    if (writer->page == NULL) {
+        page_number = temp_table_alloc(sort->temp);
+        if (page_number == 0) {
+            sort->failed = true;
+            return;
+        }
+        if (writer->run.num_pages++ == 0) {
+            writer->run.first_page = page_number;
+        }
+        writer->page = buf_get_page(sort->temp->table_id, page_number);
+        writer->page->frame->leaf_page.num_of_keys = 0;
+        writer->page->frame->leaf_page.page_lsn = 0;
+    }
+
+    writer->page->frame->leaf_page.records[writer->page->frame->leaf_page.num_of_keys++] = *rec;
+}
+
+static void _sort_writer_close(sort_writer_t *writer) {
+    if (writer->page) {
+        buf_put_page(writer->page, 1);
+        writer->page = NULL;
+    }
+    writer->sort->runs.push_back(writer->run);
+}
+
+/**
+ * Sort the run area and write it out as a run.
+ */
+static void _sort_write_run(sort_t *sort) {
+    sort_writer_t writer = { sort, { 0, 0 }, NULL };
+
+    _sort_area(sort);
+    for (const sort_entry_t &entry : sort->entries) {
+        _sort_writer_add(&writer, entry.rec);
+    }
+    _sort_writer_close(&writer);
+
+    sort->entries.clear();
+}
+
+/**
+ * Add a row to a sort. It is copied into the run area.
+ */
+void sort_add(sort_t *sort, const record *rec) {
+    record *dest;
+    size_t n = sort->entries.size();
+
+    if (n == sort->area.size() * SORT_ROWS_PER_PAGE) {
+        _sort_write_run(sort);
+        n = 0;
+    }
+
+    dest = &sort->area[n / SORT_ROWS_PER_PAGE]->frame->leaf_page.records[n % SORT_ROWS_PER_PAGE];
+    *dest = *rec;
+    sort->entries.push_back({ _sort_key(&sort->order, dest), dest });
+}
+
+/**
+ * Move a merge input to its next row, pinning the next page of the run if needed.
+ */
+static void _sort_source_next(sort_t *sort, sort_source_t *source) {
+    if (++source->index >= source->page->frame->leaf_page.num_of_keys) {
+        buf_put_page(source->page, 0);
+        source->page = NULL;
+        source->index = 0;
+        if (source->next_page < source->end_page) {
+            source->page = buf_get_page(sort->temp->table_id, source->next_page++);
+        }
+    }
+    if (source->page) {
+        source->sort_key = _sort_key(&sort->order, &source->page->frame->leaf_page.records[source->index]);
+    }
+}
+
+/**
+ * Merge \p num_runs runs with a loser tree.
+ * Leaves of the tree are runs, and each internal node keeps the loser
+ *   of the match below it, so replacing the winner replays only its path:
+ *   log2(num_runs) comparisons per row.
+ * Ties go to the earlier run, which keeps the sort stable.
+ * \param writer If not NULL, write rows to it. Otherwise, emit them.
+ */
+static void _sort_merge(sort_t *sort, const sort_run_t *runs, int num_runs
+        , sort_writer_t *writer, sort_emit_t emit, void *arg) {
+    std::vector<sort_source_t> sources(num_runs);
+    std::vector<int> tree(num_runs), winners(2 * num_runs);
+    const sort_order_t *order = &sort->order;
+    int i, node, winner;
+
+    // Whether source_1 goes before source_2.
+    auto before = [&](int source_1, int source_2) {
+        sort_source_t *s_1 = &sources[source_1], *s_2 = &sources[source_2];
+        int result;
+
+        if (!s_1->page || !s_2->page) {
+            return s_2->page == NULL && (s_1->page != NULL || source_1 < source_2);
+        }
+        result = _sort_compare(order, s_1->sort_key, &s_1->page->frame->leaf_page.records[s_1->index]
+            , s_2->sort_key, &s_2->page->frame->leaf_page.records[s_2->index]);
+        return result < 0 || (result == 0 && source_1 < source_2);
+    };
+
+    for (i = 0; i < num_runs; ++i) {
+        sources[i].page = buf_get_page(sort->temp->table_id, runs[i].first_page);
+        sources[i].next_page = runs[i].first_page + 1;
+        sources[i].end_page = runs[i].first_page + runs[i].num_pages;
+        sources[i].index = -1;
+        _sort_source_next(sort, &sources[i]);
+        winners[num_runs + i] = i;
+    }
+
+    // Play the initial tournament bottom-up.
+    for (node = num_runs - 1; node >= 1; --node) {
+        int left = winners[2 * node], right = winners[2 * node + 1];
+        winners[node] = before(left, right) ? left : right;
+        tree[node] = winners[node] == left ? right : left;
+    }
+    winner = num_runs > 1 ? winners[1] : 0;
+
+    while (sources[winner].page) {
+        const record *rec = &sources[winner].page->frame->leaf_page.records[sources[winner].index];
+        if (writer) {
+            _sort_writer_add(writer, rec);
+        } else {
+            emit(rec, arg);
+        }
+
+        _sort_source_next(sort, &sources[winner]);
+        for (node = (num_runs + winner) / 2; node >= 1; node /= 2) {
+            if (before(tree[node], winner)) {
+                std::swap(tree[node], winner);
+            }
+        }
+    }
+}
+
+/**
+ * Emit all rows in order and release the run area and its reserved frames.
+ * If every row fit in the run area, rows are emitted from it directly.
+ *   Otherwise, runs are merged in passes of at most as many runs as
+ *   the area had pages, then the last pass emits rows.
+ * The temporary table is left to the caller to drop.
+ * \return If success, return 0. Otherwise, return non-zero value.
+ */
+int sort_finish(sort_t *sort, sort_emit_t emit, void *arg) {
+    std::vector<sort_run_t> runs;
+    size_t fan_in = sort->area.size(), i, num_runs;
+
+    if (sort->runs.empty()) {
+        _sort_area(sort);
+        for (const sort_entry_t &entry : sort->entries) {
+            emit(entry.rec, arg);
+        }
+        sort->entries.clear();
+        _sort_release_area(sort);
+        _sort_unreserve(sort);
+        return sort->failed;
+    }
+
+    if (!sort->entries.empty()) {
+        _sort_write_run(sort);
+    }
+    // Frames of the area become merge input pages.
+    _sort_release_area(sort);
+
+    while (sort->runs.size() > fan_in && !sort->failed) {
+        runs.swap(sort->runs);
+        sort->runs.clear();
+        for (i = 0; i < runs.size(); i += num_runs) {
+            num_runs = std::min(fan_in, runs.size() - i);
+            if (num_runs == 1) {
+                sort->runs.push_back(runs[i]);
+                continue;
+            }
+            sort_writer_t writer = { sort, { 0, 0 }, NULL };
+            _sort_merge(sort, &runs[i], num_runs, &writer, NULL, NULL);
+            _sort_writer_close(&writer);
+        }
+    }
+
+    if (!sort->failed) {
+        _sort_merge(sort, sort->runs.data(), sort->runs.size(), NULL, emit, arg);
+    }
+    sort->runs.clear();
+    _sort_unreserve(sort);
+
+    return sort->failed;
+}
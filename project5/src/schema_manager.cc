@@ -0,0 +1,121 @@
+/*
+ * schema_manager.cc
+ */
+
+#include "schema_manager.hpp"
+
+
+// FUNCTIONS.
+
+/**
+ * Validate columns and pack them into a value in order.
+ * Set offset of every column, and width of INT and FLOAT columns.
+ * \param columns Columns with type, name and width of CHAR columns.
+ * \return If all columns fit in a value, return 0. Otherwise, return non-zero value.
+ */
+int schema_layout(column_def *columns, int num_columns) {
+    uint32_t offset = 0;
+    int i;
+
+    if (num_columns < 0 || num_columns > MAX_COLUMNS) {
+        return 1;
+    }
+
+    for (i = 0; i < num_columns; ++i) {
+        switch (columns[i].type) {
+        case COLUMN_TYPE_INT:
+            columns[i].width = sizeof(int64_t);
+            break;
+        case COLUMN_TYPE_FLOAT:
+            columns[i].width = sizeof(double);
+            break;
+        case COLUMN_TYPE_CHAR:
+            if (columns[i].width == 0) return 1;
+            break;
+        default:
+            return 1;
+        }
+        if (columns[i].width > SCHEMA_VALUE_SIZE - offset
+                || strnlen(columns[i].name, COLUMN_NAME_LENGTH) == COLUMN_NAME_LENGTH) {
+            return 1;
+        }
+
+        columns[i].offset = offset;
+        offset += columns[i].width;
+    }
+
+    return 0;
+}
+
+/**
+ * \return Index of the column with given name, or -1 if there is none.
+ */
+int schema_find_column(const column_def *columns, int num_columns, const char *name) {
+    int i;
+
+    for (i = 0; i < num_columns; ++i) {
+        if (strncmp(columns[i].name, name, COLUMN_NAME_LENGTH) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Read an INT column of a value.
+ * Columns are not aligned in the value, so they are copied out.
+ */
+int64_t value_get_int(const char *value, const column_def *column) {
+    int64_t data;
+
+    memcpy(&data, value + column->offset, sizeof(data));
+
+    return data;
+}
+
+/**
+ * Read a FLOAT column of a value.
+ */
+double value_get_float(const char *value, const column_def *column) {
+    double data;
+
+    memcpy(&data, value + column->offset, sizeof(data));
+
+    return data;
+}
+
+/**
+ * Read a CHAR column of a value as a string.
+ * \param dest Buffer of at least width + 1 bytes.
+ */
+void value_get_char(const char *value, const column_def *column, char *dest) {
+    size_t len = strnlen(value + column->offset, column->width);
+
+    memcpy(dest, value + column->offset, len);
+    dest[len] = '\0';
+}
+
+/**
+ * Write an INT column of a value.
+ */
+void value_set_int(char *value, const column_def *column, int64_t data) {
+    memcpy(value + column->offset, &data, sizeof(data));
+}
+
+/**
+ * Write a FLOAT column of a value.
+ */
+void value_set_float(char *value, const column_def *column, double data) {
+    memcpy(value + column->offset, &data, sizeof(data));
+}
+
+/**
+ * Write a CHAR column of a value. Longer strings are truncated to the width.
+ */
+void value_set_char(char *value, const column_def *column, const char *data) {
+    size_t len = strnlen(data, column->width);
+
+    memcpy(value + column->offset, data, len);
+    memset(value + column->offset + len, 0, column->width - len);
+}
@@ -0,0 +1,233 @@
+#include "lock_manager.hpp"
+
+// STATIC VARIABLES.
+
+pthread_mutex_t version_store_t::latch = PTHREAD_MUTEX_INITIALIZER;
+version_chain_t *version_store_t::table[VERSION_HASH_TABLE_SIZE] = {};
+int64_t version_store_t::last_commit_ts = 0;
+
+
+// MEMBER FUNCTIONS.
+
+/**
+ * Hash given record identifier.
+ * \return hashed value about \p table_id and \p key .
+ */
+int version_store_t::hashing(int table_id, int64_t key) {
+    return ((uint64_t)key * 31 + table_id) % VERSION_HASH_TABLE_SIZE;
+}
+
+
+// FUNCTIONS.
+
+/**
+ * Find the version chain of given record.
+ * Caller must hold version_store_t::latch.
+ * \param create If true, make an empty chain when there is no chain yet.
+ * \return The chain of the record, or nullptr if there isn't.
+ */
+static version_chain_t *_find_chain(int table_id, int64_t key, bool create) {
+    int hashed_idx = version_store_t::hashing(table_id, key);
+    version_chain_t *chain = version_store_t::table[hashed_idx];
+
+    while (chain && (chain->table_id != table_id || chain->key != key)) {
+        chain = chain->hash_next;
+    }
+
+    if (chain == nullptr && create) {
+        chain = new version_chain_t();
+        chain->table_id = table_id;
+        chain->key = key;
+        chain->newest = nullptr;
+        chain->hash_next = version_store_t::table[hashed_idx];
+        version_store_t::table[hashed_idx] = chain;
+    }
+
+    return chain;
+}
+
+/**
+ * Unlink given chain from the hash table and free it if it has no version.
+ * Caller must hold version_store_t::latch.
+ */
+static void _remove_chain_if_empty(version_chain_t *chain) {
+    version_chain_t **link;
+
+    if (chain->newest != nullptr) {
+        return;
+    }
+
+    link = &version_store_t::table[version_store_t::hashing(chain->table_id, chain->key)];
+    while (*link != chain) {
+        link = &(*link)->hash_next;
+    }
+    *link = chain->hash_next;
+
+    delete chain;
+}
+
+/**
+ * Free versions that no snapshot can read any more.
+ * A version is garbage once its writer committed at or before
+ *   the oldest running snapshot, and so are all older versions.
+ * Caller must hold version_store_t::latch.
+ */
+static void _truncate_chain(version_chain_t *chain, int64_t oldest_ts) {
+    version_t **link = &chain->newest;
+    version_t *victim, *next;
+
+    while (*link && (*link)->commit_ts > oldest_ts) {
+        link = &(*link)->older;
+    }
+
+    victim = *link;
+    *link = nullptr;
+    while (victim) {
+        next = victim->older;
+        delete victim;
+        victim = next;
+    }
+}
+
+/**
+ * Get the timestamp of the newest committed state.
+ * A snapshot taken with this timestamp sees every transaction
+ *   committed so far and nothing else.
+ */
+int64_t version_snapshot_ts(void) {
+    int64_t ts;
+
+    pthread_mutex_lock(&version_store_t::latch);
+    ts = version_store_t::last_commit_ts;
+    pthread_mutex_unlock(&version_store_t::latch);
+
+    return ts;
+}
+
+/**
+ * Keep the before-image of a record that given transaction is about to modify.
+ * Caller must hold the EXCLUSIVE lock and the page latch of the record,
+ *   so snapshot readers never see the new value without its before-image.
+ * \param old_value Value of the record before modification.
+ */
+void version_push(trx_t *trx, int table_id, int64_t key, const char *old_value) {
+    int64_t oldest_ts = trx_oldest_snapshot();
+    version_chain_t *chain;
+    version_t *version = new version_t();
+
+    version->commit_ts = VERSION_UNCOMMITTED;
+    memcpy(version->value, old_value, 120);
+
+    pthread_mutex_lock(&version_store_t::latch);
+
+    chain = _find_chain(table_id, key, true);
+    _truncate_chain(chain, oldest_ts);
+
+    version->chain = chain;
+    version->older = chain->newest;
+    chain->newest = version;
+
+    pthread_mutex_unlock(&version_store_t::latch);
+
+    trx->versions.push_back(version);
+}
+
+/**
+ * Stamp a new commit timestamp on all versions made by given transaction.
+ * After this, snapshots taken later see the values written by \p trx .
+ */
+void version_commit(trx_t *trx) {
+    int64_t oldest_ts, commit_ts;
+
+    if (trx->versions.empty()) {
+        return;
+    }
+
+    oldest_ts = trx_oldest_snapshot();
+
+    pthread_mutex_lock(&version_store_t::latch);
+
+    commit_ts = ++version_store_t::last_commit_ts;
+    for (version_t *version : trx->versions) {
+        version->commit_ts = commit_ts;
+    }
+    for (version_t *version : trx->versions) {
+        _truncate_chain(version->chain, oldest_ts);
+    }
+
+    pthread_mutex_unlock(&version_store_t::latch);
+
+    trx->versions.clear();
+}
+
+/**
+ * Drop all versions made by given aborted transaction.
+ * Its writes are undone in leaf pages,
+ *   so before-images at the head of the chains are no more needed.
+ */
+void version_discard(trx_t *trx) {
+    version_chain_t *chain;
+    version_t *version;
+
+    pthread_mutex_lock(&version_store_t::latch);
+
+    while (!trx->versions.empty()) {
+        version = trx->versions.back();
+        trx->versions.pop_back();
+
+        chain = version->chain;
+        chain->newest = version->older;
+        delete version;
+
+        _remove_chain_if_empty(chain);
+    }
+
+    pthread_mutex_unlock(&version_store_t::latch);
+}
+
+/**
+ * Free all versions and chains which no running snapshot can read.
+ */
+void version_collect(void) {
+    int64_t oldest_ts = trx_oldest_snapshot();
+    version_chain_t *chain, *next;
+    int i;
+
+    pthread_mutex_lock(&version_store_t::latch);
+
+    for (i = 0; i < VERSION_HASH_TABLE_SIZE; ++i) {
+        for (chain = version_store_t::table[i]; chain; chain = next) {
+            next = chain->hash_next;
+            _truncate_chain(chain, oldest_ts);
+            _remove_chain_if_empty(chain);
+        }
+    }
+
+    pthread_mutex_unlock(&version_store_t::latch);
+}
+
+/**
+ * Replace given value by the version visible to a snapshot.
+ * Caller must hold the page latch of the record
+ *   and \p value must be the current value in the leaf page.
+ * \param read_ts Snapshot timestamp of the reader.
+ * \param value Current value of the record as input,
+ *      and the visible value as output.
+ */
+void version_read(int table_id, int64_t key, int64_t read_ts, char *value) {
+    version_chain_t *chain;
+    version_t *version;
+
+    pthread_mutex_lock(&version_store_t::latch);
+
+    chain = _find_chain(table_id, key, false);
+    if (chain) {
+        // Value of each version was written by the writer of the next older one.
+        for (version = chain->newest; version; version = version->older) {
+            if (version->commit_ts <= read_ts) break;
+            memcpy(value, version->value, 120);
+        }
+    }
+
+    pthread_mutex_unlock(&version_store_t::latch);
+}